@@ -0,0 +1,361 @@
+/* wifcrack-bench: throughput of every stage of the candidate pipeline, on
+ * fixed seeds, single threaded and on all cores, for compressed and
+ * uncompressed keys.  The results are printed as JSON. */
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bitcoin.h"
+#include "configuration.h"
+#include "hash.h"
+#include "scheduler.h"
+#include "topology.h"
+#include "worker.h"
+
+#define BENCH_KEYS 1024         /* inputs cycled through by every thread */
+#define BENCH_POLL 64           /* operations between clock reads */
+#define BENCH_SEED 0x5EEDULL
+
+/* A compressed and an uncompressed WIF that nothing below will match. */
+static const char *const SEARCH_WIF[2] = {
+    "5HueCGU8rMjxEXxiPuD5BDku4MkF____d4dZ1jvhTVqvbTLvyTJ",
+    "KwdMAjGmerYanjeui5SHS7JkmpZ____vB2LJGU1ZxJwYvP98617"};
+static const char SEARCH_ADDRESS[] = "1EHNa6Q4Jz2uvNExL497mE43ikXhwF6kZm";
+
+typedef struct {
+    int compressed;
+    uint64_t rng;
+    ec_context *ctx;
+    unsigned char keys[BENCH_KEYS][32];
+    char wifs[BENCH_KEYS][WIF_CHARS_MAX + 1];
+    wif_num nums[BENCH_KEYS];
+    unsigned char pubs[BENCH_KEYS][65];
+    ec_point points[WIF_CHECK_BATCH];
+    WifCheckBatch check;
+    unsigned char hashes[WIF_CHECK_BATCH * 20];
+    volatile unsigned sink;
+} BenchState;
+
+/* Run ``n`` operations of a stage; returns the number actually done. */
+typedef uint64_t (*bench_fn)(BenchState *st, uint64_t i, uint64_t n);
+
+static uint64_t next_random(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static int bench_state_init(BenchState *st, int compressed, int thread) {
+    memset(st, 0, sizeof(*st));
+    st->compressed = compressed;
+    st->rng = BENCH_SEED * (uint64_t)(thread + 1);
+    st->ctx = ec_context_create();
+    if (!st->ctx)
+        return 0;
+    for (int i = 0; i < BENCH_KEYS; ++i) {
+        for (int k = 0; k < 32; k += 8) {
+            uint64_t r = next_random(&st->rng);
+            memcpy(st->keys[i] + k, &r, 8);
+        }
+        st->keys[i][0] &= 0x7F; /* below the group order */
+        encode_wif(st->keys[i], compressed, st->wifs[i]);
+        wif_num_from_base58(&st->nums[i], st->wifs[i]);
+        /* the hash stages only need messages of the right length */
+        memcpy(st->pubs[i], st->keys[i], 32);
+        memcpy(st->pubs[i] + 32, st->keys[i], 32);
+    }
+    for (int i = 0; i < WIF_CHECK_BATCH; ++i) {
+        if (!ec_point_init(st->ctx, &st->points[i]) ||
+            !ec_point_set_scalar(st->ctx, &st->points[i], st->keys[i], 32, 0))
+            return 0;
+    }
+    wif_check_batch_init(&st->check, compressed);
+    return 1;
+}
+
+static void bench_state_clear(BenchState *st) {
+    for (int i = 0; i < WIF_CHECK_BATCH; ++i)
+        ec_point_clear(&st->points[i]);
+    ec_context_free(st->ctx);
+}
+
+static uint64_t stage_base58(BenchState *st, uint64_t i, uint64_t n) {
+    wif_num num;
+    for (uint64_t k = 0; k < n; ++k) {
+        wif_num_from_base58(&num, st->wifs[(i + k) % BENCH_KEYS]);
+        st->sink += (unsigned)num.v[0];
+    }
+    return n;
+}
+
+static uint64_t stage_decode_wif(BenchState *st, uint64_t i, uint64_t n) {
+    unsigned char key[32];
+    int compressed;
+    for (uint64_t k = 0; k < n; ++k)
+        st->sink += (unsigned)decode_wif(st->wifs[(i + k) % BENCH_KEYS], key, &compressed);
+    return n;
+}
+
+static uint64_t stage_checksum(BenchState *st, uint64_t i, uint64_t n) {
+    size_t len = st->compressed ? WIF_PAYLOAD_MAX : WIF_PAYLOAD_MAX - 1;
+    for (uint64_t k = 0; k < n; ++k)
+        st->sink += sha256d_checksum(st->pubs[(i + k) % BENCH_KEYS], len - 4);
+    return n;
+}
+
+/* Checksums the way the solvers run them: 64 candidates per kernel call. */
+static uint64_t stage_checksum_batch(BenchState *st, uint64_t i, uint64_t n) {
+    uint64_t done = 0;
+    while (done < n) {
+        for (int k = 0; k < WIF_CHECK_BATCH; ++k)
+            wif_check_batch_add(&st->check, &st->nums[(i + done + k) % BENCH_KEYS]);
+        st->sink += (unsigned)wif_check_batch_run(&st->check);
+        done += WIF_CHECK_BATCH;
+    }
+    return done;
+}
+
+static uint64_t stage_ec_mul(BenchState *st, uint64_t i, uint64_t n) {
+    for (uint64_t k = 0; k < n; ++k)
+        st->sink += (unsigned)ec_point_set_scalar(st->ctx, &st->points[0],
+                                                  st->keys[(i + k) % BENCH_KEYS], 32, 0);
+    return n;
+}
+
+/* The OpenSSL EC_KEY path of generate_pubkey_hash_from_privkey(), for
+ * comparison. */
+static uint64_t stage_ec_mul_openssl(BenchState *st, uint64_t i, uint64_t n) {
+    unsigned char hash[20];
+    for (uint64_t k = 0; k < n; ++k)
+        st->sink += (unsigned)generate_pubkey_hash_from_privkey(st->keys[(i + k) % BENCH_KEYS],
+                                                                st->compressed, hash);
+    return n;
+}
+
+static uint64_t stage_hash160(BenchState *st, uint64_t i, uint64_t n) {
+    size_t len = st->compressed ? 33 : 65;
+    unsigned char hash[20];
+    for (uint64_t k = 0; k < n; ++k) {
+        hash160(st->pubs[(i + k) % BENCH_KEYS], len, hash);
+        st->sink += hash[0];
+    }
+    return n;
+}
+
+static uint64_t stage_hash160_batch(BenchState *st, uint64_t i, uint64_t n) {
+    size_t len = st->compressed ? 33 : 65;
+    uint64_t done = 0;
+    while (done < n) {
+        size_t first = (i + done) % (BENCH_KEYS - WIF_CHECK_BATCH);
+        hash160_batch(st->pubs[first], sizeof(st->pubs[0]), len, WIF_CHECK_BATCH, st->hashes);
+        st->sink += st->hashes[0];
+        done += WIF_CHECK_BATCH;
+    }
+    return done;
+}
+
+/* Serialization and hash160 of a batch of points, as the solvers hash
+ * their checksum survivors (the shared inversion is left out after the
+ * first round, the points stay affine). */
+static uint64_t stage_points_hash160(BenchState *st, uint64_t i, uint64_t n) {
+    uint64_t done = 0;
+    while (done < n) {
+        ec_points_hash160(st->ctx, st->points, WIF_CHECK_BATCH, st->compressed, st->hashes, NULL);
+        st->sink += st->hashes[0];
+        done += WIF_CHECK_BATCH;
+        (void)i;
+    }
+    return done;
+}
+
+typedef struct {
+    const char *name;
+    bench_fn fn;
+} BenchStage;
+
+static const BenchStage STAGES[] = {
+    {"base58_decode", stage_base58},
+    {"decode_wif", stage_decode_wif},
+    {"checksum", stage_checksum},
+    {"checksum_batch", stage_checksum_batch},
+    {"ec_mul", stage_ec_mul},
+    {"ec_mul_openssl", stage_ec_mul_openssl},
+    {"hash160", stage_hash160},
+    {"hash160_batch", stage_hash160_batch},
+    {"points_hash160", stage_points_hash160},
+};
+
+typedef struct {
+    const BenchStage *stage;
+    BenchState state;
+    int cpu;            /* as the solver would pin the thread */
+    double seconds;
+    uint64_t ops;
+    pthread_barrier_t *start;
+} BenchThread;
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static void *bench_thread(void *arg) {
+    BenchThread *t = arg;
+    double end;
+    topology_pin(t->cpu, NULL);
+    pthread_barrier_wait(t->start);
+    end = now() + t->seconds;
+    /* one warm-up round, then run until the time is up */
+    t->stage->fn(&t->state, 0, BENCH_POLL);
+    while (now() < end)
+        t->ops += t->stage->fn(&t->state, t->ops, BENCH_POLL);
+    return NULL;
+}
+
+static void print_result(int *first, const char *stage, int compressed, int threads,
+                         uint64_t ops, double elapsed) {
+    printf("%s\n    {\"stage\": \"%s\", \"keys\": \"%s\", \"threads\": %d, \"ops\": %llu, "
+           "\"seconds\": %.3f, \"ns_per_op\": %.2f, \"ops_per_sec\": %.0f}",
+           *first ? "" : ",", stage, compressed ? "compressed" : "uncompressed", threads,
+           (unsigned long long)ops, elapsed, elapsed * 1e9 * threads / (double)(ops ? ops : 1),
+           (double)ops / elapsed);
+    *first = 0;
+    fflush(stdout);
+}
+
+/* ns_per_op is the time one thread spends per operation; ops_per_sec is
+ * the throughput of all threads together. */
+static int run_stage(const BenchStage *stage, int compressed, int threads, double seconds,
+                     int *first) {
+    BenchThread *ts = calloc(threads, sizeof(BenchThread));
+    pthread_t *handles = calloc(threads, sizeof(pthread_t));
+    pthread_barrier_t start;
+    uint64_t ops = 0;
+    double t0;
+    int ok = ts && handles;
+
+    for (int i = 0; ok && i < threads; ++i) {
+        ts[i].stage = stage;
+        ts[i].cpu = topology_cpu(topology_get(), i);
+        ts[i].seconds = seconds;
+        ts[i].start = &start;
+        ok = bench_state_init(&ts[i].state, compressed, i);
+    }
+    if (ok) {
+        pthread_barrier_init(&start, NULL, threads + 1);
+        for (int i = 0; i < threads; ++i)
+            pthread_create(&handles[i], NULL, bench_thread, &ts[i]);
+        t0 = now();
+        pthread_barrier_wait(&start);
+        for (int i = 0; i < threads; ++i) {
+            pthread_join(handles[i], NULL);
+            ops += ts[i].ops;
+        }
+        print_result(first, stage->name, compressed, threads, ops, now() - t0);
+        pthread_barrier_destroy(&start);
+    }
+    for (int i = 0; ts && i < threads; ++i)
+        bench_state_clear(&ts[i].state);
+    free(ts);
+    free(handles);
+    return ok;
+}
+
+/* The whole solver, enumeration to address comparison, on a SEARCH job of
+ * four unknown characters (58^4 candidates) that has no solution.  The
+ * solver's own output is discarded. */
+static int run_pipeline(int compressed, int threads, int *first) {
+    Configuration *cfg = configuration_create(SEARCH_ADDRESS, SEARCH_WIF[compressed], "",
+                                              WORK_SEARCH, NULL);
+    Worker *w;
+    int out = dup(STDOUT_FILENO), null;
+    double t0, elapsed;
+
+    if (!cfg || out < 0)
+        return 0;
+    configuration_set_force_threads(cfg, &threads);
+    w = worker_create(cfg);
+    if (!w) {
+        configuration_free(cfg);
+        close(out);
+        return 0;
+    }
+    fflush(stdout);
+    null = open("/dev/null", O_WRONLY);
+    if (null >= 0) {
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    }
+    t0 = now();
+    worker_run(w);
+    elapsed = now() - t0;
+    fflush(stdout);
+    dup2(out, STDOUT_FILENO);
+    close(out);
+    print_result(first, "pipeline_search", compressed, threads, 58ULL * 58 * 58 * 58, elapsed);
+    worker_free(w);
+    configuration_free(cfg);
+    return 1;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: wifcrack-bench [--time SEC] [--threads N] [--stage NAME] "
+                    "[--gen-table FILE]\n"
+                    "Stages: pipeline_search");
+    for (size_t i = 0; i < sizeof(STAGES) / sizeof(STAGES[0]); ++i)
+        fprintf(stderr, " %s", STAGES[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv) {
+    double seconds = 0.5;
+    int all = scheduler_thread_count(NULL), first = 1;
+    const char *only = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            all = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stage") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (strcmp(argv[i], "--gen-table") == 0 && i + 1 < argc) {
+            if (!ec_gen_table_open(argv[++i])) {
+                fprintf(stderr, "Cannot use the generator table %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            usage();
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (seconds <= 0 || all < 1) {
+        usage();
+        return 1;
+    }
+
+    sha256_select_impl(SHA256_IMPL_AUTO);
+    printf("{\n  \"sha256\": \"%s\",\n  \"hash160\": \"%s\",\n  \"cpus\": %d,\n"
+           "  \"results\": [",
+           sha256_impl_name(), hash160_impl_name(), all);
+    for (int compressed = 1; compressed >= 0; --compressed) {
+        for (int threads = 1; threads <= all; threads = threads == all ? all + 1 : all) {
+            for (size_t i = 0; i < sizeof(STAGES) / sizeof(STAGES[0]); ++i) {
+                if (only && strcmp(only, STAGES[i].name) != 0)
+                    continue;
+                if (!run_stage(&STAGES[i], compressed, threads, seconds, &first))
+                    return 1;
+            }
+            if ((!only || strcmp(only, "pipeline_search") == 0) &&
+                !run_pipeline(compressed, threads, &first))
+                return 1;
+        }
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
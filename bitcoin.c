@@ -1,257 +1,1142 @@
-#include <string.h>
-#include <stdio.h>
-#include <openssl/ec.h>
-#include <openssl/sha.h>
-#include <openssl/ripemd.h>
-#include <openssl/obj_mac.h> // 比特币使用 secp256k1 曲线
-#include <openssl/bn.h>
-
-/**
- * @brief 从 ECC 私钥生成公钥，并计算其 SHA256 + RIPEMD160 哈希（公钥哈希）
- * @param priv_key_bytes 输入的私钥（32字节）
- * @param pubkey_hash_out 输出的公钥哈希（20字节）
- * @return 成功返回 1，失败返回 0
- */
-int generate_pubkey_hash_from_privkey(const unsigned char *priv_key_bytes, unsigned char *pubkey_hash_out) {
-    EC_KEY *key = NULL;
-    const EC_GROUP *group = NULL;
-    EC_POINT *pub_key = NULL;
-    unsigned char *pub_key_bytes = NULL;
-    size_t pub_key_len;
-    unsigned char sha256_hash[SHA256_DIGEST_LENGTH];
-    unsigned char ripemd160_hash[RIPEMD160_DIGEST_LENGTH];
-
-    // 创建新的 EC_KEY（使用比特币的 secp256k1 曲线）
-    key = EC_KEY_new_by_curve_name(NID_secp256k1);
-    if (!key) {
-        fprintf(stderr, "Error: Failed to create EC_KEY\n");
-        return 0;
-    }
-
-    // 设置私钥
-    if (!EC_KEY_oct2priv(key, priv_key_bytes, 32)) {
-        fprintf(stderr, "Error: Failed to set private key\n");
-        EC_KEY_free(key);
-        return 0;
-    }
-
-    // 生成公钥
-    group = EC_KEY_get0_group(key);
-    pub_key = EC_POINT_new(group);
-    if (!pub_key) {
-        fprintf(stderr, "Error: Failed to create EC_POINT\n");
-        EC_KEY_free(key);
-        return 0;
-    }
-
-    if (!EC_POINT_mul(group, pub_key, EC_KEY_get0_private_key(key), NULL, NULL, NULL)) {
-        fprintf(stderr, "Error: Failed to compute public key\n");
-        EC_POINT_free(pub_key);
-        EC_KEY_free(key);
-        return 0;
-    }
-
-    // 将公钥转换为压缩格式（33字节，0x02/0x03 + X）
-    pub_key_len = EC_POINT_point2oct(group, pub_key, POINT_CONVERSION_COMPRESSED, NULL, 0, NULL);
-    pub_key_bytes = (unsigned char *)malloc(pub_key_len);
-    if (!pub_key_bytes) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        EC_POINT_free(pub_key);
-        EC_KEY_free(key);
-        return 0;
-    }
-
-    EC_POINT_point2oct(group, pub_key, POINT_CONVERSION_COMPRESSED, pub_key_bytes, pub_key_len, NULL);
-
-    // 计算 SHA256(公钥)
-    SHA256(pub_key_bytes, pub_key_len, sha256_hash);
-
-    // 计算 RIPEMD160(SHA256(公钥)) → 20 字节公钥哈希
-    RIPEMD160(sha256_hash, SHA256_DIGEST_LENGTH, ripemd160_hash);
-
-    // 复制到输出
-    memcpy(pubkey_hash_out, ripemd160_hash, RIPEMD160_DIGEST_LENGTH);
-
-    // 清理资源
-    free(pub_key_bytes);
-    EC_POINT_free(pub_key);
-    EC_KEY_free(key);
-
-    return 1;
-}
-
-
-/**
- * @brief Base58 解码比特币地址，得到公钥哈希（20字节）
- * @param base58_addr 输入的比特币地址（Base58编码）
- * @param pubkey_hash_out 输出的公钥哈希（20字节）
- * @return 成功返回 1，失败返回 0
- */
-int base58_decode_bitcoin_address(const char *base58_addr, unsigned char *pubkey_hash_out) {
-    const char *base58_chars = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
-    BIGNUM *bn = BN_new();
-    BIGNUM *div = BN_new();
-    BIGNUM *rem = BN_new();
-    BN_CTX *ctx = BN_CTX_new();
-    unsigned char *decoded_bytes = NULL;
-    int i, leading_zeros = 0;
-    size_t decoded_len;
-
-    if (!bn || !div || !rem || !ctx) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        goto cleanup;
-    }
-
-    // 初始化 BN
-    BN_zero(bn);
-
-    // Base58 解码
-    for (i = 0; base58_addr[i]; i++) {
-        const char *p = strchr(base58_chars, base58_addr[i]);
-        if (!p) {
-            fprintf(stderr, "Error: Invalid Base58 character\n");
-            goto cleanup;
-        }
-
-        BN_mul_word(bn, 58);
-        BN_add_word(bn, p - base58_chars);
-    }
-
-    // 计算前导零（比特币地址可能以 '1' 开头）
-    for (i = 0; base58_addr[i] == '1'; i++) {
-        leading_zeros++;
-    }
-
-    // 转换为字节数组
-    decoded_len = BN_num_bytes(bn) + leading_zeros;
-    decoded_bytes = (unsigned char *)malloc(decoded_len);
-    if (!decoded_bytes) {
-        fprintf(stderr, "Error: Memory allocation failed\n");
-        goto cleanup;
-    }
-
-    // 填充前导零
-    memset(decoded_bytes, 0, leading_zeros);
-    BN_bn2bin(bn, decoded_bytes + leading_zeros);
-
-    // 比特币地址结构：1字节版本 + 20字节公钥哈希 + 4字节校验码
-    if (decoded_len != 25) {
-        fprintf(stderr, "Error: Invalid Bitcoin address length after decoding\n");
-        goto cleanup;
-    }
-
-    // 校验 checksum (最后4字节是前21字节的双SHA256哈希的前4字节)
-    unsigned char checksum[SHA256_DIGEST_LENGTH];
-    SHA256(decoded_bytes, 21, checksum);
-    SHA256(checksum, SHA256_DIGEST_LENGTH, checksum);
-
-    if (memcmp(checksum, decoded_bytes + 21, 4) != 0) {
-        fprintf(stderr, "Error: Invalid Bitcoin address checksum\n");
-        goto cleanup;
-    }
-
-    // 提取公钥哈希（20字节）
-    memcpy(pubkey_hash_out, decoded_bytes + 1, 20);
-
-    free(decoded_bytes);
-    BN_free(bn);
-    BN_free(div);
-    BN_free(rem);
-    BN_CTX_free(ctx);
-    return 1;
-
-cleanup:
-    if (decoded_bytes) free(decoded_bytes);
-    if (bn) BN_free(bn);
-    if (div) BN_free(div);
-    if (rem) BN_free(rem);
-    if (ctx) BN_CTX_free(ctx);
-    return 0;
-}
-
-/* Decode a Base58Check encoded WIF string to a 32 byte private key.  The
- * function performs a minimal validation of the checksum.  On success the
- * private key bytes are written to ``priv_key_out`` and ``compressed_out`` is
- * set to 1 when the key contains the optional compression flag.  Returns 1 on
- * success and 0 on failure. */
-int decode_wif(const char *wif, unsigned char *priv_key_out, int *compressed_out) {
-    const char *base58_chars =
-        "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
-    BIGNUM *bn = BN_new();
-    BIGNUM *div = BN_new();
-    BIGNUM *rem = BN_new();
-    BN_CTX *ctx = BN_CTX_new();
-    unsigned char *decoded = NULL;
-    int leading_zeros = 0;
-    size_t decoded_len;
-    int i;
-
-    if (compressed_out)
-        *compressed_out = 0;
-
-    if (!bn || !div || !rem || !ctx)
-        goto fail;
-
-    BN_zero(bn);
-
-    for (i = 0; wif[i]; i++) {
-        const char *p = strchr(base58_chars, wif[i]);
-        if (!p)
-            goto fail;
-        BN_mul_word(bn, 58);
-        BN_add_word(bn, p - base58_chars);
-    }
-
-    for (i = 0; wif[i] == '1'; i++)
-        leading_zeros++;
-
-    decoded_len = BN_num_bytes(bn) + leading_zeros;
-    decoded = malloc(decoded_len);
-    if (!decoded)
-        goto fail;
-
-    memset(decoded, 0, leading_zeros);
-    BN_bn2bin(bn, decoded + leading_zeros);
-
-    if (decoded_len != 37 && decoded_len != 38)
-        goto fail;
-
-    if (decoded[0] != 0x80)
-        goto fail;
-
-    /* verify checksum */
-    unsigned char checksum[SHA256_DIGEST_LENGTH];
-    SHA256(decoded, decoded_len - 4, checksum);
-    SHA256(checksum, SHA256_DIGEST_LENGTH, checksum);
-    if (memcmp(checksum, decoded + decoded_len - 4, 4) != 0)
-        goto fail;
-
-    memcpy(priv_key_out, decoded + 1, 32);
-
-    if (decoded_len == 38) {
-        if (decoded[33] != 0x01)
-            goto fail;
-        if (compressed_out)
-            *compressed_out = 1;
-    }
-
-    free(decoded);
-    BN_free(bn);
-    BN_free(div);
-    BN_free(rem);
-    BN_CTX_free(ctx);
-    return 1;
-
-fail:
-    if (decoded)
-        free(decoded);
-    if (bn)
-        BN_free(bn);
-    if (div)
-        BN_free(div);
-    if (rem)
-        BN_free(rem);
-    if (ctx)
-        BN_CTX_free(ctx);
-    return 0;
-}
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/ec.h>
+#include <openssl/sha.h>
+#include <openssl/obj_mac.h> // 比特币使用 secp256k1 曲线
+#include <openssl/bn.h>
+#include "bitcoin.h"
+#include "hash.h"
+
+const char BASE58_ALPHABET[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+static const signed char BASE58_MAP[128] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, -1, -1, -1, -1, -1, -1,
+    -1, 9, 10, 11, 12, 13, 14, 15, 16, -1, 17, 18, 19, 20, 21, -1,
+    22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, -1, -1, -1, -1, -1,
+    -1, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, -1, 44, 45, 46,
+    47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, -1, -1, -1, -1, -1,
+};
+
+/* Returns the Base58 value of ``c`` or -1 when it is not part of the alphabet. */
+int base58_digit(char c) {
+    unsigned char u = (unsigned char)c;
+    return u < 128 ? BASE58_MAP[u] : -1;
+}
+
+/**
+ * @brief 从 ECC 私钥生成公钥，并计算其 SHA256 + RIPEMD160 哈希（公钥哈希）
+ * @param priv_key_bytes 输入的私钥（32字节）
+ * @param compressed 公钥是否按压缩格式序列化
+ * @param pubkey_hash_out 输出的公钥哈希（20字节）
+ * @return 成功返回 1，失败返回 0
+ */
+int generate_pubkey_hash_from_privkey(const unsigned char *priv_key_bytes, int compressed,
+                                      unsigned char *pubkey_hash_out) {
+    EC_KEY *key = NULL;
+    const EC_GROUP *group = NULL;
+    EC_POINT *pub_key = NULL;
+    unsigned char pub_key_bytes[65];
+    size_t pub_key_len;
+
+    // 创建新的 EC_KEY（使用比特币的 secp256k1 曲线）
+    key = EC_KEY_new_by_curve_name(NID_secp256k1);
+    if (!key) {
+        fprintf(stderr, "Error: Failed to create EC_KEY\n");
+        return 0;
+    }
+
+    // 设置私钥
+    if (!EC_KEY_oct2priv(key, priv_key_bytes, 32)) {
+        fprintf(stderr, "Error: Failed to set private key\n");
+        EC_KEY_free(key);
+        return 0;
+    }
+
+    // 生成公钥
+    group = EC_KEY_get0_group(key);
+    pub_key = EC_POINT_new(group);
+    if (!pub_key) {
+        fprintf(stderr, "Error: Failed to create EC_POINT\n");
+        EC_KEY_free(key);
+        return 0;
+    }
+
+    if (!EC_POINT_mul(group, pub_key, EC_KEY_get0_private_key(key), NULL, NULL, NULL)) {
+        fprintf(stderr, "Error: Failed to compute public key\n");
+        EC_POINT_free(pub_key);
+        EC_KEY_free(key);
+        return 0;
+    }
+
+    // 序列化公钥：压缩格式 33 字节（0x02/0x03 + X），非压缩 65 字节（0x04 + X + Y）
+    pub_key_len = EC_POINT_point2oct(group, pub_key,
+                                     compressed ? POINT_CONVERSION_COMPRESSED
+                                                : POINT_CONVERSION_UNCOMPRESSED,
+                                     pub_key_bytes, sizeof(pub_key_bytes), NULL);
+    if (pub_key_len == 0) {
+        fprintf(stderr, "Error: Failed to serialize public key\n");
+        EC_POINT_free(pub_key);
+        EC_KEY_free(key);
+        return 0;
+    }
+
+    // 计算 RIPEMD160(SHA256(公钥)) → 20 字节公钥哈希
+    hash160(pub_key_bytes, pub_key_len, pubkey_hash_out);
+
+    // 清理资源
+    EC_POINT_free(pub_key);
+    EC_KEY_free(key);
+
+    return 1;
+}
+
+
+/* Big-endian value of the 4 checksum bytes at the end of a payload */
+static uint32_t payload_checksum(const unsigned char *payload, size_t len) {
+    return (uint32_t)payload[len - 4] << 24 | (uint32_t)payload[len - 3] << 16 |
+           (uint32_t)payload[len - 2] << 8 | payload[len - 1];
+}
+
+/**
+ * @brief Base58 解码比特币地址，得到公钥哈希（20字节）
+ * @param base58_addr 输入的比特币地址（Base58编码）
+ * @param pubkey_hash_out 输出的公钥哈希（20字节）
+ * @return 成功返回版本字节，失败返回 -1
+ */
+static int base58_decode_address_version(const char *base58_addr, unsigned char *pubkey_hash_out) {
+    unsigned char bytes[WIF_NUM_LIMBS * 8];
+    const unsigned char *decoded = bytes + sizeof(bytes) - 25;
+    size_t leading_zeros = 0, start = 0;
+    wif_num n;
+
+    /* 地址解码进定长整数，不分配内存（目标集可能有上百万个地址） */
+    if (strnlen(base58_addr, WIF_CHARS_MAX + 1) > WIF_CHARS_MAX) {
+        fprintf(stderr, "Error: Invalid Bitcoin address length after decoding\n");
+        return -1;
+    }
+    if (!wif_num_from_base58(&n, base58_addr)) {
+        fprintf(stderr, "Error: Invalid Base58 character\n");
+        return -1;
+    }
+
+    // 计算前导零（比特币地址可能以 '1' 开头）
+    while (base58_addr[leading_zeros] == '1')
+        leading_zeros++;
+    wif_num_to_bytes(&n, bytes, sizeof(bytes));
+    while (start < sizeof(bytes) && bytes[start] == 0)
+        start++;
+
+    // 比特币地址结构：1字节版本 + 20字节公钥哈希 + 4字节校验码
+    if (sizeof(bytes) - start + leading_zeros != 25) {
+        fprintf(stderr, "Error: Invalid Bitcoin address length after decoding\n");
+        return -1;
+    }
+
+    // 校验 checksum (最后4字节是前21字节的双SHA256哈希的前4字节)
+    if (sha256d_checksum(decoded, 21) != payload_checksum(decoded, 25)) {
+        fprintf(stderr, "Error: Invalid Bitcoin address checksum\n");
+        return -1;
+    }
+
+    // 提取公钥哈希（20字节）
+    memcpy(pubkey_hash_out, decoded + 1, 20);
+    return decoded[0];
+}
+
+int base58_decode_bitcoin_address(const char *base58_addr, unsigned char *pubkey_hash_out) {
+    return base58_decode_address_version(base58_addr, pubkey_hash_out) >= 0;
+}
+
+static const char BECH32_CHARSET[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+static uint32_t bech32_polymod_step(uint32_t chk, int value) {
+    static const uint32_t GEN[5] = {0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3};
+    uint32_t top = chk >> 25;
+    chk = (chk & 0x1ffffff) << 5 ^ (uint32_t)value;
+    for (int i = 0; i < 5; i++)
+        if (top >> i & 1)
+            chk ^= GEN[i];
+    return chk;
+}
+
+/* A version 0 witness program of 20 bytes (BIP 173), "bc1q..." in one
+ * case.  Returns 1 and the key hash, or 0. */
+static int bech32_decode_p2wpkh(const char *addr, unsigned char *hash_out) {
+    size_t len = strnlen(addr, 91), sep = 0, bits = 0, n = 0;
+    int lower = 0, upper = 0;
+    uint32_t chk = 1, acc = 0;
+    int values[90];
+
+    if (len < 8 || len > 90)
+        return 0;
+    for (size_t i = 0; i < len; i++) {
+        lower |= addr[i] >= 'a' && addr[i] <= 'z';
+        upper |= addr[i] >= 'A' && addr[i] <= 'Z';
+        if (addr[i] == '1')
+            sep = i;
+    }
+    if ((lower && upper) || sep != 2 || (addr[0] | 0x20) != 'b' || (addr[1] | 0x20) != 'c')
+        return 0;
+    /* the human readable part, expanded */
+    for (size_t i = 0; i < sep; i++)
+        chk = bech32_polymod_step(chk, (addr[i] | 0x20) >> 5);
+    chk = bech32_polymod_step(chk, 0);
+    for (size_t i = 0; i < sep; i++)
+        chk = bech32_polymod_step(chk, (addr[i] | 0x20) & 31);
+    for (size_t i = sep + 1; i < len; i++) {
+        const char *c = strchr(BECH32_CHARSET, addr[i] | 0x20);
+        if (!c)
+            return 0;
+        values[i - sep - 1] = (int)(c - BECH32_CHARSET);
+        chk = bech32_polymod_step(chk, values[i - sep - 1]);
+    }
+    len -= sep + 1;
+    /* checksum constant 1 is bech32, as witness version 0 requires */
+    if (chk != 1 || len < 7 || values[0] != 0)
+        return 0;
+    /* witness version, program in 5 bit groups, 6 checksum characters */
+    for (size_t i = 1; i < len - 6; i++) {
+        acc = acc << 5 | (uint32_t)values[i];
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            if (n == 20)
+                return 0;
+            hash_out[n++] = (unsigned char)(acc >> bits);
+        }
+    }
+    return n == 20 && bits < 5 && (acc & ((1U << bits) - 1)) == 0;
+}
+
+address_type decode_bitcoin_address(const char *address, unsigned char *hash_out) {
+    int version;
+    if ((address[0] | 0x20) == 'b' && (address[1] | 0x20) == 'c' && address[2] == '1') {
+        if (bech32_decode_p2wpkh(address, hash_out))
+            return ADDRESS_P2WPKH;
+        fprintf(stderr, "Error: Invalid or unsupported bech32 address\n");
+        return ADDRESS_INVALID;
+    }
+    version = base58_decode_address_version(address, hash_out);
+    if (version == 0x00)
+        return ADDRESS_P2PKH;
+    if (version == 0x05)
+        return ADDRESS_P2SH;
+    if (version > 0)
+        fprintf(stderr, "Error: Unsupported address version %d\n", version);
+    return ADDRESS_INVALID;
+}
+
+/* Base58Check of a version byte and a 20 byte hash: every leading zero
+ * byte is a '1', the rest is the number. */
+static void base58_encode_address(int version, const unsigned char *hash, char *out) {
+    unsigned char payload[25];
+    uint32_t sum;
+    wif_num n = {{0, 0, 0, 0, 0}};
+    char digits[35];
+    size_t zeros = 0, skip = 0;
+
+    payload[0] = (unsigned char)version;
+    memcpy(payload + 1, hash, 20);
+    sum = sha256d_checksum(payload, 21);
+    for (int i = 0; i < 4; i++)
+        payload[21 + i] = (unsigned char)(sum >> (24 - 8 * i));
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        size_t byte = sizeof(payload) - 1 - i;
+        n.v[byte / 8] |= (uint64_t)payload[i] << (8 * (byte % 8));
+    }
+    wif_num_to_base58(&n, digits, 34);
+    while (zeros < sizeof(payload) && payload[zeros] == 0)
+        zeros++;
+    while (digits[skip] == '1')
+        skip++;
+    memset(out, '1', zeros);
+    strcpy(out + zeros, digits + skip);
+}
+
+/* "bc1q" and the 20 byte program in 5 bit groups, then the bech32
+ * checksum over the expanded "bc" and the data. */
+static void bech32_encode_p2wpkh(const unsigned char *hash, char *out) {
+    int values[33 + 6];
+    uint32_t chk = 1, acc = 0;
+    size_t n = 0, bits = 0;
+
+    values[n++] = 0;
+    for (int i = 0; i < 20; i++) {
+        acc = acc << 8 | hash[i];
+        for (bits += 8; bits >= 5; bits -= 5)
+            values[n++] = (int)(acc >> (bits - 5) & 31);
+    }
+    chk = bech32_polymod_step(chk, 'b' >> 5);
+    chk = bech32_polymod_step(chk, 'c' >> 5);
+    chk = bech32_polymod_step(chk, 0);
+    chk = bech32_polymod_step(chk, 'b' & 31);
+    chk = bech32_polymod_step(chk, 'c' & 31);
+    for (size_t i = 0; i < n; i++)
+        chk = bech32_polymod_step(chk, values[i]);
+    for (int i = 0; i < 6; i++)
+        chk = bech32_polymod_step(chk, 0);
+    chk ^= 1;
+    for (int i = 0; i < 6; i++)
+        values[n++] = (int)(chk >> (5 * (5 - i)) & 31);
+    memcpy(out, "bc1", 3);
+    for (size_t i = 0; i < n; i++)
+        out[3 + i] = BECH32_CHARSET[values[i]];
+    out[3 + n] = '\0';
+}
+
+int encode_bitcoin_address(address_type type, const unsigned char *hash, char *out) {
+    switch (type) {
+    case ADDRESS_P2PKH:
+        base58_encode_address(0x00, hash, out);
+        return 1;
+    case ADDRESS_P2SH:
+        base58_encode_address(0x05, hash, out);
+        return 1;
+    case ADDRESS_P2WPKH:
+        bech32_encode_p2wpkh(hash, out);
+        return 1;
+    default:
+        out[0] = '\0';
+        return 0;
+    }
+}
+
+/* Decode a Base58Check encoded WIF string to a 32 byte private key.  The
+ * function performs a minimal validation of the checksum.  On success the
+ * private key bytes are written to ``priv_key_out`` and ``compressed_out`` is
+ * set to 1 when the key contains the optional compression flag.  Returns 1 on
+ * success and 0 on failure.  Nothing is allocated. */
+int decode_wif(const char *wif, unsigned char *priv_key_out, int *compressed_out) {
+    wif_num n;
+
+    if (compressed_out)
+        *compressed_out = 0;
+    /* longer strings could overflow the wif_num and are no WIF anyway */
+    if (strnlen(wif, WIF_CHARS_MAX + 1) > WIF_CHARS_MAX)
+        return 0;
+    if (!wif_num_from_base58(&n, wif))
+        return 0;
+    if (wif_num_check_payload(&n, 1, priv_key_out)) {
+        if (compressed_out)
+            *compressed_out = 1;
+        return 1;
+    }
+    return wif_num_check_payload(&n, 0, priv_key_out);
+}
+
+/* Decode a Base58 string into a fixed width number.  Returns 0 when the
+ * string contains a character outside of the Base58 alphabet. */
+int wif_num_from_base58(wif_num *r, const char *s) {
+    return wif_num_from_base58_len(r, s, strlen(s));
+}
+
+int wif_num_from_base58_len(wif_num *r, const char *s, size_t len) {
+    memset(r, 0, sizeof(*r));
+    for (size_t i = 0; i < len; i++) {
+        int d = base58_digit(s[i]);
+        if (d < 0)
+            return 0;
+        wif_num_mul_word(r, 58);
+        wif_num d_num = {{(uint64_t)d, 0, 0, 0, 0}};
+        wif_num_add(r, &d_num);
+    }
+    return 1;
+}
+
+/* r = 58^exp */
+void wif_num_set_pow58(wif_num *r, int exp) {
+    memset(r, 0, sizeof(*r));
+    r->v[0] = 1;
+    while (exp-- > 0)
+        wif_num_mul_word(r, 58);
+}
+
+void wif_num_mul_word(wif_num *r, uint64_t w) {
+    unsigned __int128 carry = 0;
+    for (int i = 0; i < WIF_NUM_LIMBS; i++) {
+        carry += (unsigned __int128)r->v[i] * w;
+        r->v[i] = (uint64_t)carry;
+        carry >>= 64;
+    }
+}
+
+void wif_num_add(wif_num *r, const wif_num *a) {
+    unsigned __int128 carry = 0;
+    for (int i = 0; i < WIF_NUM_LIMBS; i++) {
+        carry += (unsigned __int128)r->v[i] + a->v[i];
+        r->v[i] = (uint64_t)carry;
+        carry >>= 64;
+    }
+}
+
+void wif_num_sub(wif_num *r, const wif_num *a) {
+    uint64_t borrow = 0;
+    for (int i = 0; i < WIF_NUM_LIMBS; i++) {
+        uint64_t x = r->v[i];
+        uint64_t y = a->v[i] + borrow;
+        borrow = (y < borrow) || (x < y);
+        r->v[i] = x - y;
+    }
+}
+
+int wif_num_cmp(const wif_num *a, const wif_num *b) {
+    for (int i = WIF_NUM_LIMBS - 1; i >= 0; i--) {
+        if (a->v[i] != b->v[i])
+            return a->v[i] < b->v[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+void wif_num_shr(wif_num *r, const wif_num *a, int bits) {
+    int limbs = bits / 64;
+    int rem = bits % 64;
+    wif_num t;
+    for (int i = 0; i < WIF_NUM_LIMBS; i++) {
+        uint64_t lo = (i + limbs < WIF_NUM_LIMBS) ? a->v[i + limbs] : 0;
+        uint64_t hi = (i + limbs + 1 < WIF_NUM_LIMBS) ? a->v[i + limbs + 1] : 0;
+        t.v[i] = rem ? (lo >> rem) | (hi << (64 - rem)) : lo;
+    }
+    *r = t;
+}
+
+/* Write the low ``len`` bytes of ``a`` in big-endian order. */
+void wif_num_to_bytes(const wif_num *a, unsigned char *out, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        size_t byte = len - 1 - i;
+        out[i] = byte < WIF_NUM_LIMBS * 8 ? (unsigned char)(a->v[byte / 8] >> (8 * (byte % 8))) : 0;
+    }
+}
+
+/* The payload ends with 4 checksum bytes, preceded by the 0x01 flag for
+ * compressed keys, and starts with the 0x80 version byte. */
+static int payload_prefix_ok(const wif_num *n, int compressed) {
+    if (n->v[4] >> (compressed ? 40 : 32) != 0x80)
+        return 0;
+    return !compressed || ((n->v[0] >> 32) & 0xFF) == 0x01;
+}
+
+/* Big-endian bytes of ``n``; the payload is the last 37 or 38 of them. */
+static void payload_bytes(const wif_num *n, unsigned char *bytes) {
+    for (int i = 0; i < WIF_NUM_LIMBS; i++) {
+        uint64_t be = __builtin_bswap64(n->v[WIF_NUM_LIMBS - 1 - i]);
+        memcpy(bytes + 8 * i, &be, 8);
+    }
+}
+
+/* Check that ``n`` is the Base58 value of a well formed WIF payload: 0x80
+ * prefix, 0x01 compression flag for compressed keys and a valid double
+ * SHA256 checksum.  The cheap byte checks run first, straight on the limbs.
+ * On success the 32 key bytes are written to ``key_out`` unless it is NULL.
+ * Returns 1 on success. */
+int wif_num_check_payload(const wif_num *n, int compressed, unsigned char *key_out) {
+    size_t len = compressed ? WIF_PAYLOAD_MAX : WIF_PAYLOAD_MAX - 1;
+    unsigned char bytes[WIF_NUM_LIMBS * 8];
+    const unsigned char *payload = bytes + sizeof(bytes) - len;
+
+    if (!payload_prefix_ok(n, compressed))
+        return 0;
+    payload_bytes(n, bytes);
+    if (sha256d_checksum(payload, len - 4) != payload_checksum(payload, len))
+        return 0;
+    if (key_out)
+        memcpy(key_out, payload + 1, 32);
+    return 1;
+}
+
+void wif_check_batch_init(WifCheckBatch *b, int compressed) {
+    b->compressed = compressed;
+    b->count = 0;
+}
+
+/* Queue ``n`` for the checksum test unless its version byte or compression
+ * flag already rule it out.  Returns 1 once the batch is full. */
+int wif_check_batch_add(WifCheckBatch *b, const wif_num *n) {
+    if (!payload_prefix_ok(n, b->compressed))
+        return 0;
+    b->nums[b->count] = *n;
+    payload_bytes(n, b->bytes[b->count]);
+    return ++b->count == WIF_CHECK_BATCH;
+}
+
+/* Compute the checksums of every queued candidate at once.  The survivors
+ * are moved to the front of the batch, their count is returned and the
+ * batch is emptied for the next round. */
+size_t wif_check_batch_run(WifCheckBatch *b) {
+    size_t len = b->compressed ? WIF_PAYLOAD_MAX : WIF_PAYLOAD_MAX - 1;
+    size_t offset = WIF_NUM_LIMBS * 8 - len;
+    size_t pass = 0;
+
+    sha256d_checksum_batch(b->bytes[0] + offset, sizeof(b->bytes[0]), len - 4, b->count, b->sums);
+    for (size_t i = 0; i < b->count; i++) {
+        if (b->sums[i] != payload_checksum(b->bytes[i] + offset, len))
+            continue;
+        if (pass != i) {
+            b->nums[pass] = b->nums[i];
+            memcpy(b->bytes[pass], b->bytes[i], sizeof(b->bytes[i]));
+        }
+        pass++;
+    }
+    b->count = 0;
+    return pass;
+}
+
+/* Key bytes of the i-th survivor of the last wif_check_batch_run(). */
+const unsigned char *wif_check_batch_key(const WifCheckBatch *b, size_t i) {
+    size_t len = b->compressed ? WIF_PAYLOAD_MAX : WIF_PAYLOAD_MAX - 1;
+    return b->bytes[i] + WIF_NUM_LIMBS * 8 - len + 1;
+}
+
+#define POW58_10 430804206899405824ULL /* 58^10, the largest power in 64 bits */
+
+/* Base58 encode ``n`` into exactly ``len`` characters plus a terminator.
+ * The number is divided by 58^10 at a time, so the long division runs over
+ * the limbs only 6 times for a WIF and the digits come from 64 bit words. */
+void wif_num_to_base58(const wif_num *n, char *out, int len) {
+    wif_num t = *n;
+    int top = WIF_NUM_LIMBS - 1;
+    int i = len;
+    out[len] = '\0';
+    while (i > 0) {
+        unsigned __int128 rem = 0;
+        uint64_t chunk;
+        while (top > 0 && t.v[top] == 0)
+            top--;
+        for (int k = top; k >= 0; k--) {
+            unsigned __int128 cur = (rem << 64) | t.v[k];
+            t.v[k] = (uint64_t)(cur / POW58_10);
+            rem = cur % POW58_10;
+        }
+        chunk = (uint64_t)rem;
+        for (int j = 0; j < 10 && i > 0; j++) {
+            out[--i] = BASE58_ALPHABET[chunk % 58];
+            chunk /= 58;
+        }
+    }
+}
+
+/* The order n of secp256k1, big-endian. */
+static const unsigned char SECP256K1_ORDER[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE,
+    0xBA, 0xAE, 0xDC, 0xE6, 0xAF, 0x48, 0xA0, 0x3B, 0xBF, 0xD2, 0x5E, 0x8C, 0xD0, 0x36, 0x41, 0x41};
+
+int private_key_valid(const unsigned char *key) {
+    static const unsigned char zero[32];
+    return memcmp(key, zero, 32) != 0 && memcmp(key, SECP256K1_ORDER, 32) < 0;
+}
+
+/* Base58Check encode the WIF of a 32 byte private key into ``out``, which
+ * needs room for WIF_CHARS_MAX + 1 characters.  Returns the length. */
+int encode_wif(const unsigned char *key, int compressed, char *out) {
+    size_t len = compressed ? WIF_PAYLOAD_MAX : WIF_PAYLOAD_MAX - 1;
+    unsigned char payload[WIF_PAYLOAD_MAX];
+    uint32_t sum;
+    wif_num n = {{0, 0, 0, 0, 0}};
+
+    payload[0] = 0x80;
+    memcpy(payload + 1, key, 32);
+    payload[33] = 0x01;
+    sum = sha256d_checksum(payload, len - 4);
+    payload[len - 4] = (unsigned char)(sum >> 24);
+    payload[len - 3] = (unsigned char)(sum >> 16);
+    payload[len - 2] = (unsigned char)(sum >> 8);
+    payload[len - 1] = (unsigned char)sum;
+    for (size_t i = 0; i < len; i++) {
+        size_t byte = len - 1 - i;
+        n.v[byte / 8] |= (uint64_t)payload[i] << (8 * (byte % 8));
+    }
+    wif_num_to_base58(&n, out, compressed ? WIF_CHARS_MAX : WIF_CHARS_MAX - 1);
+    return compressed ? WIF_CHARS_MAX : WIF_CHARS_MAX - 1;
+}
+
+#ifdef WIFCRACK_OPENSSL_EC
+
+struct ec_context {
+    EC_GROUP *group;
+    BN_CTX *bn_ctx;
+    BIGNUM *order;
+    BIGNUM *scalar;
+    EC_POINT **batch;       /* scratch for batched normalization */
+    size_t batch_capacity;
+};
+
+ec_context *ec_context_create(void) {
+    ec_context *ctx = calloc(1, sizeof(ec_context));
+    if (!ctx)
+        return NULL;
+    ctx->group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    ctx->bn_ctx = BN_CTX_new();
+    ctx->order = BN_new();
+    ctx->scalar = BN_new();
+    if (!ctx->group || !ctx->bn_ctx || !ctx->order || !ctx->scalar ||
+        !EC_GROUP_get_order(ctx->group, ctx->order, ctx->bn_ctx)) {
+        fprintf(stderr, "Error: Failed to create EC context\n");
+        ec_context_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void ec_context_free(ec_context *ctx) {
+    if (!ctx)
+        return;
+    free(ctx->batch);
+    BN_free(ctx->scalar);
+    BN_free(ctx->order);
+    BN_CTX_free(ctx->bn_ctx);
+    EC_GROUP_free(ctx->group);
+    free(ctx);
+}
+
+/* Size the normalization scratch for batches of up to ``n`` points, so that
+ * a thread can set it up once and never allocate while it runs. */
+int ec_context_reserve(ec_context *ctx, size_t n) {
+    EC_POINT **tmp;
+    if (n <= ctx->batch_capacity)
+        return 1;
+    tmp = realloc(ctx->batch, n * sizeof(EC_POINT *));
+    if (!tmp)
+        return 0;
+    ctx->batch = tmp;
+    ctx->batch_capacity = n;
+    return 1;
+}
+
+int ec_point_init(ec_context *ctx, ec_point *p) {
+    p->pt = EC_POINT_new(ctx->group);
+    return p->pt != NULL;
+}
+
+void ec_point_clear(ec_point *p) {
+    EC_POINT_free(p->pt);
+    p->pt = NULL;
+}
+
+int ec_point_copy(ec_point *r, const ec_point *a) {
+    return EC_POINT_copy(r->pt, a->pt);
+}
+
+/* p = (+/-scalar mod n) * G, where ``scalar`` is a big-endian number of any
+ * length. */
+int ec_point_set_scalar(ec_context *ctx, ec_point *p, const unsigned char *scalar,
+                        size_t len, int negative) {
+    if (!BN_bin2bn(scalar, (int)len, ctx->scalar) ||
+        !BN_nnmod(ctx->scalar, ctx->scalar, ctx->order, ctx->bn_ctx))
+        return 0;
+    if (negative && !BN_is_zero(ctx->scalar) &&
+        !BN_sub(ctx->scalar, ctx->order, ctx->scalar))
+        return 0;
+    return EC_POINT_mul(ctx->group, p->pt, ctx->scalar, NULL, NULL, ctx->bn_ctx);
+}
+
+int ec_point_add(ec_context *ctx, ec_point *r, const ec_point *a, const ec_point *b) {
+    return EC_POINT_add(ctx->group, r->pt, a->pt, b->pt, ctx->bn_ctx);
+}
+
+int ec_point_negate(ec_context *ctx, ec_point *p) {
+    return EC_POINT_invert(ctx->group, p->pt, ctx->bn_ctx);
+}
+
+/* Convert the points to affine coordinates so that later additions with
+ * them take the cheaper mixed path, and serialization needs no inversion.
+ * All points share a single field inversion (Montgomery's simultaneous
+ * inversion, about 3 multiplications per point). */
+int ec_points_normalize(ec_context *ctx, ec_point *points, size_t n) {
+    if (n == 0)
+        return 1;
+    if (!ec_context_reserve(ctx, n))
+        return 0;
+    for (size_t i = 0; i < n; i++)
+        ctx->batch[i] = points[i].pt;
+    return EC_POINTs_make_affine(ctx->group, n, ctx->batch, ctx->bn_ctx);
+}
+
+/* Write the SEC encoding of the point (33 or 65 bytes) to ``out``; returns
+ * its length, or 0 for the point at infinity. */
+static size_t ec_point_serialize(ec_context *ctx, const ec_point *p, int compressed,
+                                 unsigned char *out) {
+    if (EC_POINT_is_at_infinity(ctx->group, p->pt))
+        return 0;
+    return EC_POINT_point2oct(ctx->group, p->pt,
+                              compressed ? POINT_CONVERSION_COMPRESSED : POINT_CONVERSION_UNCOMPRESSED,
+                              out, 65, ctx->bn_ctx);
+}
+
+/* The generator table is one of the native backend; OpenSSL has its own. */
+int ec_gen_table_open(const char *path) {
+    (void)path;
+    return 0;
+}
+
+void ec_gen_table_close(void) {}
+
+#else
+
+/* Native backend (secp256k1.c).  OpenSSL is only used to reduce scalars
+ * longer than 32 bytes, which happens while tables are built. */
+struct ec_context {
+    BN_CTX *bn_ctx;
+    BIGNUM *order;
+    BIGNUM *scalar;
+    secp_fe *batch;         /* scratch for batched normalization */
+    secp_fe *batch_inv;
+    size_t batch_capacity;
+};
+
+static const char SECP256K1_ORDER_HEX[] =
+    "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141";
+
+ec_context *ec_context_create(void) {
+    ec_context *ctx = calloc(1, sizeof(ec_context));
+    if (!ctx)
+        return NULL;
+    ctx->bn_ctx = BN_CTX_new();
+    ctx->scalar = BN_new();
+    if (!ctx->bn_ctx || !ctx->scalar || !BN_hex2bn(&ctx->order, SECP256K1_ORDER_HEX)) {
+        fprintf(stderr, "Error: Failed to create EC context\n");
+        ec_context_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void ec_context_free(ec_context *ctx) {
+    if (!ctx)
+        return;
+    free(ctx->batch);
+    free(ctx->batch_inv);
+    BN_free(ctx->scalar);
+    BN_free(ctx->order);
+    BN_CTX_free(ctx->bn_ctx);
+    free(ctx);
+}
+
+/* Size the normalization scratch for batches of up to ``n`` points, so that
+ * a thread can set it up once and never allocate while it runs. */
+int ec_context_reserve(ec_context *ctx, size_t n) {
+    secp_fe *z;
+    if (n <= ctx->batch_capacity)
+        return 1;
+    z = realloc(ctx->batch, n * sizeof(secp_fe));
+    if (!z)
+        return 0;
+    ctx->batch = z;
+    z = realloc(ctx->batch_inv, n * sizeof(secp_fe));
+    if (!z)
+        return 0;
+    ctx->batch_inv = z;
+    ctx->batch_capacity = n;
+    return 1;
+}
+
+int ec_point_init(ec_context *ctx, ec_point *p) {
+    (void)ctx;
+    secp_gej_set_infinity(&p->pt);
+    p->affine = 0;
+    return 1;
+}
+
+void ec_point_clear(ec_point *p) {
+    (void)p;
+}
+
+int ec_point_copy(ec_point *r, const ec_point *a) {
+    *r = *a;
+    return 1;
+}
+
+/* p = (+/-scalar mod n) * G, where ``scalar`` is a big-endian number of any
+ * length. */
+int ec_point_set_scalar(ec_context *ctx, ec_point *p, const unsigned char *scalar,
+                        size_t len, int negative) {
+    unsigned char k[32];
+    if (len <= 32) {
+        memset(k, 0, 32 - len);
+        memcpy(k + 32 - len, scalar, len);
+        secp_scalar_reduce(k, k);
+    } else if (!BN_bin2bn(scalar, (int)len, ctx->scalar) ||
+               !BN_nnmod(ctx->scalar, ctx->scalar, ctx->order, ctx->bn_ctx) ||
+               BN_bn2binpad(ctx->scalar, k, 32) != 32) {
+        return 0;
+    }
+    secp_ecmult_gen(&p->pt, k);
+    if (negative)
+        secp_gej_neg(&p->pt, &p->pt);
+    p->affine = 0;
+    return 1;
+}
+
+static void ec_point_to_ge(secp_ge *r, const ec_point *a) {
+    r->x = a->pt.x;
+    r->y = a->pt.y;
+    r->infinity = a->pt.infinity;
+}
+
+int ec_point_add(ec_context *ctx, ec_point *r, const ec_point *a, const ec_point *b) {
+    secp_ge g;
+    (void)ctx;
+    if (b->affine) {
+        ec_point_to_ge(&g, b);
+        secp_gej_add_ge(&r->pt, &a->pt, &g);
+    } else if (a->affine) {
+        ec_point_to_ge(&g, a);
+        secp_gej_add_ge(&r->pt, &b->pt, &g);
+    } else {
+        secp_gej_add(&r->pt, &a->pt, &b->pt);
+    }
+    r->affine = 0;
+    return 1;
+}
+
+int ec_point_negate(ec_context *ctx, ec_point *p) {
+    (void)ctx;
+    secp_gej_neg(&p->pt, &p->pt);
+    if (p->affine)
+        secp_fe_normalize(&p->pt.y);
+    return 1;
+}
+
+/* Convert the points to affine coordinates so that later additions with
+ * them take the cheaper mixed path, and serialization needs no inversion.
+ * All points share a single field inversion (Montgomery's simultaneous
+ * inversion, about 3 multiplications per point). */
+int ec_points_normalize(ec_context *ctx, ec_point *points, size_t n) {
+    size_t m = 0;
+    if (!ec_context_reserve(ctx, n))
+        return 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!points[i].affine && !points[i].pt.infinity)
+            ctx->batch[m++] = points[i].pt.z;
+    }
+    secp_fe_inv_all(ctx->batch_inv, ctx->batch, m);
+
+    m = 0;
+    for (size_t i = 0; i < n; i++) {
+        secp_gej *p = &points[i].pt;
+        secp_fe zi2, zi3;
+        if (points[i].affine)
+            continue;
+        points[i].affine = 1;
+        if (p->infinity)
+            continue;
+        secp_fe_sqr(&zi2, &ctx->batch_inv[m]);
+        secp_fe_mul(&zi3, &zi2, &ctx->batch_inv[m]);
+        secp_fe_mul(&p->x, &p->x, &zi2);
+        secp_fe_mul(&p->y, &p->y, &zi3);
+        secp_fe_normalize(&p->x);
+        secp_fe_normalize(&p->y);
+        memset(&p->z, 0, sizeof(p->z));
+        p->z.n[0] = 1;
+        m++;
+    }
+    return 1;
+}
+
+/* Write the SEC encoding of the point (33 or 65 bytes) to ``out``; returns
+ * its length, or 0 for the point at infinity. */
+static size_t ec_point_serialize(ec_context *ctx, const ec_point *p, int compressed,
+                                 unsigned char *out) {
+    secp_ge g;
+    (void)ctx;
+    if (p->affine)
+        ec_point_to_ge(&g, p);
+    else
+        secp_ge_set_gej(&g, &p->pt);
+    return secp_ge_serialize(out, &g, compressed);
+}
+
+/* The wide generator table as a file: a header page, the table, and zeros
+ * up to a multiple of GEN_TABLE_ALIGN, so that the file can also live on
+ * hugetlbfs.  The header names everything the table depends on and holds a
+ * SHA256 of it; a file of another version, window width or byte order, or a
+ * damaged one, is built again.  A build is checked against entries
+ * recomputed with the built-in table all over the windows.  Hashing 64 MiB
+ * takes tens of milliseconds, too long for every start: a file whose hash
+ * matched is recorded in a stamp file next to it, by device, inode, size and
+ * modification and change times, and is hashed again only once one of those
+ * moved.  Two recomputed entries per window are checked at every open. */
+#define GEN_TABLE_MAGIC "WIFCGEN"
+#define GEN_TABLE_VERSION 3
+#define GEN_TABLE_STAMP_MAGIC "WIFCSUM"
+#define GEN_TABLE_HEADER 4096
+#define GEN_TABLE_ALIGN (2UL << 20) /* a huge page */
+#define GEN_TABLE_ORDER 0x01020304U /* as the host that wrote it stores it */
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t order;
+    uint32_t bits;
+    uint32_t entry_size;
+    uint64_t size;              /* bytes of the table */
+    unsigned char sha256[32];   /* of the table */
+} GenTableHeader;
+
+/* The file <table>.stamp: the table file as it was when its hash matched. */
+typedef struct {
+    char magic[8];
+    uint64_t dev, ino, size;
+    int64_t mtime_sec, mtime_nsec;
+    int64_t ctime_sec, ctime_nsec;  /* moves on any write, and on touch */
+    unsigned char sha256[32];       /* of the header */
+} GenTableStamp;
+
+#define GEN_TABLE_BUILD_STEP 1021 /* entries between two checks of a build */
+
+static unsigned char *gen_map;
+static size_t gen_map_size;
+
+static size_t gen_table_file_size(void) {
+    size_t n = GEN_TABLE_HEADER + SECP_GEN_WIDE_BYTES;
+    return (n + GEN_TABLE_ALIGN - 1) / GEN_TABLE_ALIGN * GEN_TABLE_ALIGN;
+}
+
+static void gen_table_header(GenTableHeader *h, const unsigned char *table) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, GEN_TABLE_MAGIC, sizeof(GEN_TABLE_MAGIC));
+    h->version = GEN_TABLE_VERSION;
+    h->order = GEN_TABLE_ORDER;
+    h->bits = SECP_GEN_WIDE_BITS;
+    h->entry_size = sizeof(secp_ge_storage);
+    h->size = SECP_GEN_WIDE_BYTES;
+    SHA256(table, SECP_GEN_WIDE_BYTES, h->sha256);
+}
+
+static void gen_table_stamp(GenTableStamp *t, const struct stat *st, const unsigned char *sha256) {
+    memset(t, 0, sizeof(*t));
+    memcpy(t->magic, GEN_TABLE_STAMP_MAGIC, sizeof(GEN_TABLE_STAMP_MAGIC));
+    t->dev = st->st_dev;
+    t->ino = st->st_ino;
+    t->size = st->st_size;
+    t->mtime_sec = st->st_mtim.tv_sec;
+    t->mtime_nsec = st->st_mtim.tv_nsec;
+    t->ctime_sec = st->st_ctim.tv_sec;
+    t->ctime_nsec = st->st_ctim.tv_nsec;
+    memcpy(t->sha256, sha256, 32);
+}
+
+/* Whether the stamp of ``path`` says the file in ``st`` was hashed already. */
+static int gen_table_stamped(const char *path, const struct stat *st, const GenTableHeader *h) {
+    GenTableStamp want, have;
+    char name[4096];
+    FILE *f;
+    int ok;
+    if (snprintf(name, sizeof(name), "%s.stamp", path) >= (int)sizeof(name) ||
+        !(f = fopen(name, "rb")))
+        return 0;
+    gen_table_stamp(&want, st, h->sha256);
+    ok = fread(&have, sizeof(have), 1, f) == 1 && memcmp(&have, &want, sizeof(want)) == 0;
+    fclose(f);
+    return ok;
+}
+
+/* Record a file whose hash matched; written to a file of this process and
+ * renamed, like the table.  Without it, the next open hashes again. */
+static void gen_table_stamp_save(const char *path, const struct stat *st, const GenTableHeader *h) {
+    GenTableStamp t;
+    char name[4096], tmp[4096];
+    FILE *f;
+    int ok;
+    if (snprintf(name, sizeof(name), "%s.stamp", path) >= (int)sizeof(name) ||
+        snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", name, (long)getpid()) >= (int)sizeof(tmp) ||
+        !(f = fopen(tmp, "wb")))
+        return;
+    gen_table_stamp(&t, st, h->sha256);
+    ok = fwrite(&t, sizeof(t), 1, f) == 1;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp, name) != 0)
+        unlink(tmp);
+}
+
+/* Recompute every ``step``-th entry of each window, and its last one, the
+ * end of the longest chain of additions. */
+static int gen_table_check(const unsigned char *table, unsigned step) {
+    const secp_ge_storage *t = (const secp_ge_storage *)table;
+    for (int i = 0; i < SECP_GEN_WIDE_WINDOWS; i++) {
+        for (unsigned j = 1; j < SECP_GEN_WIDE_SIZE; j += step)
+            if (!secp_gen_wide_check(t, i, j))
+                return 0;
+        if (!secp_gen_wide_check(t, i, SECP_GEN_WIDE_SIZE - 1))
+            return 0;
+    }
+    return 1;
+}
+
+/* Map the file read-only and shared, so that every process using it reads
+ * the same pages of the page cache, and use it if the header matches. */
+static int gen_table_map(const char *path) {
+    GenTableHeader want;
+    struct stat st;
+    unsigned char *map;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != gen_table_file_size()) {
+        close(fd);
+        return 0;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+#ifdef MADV_HUGEPAGE
+    madvise(map, st.st_size, MADV_HUGEPAGE);
+#endif
+    /* the header first, the hash unless the stamp has it, then a few
+     * entries */
+    memcpy(&want, map, sizeof(want));
+    if (memcmp(want.magic, GEN_TABLE_MAGIC, sizeof(GEN_TABLE_MAGIC)) != 0 ||
+        want.version != GEN_TABLE_VERSION || want.order != GEN_TABLE_ORDER ||
+        want.bits != SECP_GEN_WIDE_BITS || want.entry_size != sizeof(secp_ge_storage) ||
+        want.size != SECP_GEN_WIDE_BYTES) {
+        munmap(map, st.st_size);
+        return 0;
+    }
+    if (!gen_table_stamped(path, &st, &want)) {
+        GenTableHeader have;
+        gen_table_header(&have, map + GEN_TABLE_HEADER);
+        if (memcmp(map, &have, sizeof(have)) != 0) {
+            munmap(map, st.st_size);
+            return 0;
+        }
+        gen_table_stamp_save(path, &st, &want);
+    }
+    if (!gen_table_check(map + GEN_TABLE_HEADER, SECP_GEN_WIDE_SIZE)) {
+        munmap(map, st.st_size);
+        return 0;
+    }
+    ec_gen_table_close();
+    gen_map = map;
+    gen_map_size = st.st_size;
+    secp_gen_wide_use((const secp_ge_storage *)(map + GEN_TABLE_HEADER));
+    return 1;
+}
+
+/* Write the table to a file of this process and rename it over ``path``:
+ * processes that build at the same time each replace it with a complete
+ * file, and none ever maps half of one. */
+static int gen_table_build(const char *path) {
+    size_t size = gen_table_file_size();
+    unsigned char *map;
+    GenTableHeader h;
+    char tmp[4096];
+    int fd, ok;
+
+    if (snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid()) >= (int)sizeof(tmp))
+        return 0;
+    fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(tmp);
+        return 0;
+    }
+    if (ftruncate(fd, (off_t)size) != 0 ||
+        (map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        perror(tmp);
+        close(fd);
+        unlink(tmp);
+        return 0;
+    }
+    ok = secp_gen_wide_build((secp_ge_storage *)(map + GEN_TABLE_HEADER)) &&
+         gen_table_check(map + GEN_TABLE_HEADER, GEN_TABLE_BUILD_STEP);
+    if (ok) {
+        gen_table_header(&h, map + GEN_TABLE_HEADER);
+        memcpy(map, &h, sizeof(h));
+        ok = msync(map, size, MS_SYNC) == 0;
+    }
+    munmap(map, size);
+    ok = ok && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp, path) != 0) {
+        perror(path);
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+int ec_gen_table_open(const char *path) {
+    if (gen_table_map(path))
+        return 1;
+    printf("Building the generator table %s (%zu MiB)\n", path, gen_table_file_size() >> 20);
+    fflush(stdout);
+    return gen_table_build(path) && gen_table_map(path);
+}
+
+void ec_gen_table_close(void) {
+    if (!gen_map)
+        return;
+    secp_gen_wide_use(NULL);
+    munmap(gen_map, gen_map_size);
+    gen_map = NULL;
+}
+
+#endif /* WIFCRACK_OPENSSL_EC */
+
+/* Serialize the point and compute RIPEMD160(SHA256(pubkey)).  The point is
+ * normalized on the fly, which costs one field inversion; use
+ * ec_points_hash160() to amortize it over many points. */
+int ec_point_hash160(ec_context *ctx, const ec_point *p, int compressed, unsigned char *hash_out) {
+    unsigned char pub[65];
+    size_t len = ec_point_serialize(ctx, p, compressed, pub);
+    if (len == 0)
+        return 0;
+    hash160(pub, len, hash_out);
+    return 1;
+}
+
+#define EC_HASH160_CHUNK 64
+
+/* Compute the public key hash of ``n`` points at once.  The points are
+ * normalized in place with one shared inversion, serialized in chunks and
+ * hashed by the multi-lane hash160 kernel; hash i is written to
+ * hashes_out + 20 * i.  A point at infinity has no encoding: its hash is
+ * left zero and infinity_out[i], unless NULL, set to 1 (0 for the others),
+ * the rest of the batch is hashed as usual. */
+int ec_points_hash160(ec_context *ctx, ec_point *points, size_t n, int compressed,
+                      unsigned char *hashes_out, unsigned char *infinity_out) {
+    unsigned char pubs[EC_HASH160_CHUNK][65], infinite[EC_HASH160_CHUNK];
+    size_t len = compressed ? 33 : 65;
+    if (!ec_points_normalize(ctx, points, n))
+        return 0;
+    for (size_t i = 0; i < n; i += EC_HASH160_CHUNK) {
+        size_t m = n - i < EC_HASH160_CHUNK ? n - i : EC_HASH160_CHUNK, got;
+        for (size_t j = 0; j < m; j++) {
+            got = ec_point_serialize(ctx, &points[i + j], compressed, pubs[j]);
+            if (got != 0 && got != len)
+                return 0;
+            infinite[j] = got == 0;
+            if (infinite[j])
+                memset(pubs[j], 0, len);
+        }
+        hash160_batch(pubs[0], sizeof(pubs[0]), len, m, hashes_out + 20 * i);
+        for (size_t j = 0; j < m; j++) {
+            if (infinite[j])
+                memset(hashes_out + 20 * (i + j), 0, 20);
+        }
+        if (infinity_out)
+            memcpy(infinity_out + i, infinite, m);
+    }
+    return 1;
+}
+
+/* The P2SH-P2WPKH redeem script of a key is 0x00 0x14 <its key hash>. */
+void p2wpkh_script_hash_batch(const unsigned char *pubkey_hashes, size_t n, unsigned char *out) {
+    unsigned char scripts[EC_HASH160_CHUNK][22];
+    for (size_t i = 0; i < n; i += EC_HASH160_CHUNK) {
+        size_t m = n - i < EC_HASH160_CHUNK ? n - i : EC_HASH160_CHUNK;
+        for (size_t j = 0; j < m; j++) {
+            scripts[j][0] = 0x00;
+            scripts[j][1] = 0x14;
+            memcpy(scripts[j] + 2, pubkey_hashes + 20 * (i + j), 20);
+        }
+        hash160_batch(scripts[0], sizeof(scripts[0]), sizeof(scripts[0]), m, out + 20 * i);
+    }
+}
@@ -1,3 +1,130 @@
-int generate_pubkey_hash_from_privkey(const unsigned char *priv_key_bytes, unsigned char *pubkey_hash_out);
-int base58_decode_bitcoin_address(const char *base58_addr, unsigned char *pubkey_hash_out);
-int decode_wif(const char *wif, unsigned char *priv_key_out, int *compressed_out);
+#ifndef BITCOIN_H
+#define BITCOIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#ifdef WIFCRACK_OPENSSL_EC
+#include <openssl/ec.h>
+#else
+#include "secp256k1.h"
+#endif
+
+int generate_pubkey_hash_from_privkey(const unsigned char *priv_key_bytes, int compressed,
+                                      unsigned char *pubkey_hash_out);
+int base58_decode_bitcoin_address(const char *base58_addr, unsigned char *pubkey_hash_out);
+
+/* The 20 byte hash an address pays to: the public key hash of P2PKH ("1...")
+ * and P2WPKH ("bc1q..."), the script hash of P2SH ("3...", taken to be
+ * P2SH-P2WPKH).  Returns ADDRESS_INVALID for anything else. */
+typedef enum {
+    ADDRESS_INVALID,
+    ADDRESS_P2PKH,
+    ADDRESS_P2SH,
+    ADDRESS_P2WPKH
+} address_type;
+
+address_type decode_bitcoin_address(const char *address, unsigned char *hash_out);
+/* The address of ``type`` paying to the 20 byte ``hash``, into ``out`` of
+ * BITCOIN_ADDRESS_MAX characters.  Returns 0 for ADDRESS_INVALID. */
+#define BITCOIN_ADDRESS_MAX 64
+int encode_bitcoin_address(address_type type, const unsigned char *hash, char *out);
+int decode_wif(const char *wif, unsigned char *priv_key_out, int *compressed_out);
+int encode_wif(const unsigned char *key, int compressed, char *out);
+/* A WIF can hold any 32 bytes; only 0 < key < n are private keys. */
+int private_key_valid(const unsigned char *key);
+
+extern const char BASE58_ALPHABET[];
+int base58_digit(char c);
+
+/* Fixed width (320 bit) unsigned integer holding the Base58 value of a WIF
+ * string.  Limbs are little-endian.  A 52 character WIF decodes to 38 bytes,
+ * so every WIF candidate fits without allocation. */
+#define WIF_NUM_LIMBS 5
+#define WIF_PAYLOAD_MAX 38
+#define WIF_CHARS_MAX 52
+
+typedef struct {
+    uint64_t v[WIF_NUM_LIMBS];
+} wif_num;
+
+int wif_num_from_base58(wif_num *r, const char *s);
+/* The first ``len`` characters of ``s``, which need not be terminated. */
+int wif_num_from_base58_len(wif_num *r, const char *s, size_t len);
+void wif_num_set_pow58(wif_num *r, int exp);
+void wif_num_mul_word(wif_num *r, uint64_t w);
+void wif_num_add(wif_num *r, const wif_num *a);
+void wif_num_sub(wif_num *r, const wif_num *a);
+int wif_num_cmp(const wif_num *a, const wif_num *b);
+void wif_num_shr(wif_num *r, const wif_num *a, int bits);
+void wif_num_to_bytes(const wif_num *a, unsigned char *out, size_t len);
+int wif_num_check_payload(const wif_num *n, int compressed, unsigned char *key_out);
+void wif_num_to_base58(const wif_num *n, char *out, int len);
+
+/* Candidates that passed the version and compression byte checks, waiting
+ * for their checksum.  The checksums of a whole batch are computed together
+ * by the multi-buffer SHA256 kernels of hash.c. */
+#define WIF_CHECK_BATCH 64
+
+typedef struct {
+    int compressed;
+    size_t count;
+    wif_num nums[WIF_CHECK_BATCH];
+    unsigned char bytes[WIF_CHECK_BATCH][WIF_NUM_LIMBS * 8];
+    uint32_t sums[WIF_CHECK_BATCH];
+} WifCheckBatch;
+
+void wif_check_batch_init(WifCheckBatch *b, int compressed);
+int wif_check_batch_add(WifCheckBatch *b, const wif_num *n);
+size_t wif_check_batch_run(WifCheckBatch *b);
+const unsigned char *wif_check_batch_key(const WifCheckBatch *b, size_t i);
+
+/* Elliptic curve helpers.  An ec_context holds the per-thread curve state and
+ * must not be shared between threads; points are owned by the caller and are
+ * released with ec_point_clear().
+ *
+ * The native secp256k1 backend is used by default; build with
+ * -DWIFCRACK_OPENSSL_EC to go through the generic OpenSSL EC_POINT API
+ * instead. */
+typedef struct ec_context ec_context;
+
+#ifdef WIFCRACK_OPENSSL_EC
+typedef struct {
+    EC_POINT *pt;
+} ec_point;
+#else
+typedef struct {
+    secp_gej pt;
+    int affine; /* z == 1 and x, y fully normalized */
+} ec_point;
+#endif
+
+ec_context *ec_context_create(void);
+void ec_context_free(ec_context *ctx);
+int ec_context_reserve(ec_context *ctx, size_t n);
+
+int ec_point_init(ec_context *ctx, ec_point *p);
+void ec_point_clear(ec_point *p);
+int ec_point_copy(ec_point *r, const ec_point *a);
+int ec_point_set_scalar(ec_context *ctx, ec_point *p, const unsigned char *scalar,
+                        size_t len, int negative);
+int ec_point_add(ec_context *ctx, ec_point *r, const ec_point *a, const ec_point *b);
+int ec_point_negate(ec_context *ctx, ec_point *p);
+int ec_points_normalize(ec_context *ctx, ec_point *points, size_t n);
+int ec_point_hash160(ec_context *ctx, const ec_point *p, int compressed, unsigned char *hash_out);
+int ec_points_hash160(ec_context *ctx, ec_point *points, size_t n, int compressed,
+                      unsigned char *hashes_out, unsigned char *infinity_out);
+
+/* Multiply by G with the wide table of secp256k1.h, kept in the file
+ * ``path``: mapped read-only and shared with every other process using the
+ * same file, on huge pages where the kernel gives them.  A missing, stale or
+ * damaged file is built first (64 MiB, about a second, once).  Call it before
+ * any thread multiplies.  Returns 0, and leaves the built-in table in use,
+ * if the file can be neither read nor written, or with -DWIFCRACK_OPENSSL_EC. */
+int ec_gen_table_open(const char *path);
+void ec_gen_table_close(void);
+
+/* out + 20 * i = hash160 of the P2SH-P2WPKH redeem script of the compressed
+ * public key hash pubkey_hashes + 20 * i, for i < n */
+void p2wpkh_script_hash_batch(const unsigned char *pubkey_hashes, size_t n, unsigned char *out);
+
+#endif /* BITCOIN_H */
@@ -0,0 +1,174 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/sha.h>
+#include "checkpoint.h"
+#include "textfile.h"
+
+#define CHECKPOINT_MAGIC "wifcrack-checkpoint 1"
+
+static volatile sig_atomic_t signalled;
+static struct sigaction old_int, old_term;
+
+static void on_signal(int sig) {
+    (void)sig;
+    signalled = 1;
+}
+
+void checkpoint_catch_signals(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    signalled = 0;
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+}
+
+void checkpoint_restore_signals(void) {
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+}
+
+int checkpoint_signalled(void) {
+    return signalled;
+}
+
+/* one field per line; a missing field and an empty one differ */
+static void put_field(FILE *f, const char *s) {
+    fprintf(f, "%s%s\n", s ? "=" : "", s ? s : "");
+}
+
+static void config_hash(const Configuration *config, int shard, unsigned char out[32]) {
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *f = open_memstream(&buf, &len);
+
+    if (!f) {
+        memset(out, 0, 32);
+        return;
+    }
+    fprintf(f, "%d\n%d\n", (int)configuration_get_work(config),
+            configuration_is_compressed(config));
+    put_field(f, configuration_get_wif(config));
+    put_field(f, configuration_get_wif_status(config));
+    put_field(f, configuration_get_target_address(config));
+    for (const guess_entry *ge = config->guess; ge; ge = ge->next) {
+        fprintf(f, "%s", ge->chars);
+        /* weights change the order of the candidates */
+        for (size_t i = 0; ge->weights && ge->chars[i]; ++i)
+            fprintf(f, " %.17g", ge->weights[i]);
+        fprintf(f, "\n");
+    }
+    if (shard && configuration_get_shard_count(config) > 1)
+        fprintf(f, "shard %d/%d\n", configuration_get_shard_index(config),
+                configuration_get_shard_count(config));
+    fclose(f);
+    SHA256((const unsigned char *)buf, len, out);
+    free(buf);
+}
+
+void checkpoint_keyspace_hash(const Configuration *config, unsigned char out[32]) {
+    config_hash(config, 0, out);
+}
+
+void checkpoint_config_hash(const Configuration *config, unsigned char out[32]) {
+    config_hash(config, 1, out);
+}
+
+int checkpoint_save(const char *path, const Checkpoint *c) {
+    char tmp[1024], hex[65];
+    FILE *f = textfile_create(path, tmp, sizeof(tmp));
+
+    if (!f)
+        return 0;
+    textfile_hex(c->config, 32, hex);
+    fprintf(f, "%s\nconfig %s\nstage %d\ntotal %llu\nranges %zu\n", CHECKPOINT_MAGIC, hex,
+            c->stage, (unsigned long long)c->total, c->range_count);
+    for (size_t i = 0; i < c->range_count; ++i)
+        fprintf(f, "%llu %llu\n", (unsigned long long)c->ranges[i].begin,
+                (unsigned long long)c->ranges[i].end);
+    fprintf(f, "results %zu\n", c->result_count);
+    for (size_t i = 0; i < c->result_count; ++i)
+        fprintf(f, "%s\n", c->results[i]);
+    return textfile_commit(f, tmp, path);
+}
+
+void checkpoint_clear(Checkpoint *c) {
+    if (!c)
+        return;
+    for (size_t i = 0; i < c->result_count; ++i)
+        free(c->results[i]);
+    free(c->results);
+    free(c->ranges);
+    memset(c, 0, sizeof(*c));
+}
+
+static int read_line(FILE *f, char *buf, size_t size) {
+    size_t len;
+    if (!fgets(buf, (int)size, f))
+        return 0;
+    len = strlen(buf);
+    if (len == 0 || buf[len - 1] != '\n')
+        return 0;
+    buf[len - 1] = '\0';
+    return 1;
+}
+
+/* Every range must lie in [0, total), in order and without overlap. */
+static int parse(FILE *f, const unsigned char config[32], Checkpoint *c) {
+    char line[256], hex[65];
+    unsigned long long total, begin, end, prev = 0;
+    size_t n;
+
+    if (!read_line(f, line, sizeof(line)) || strcmp(line, CHECKPOINT_MAGIC) != 0)
+        return 0;
+    textfile_hex(config, 32, hex);
+    if (!read_line(f, line, sizeof(line)) || strncmp(line, "config ", 7) != 0 ||
+        strcmp(line + 7, hex) != 0) {
+        fprintf(stderr, "Error: the checkpoint belongs to another configuration\n");
+        return 0;
+    }
+    memcpy(c->config, config, 32);
+    if (fscanf(f, "stage %d\ntotal %llu\nranges %zu\n", &c->stage, &total, &n) != 3 ||
+        c->stage < 0 || n > total)
+        return 0;
+    c->total = total;
+    c->ranges = malloc((n ? n : 1) * sizeof(SchedulerRange));
+    if (!c->ranges)
+        return 0;
+    for (; c->range_count < n; ++c->range_count) {
+        if (fscanf(f, "%llu %llu\n", &begin, &end) != 2 || begin < prev || begin >= end ||
+            end > total)
+            return 0;
+        c->ranges[c->range_count] = (SchedulerRange){begin, end};
+        prev = end;
+    }
+    if (fscanf(f, "results %zu\n", &n) != 1 || n > (1 << 24))
+        return 0;
+    c->results = calloc(n ? n : 1, sizeof(char *));
+    if (!c->results)
+        return 0;
+    for (; c->result_count < n; ++c->result_count) {
+        if (!read_line(f, line, sizeof(line)) || !(c->results[c->result_count] = strdup(line)))
+            return 0;
+    }
+    return 1;
+}
+
+int checkpoint_load(const char *path, const unsigned char config[32], Checkpoint *c) {
+    FILE *f = fopen(path, "r");
+    int ok;
+    memset(c, 0, sizeof(*c));
+    if (!f)
+        return 0;
+    ok = parse(f, config, c);
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "Error: cannot resume from checkpoint %s\n", path);
+        checkpoint_clear(c);
+        return -1;
+    }
+    return 1;
+}
@@ -0,0 +1,53 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "configuration.h"
+#include "scheduler.h"
+
+#define CHECKPOINT_PERIOD 60 /* seconds between checkpoints by default */
+
+/* Progress of a solver run, written to a small text file that is replaced
+ * atomically, so that a killed run can carry on from the last one.  The
+ * ranks of the keyspace map one to one to the solver's candidates (the
+ * mixed-radix digits of a walk, a key of END, a jump step), so the ranges
+ * left to do pin down the position of every unfinished piece exactly.
+ * ``stage`` tells the scheduler runs of one job apart (the depth of ROTATE).
+ * ``config`` identifies the job, and a checkpoint of another job is never
+ * resumed. */
+typedef struct {
+    unsigned char config[32];
+    int stage;
+    uint64_t total;
+    SchedulerRange *ranges;  /* ranks still to do, sorted */
+    size_t range_count;
+    char **results;          /* found so far */
+    size_t result_count;
+} Checkpoint;
+
+/* SHA256 over everything that defines the keyspace and its order: solver,
+ * WIF, status, address and hint lines.  The thread count is left out, a run
+ * may resume on another machine.  The config hash also covers the shard, the
+ * keyspace hash is the same for every shard of a job. */
+void checkpoint_keyspace_hash(const Configuration *config, unsigned char out[32]);
+void checkpoint_config_hash(const Configuration *config, unsigned char out[32]);
+
+/* Write the checkpoint to ``path`` through a temporary file, synced and
+ * renamed over the old one.  Returns 1 on success. */
+int checkpoint_save(const char *path, const Checkpoint *c);
+
+/* Returns 1 if a checkpoint of the job ``config`` was read into ``c``, 0 if
+ * there is none and -1 if the file belongs to another job or is damaged.
+ * Free the result with checkpoint_clear(). */
+int checkpoint_load(const char *path, const unsigned char config[32], Checkpoint *c);
+void checkpoint_clear(Checkpoint *c);
+
+/* SIGINT and SIGTERM only raise a flag, so that the run can write a last
+ * checkpoint and stop cleanly; checkpoint_restore_signals() puts the
+ * previous handlers back. */
+void checkpoint_catch_signals(void);
+void checkpoint_restore_signals(void);
+int checkpoint_signalled(void);
+
+#endif /* CHECKPOINT_H */
@@ -28,9 +28,23 @@ static WORK parse_work(const char *str) {
     if (strcmp(str, "ROTATE") == 0) return WORK_ROTATE;
     if (strcmp(str, "SEARCH") == 0) return WORK_SEARCH;
     if (strcmp(str, "ALIKE") == 0) return WORK_ALIKE;
+    if (strcmp(str, "LIST") == 0) return WORK_LIST;
     return WORK_START;
 }
 
+const char *work_to_string(WORK work) {
+    switch (work) {
+        case WORK_END: return "END";
+        case WORK_JUMP: return "JUMP";
+        case WORK_ROTATE: return "ROTATE";
+        case WORK_SEARCH: return "SEARCH";
+        case WORK_ALIKE: return "ALIKE";
+        case WORK_LIST: return "LIST";
+        case WORK_START:
+        default: return "START";
+    }
+}
+
 Configuration *configuration_create(const char *targetAddress,
                                     const char *wif,
                                     const char *wifStatus,
@@ -53,6 +67,7 @@ Configuration *configuration_create(const char *targetAddress,
     if (wifStatus) config->wif_status = strdup(wifStatus);
     config->compressed = (config->compressed || (wif && strlen(wif) == COMPRESSED_WIF_LENGTH) || (work == WORK_END && wif && (wif[0] == 'L' || wif[0] == 'K')));
     config->guess = guess;
+    config->progress_period = STATUS_PERIOD / 1000;
     return config;
 }
 
@@ -68,6 +83,7 @@ Configuration *configuration_load_from_file(const char *filename) {
     char *address = NULL;
     char *target_wif = NULL;
     guess_entry *head = NULL, *tail = NULL;
+    int bad = 0;
 
     while (fgets(buf, sizeof(buf), f)) {
         char *p = buf;
@@ -108,17 +124,42 @@ Configuration *configuration_load_from_file(const char *filename) {
             guess_entry *ge = calloc(1, sizeof(guess_entry));
             if (!ge) break;
             ge->index = tail ? tail->index + 1 : 0;
-            ge->chars = strdup(p);
+            if (!configuration_parse_guess(ge, p)) {
+                fprintf(stderr, "Invalid hint line in %s: %s\n", filename, p);
+                configuration_free_guess(ge);
+                bad = 1;
+                break;
+            }
             if (tail) tail->next = ge; else head = ge;
             tail = ge;
         }
     }
     fclose(f);
+    if (bad) {
+        free(work_s);
+        free(wif);
+        free(wif_status);
+        free(address);
+        free(target_wif);
+        configuration_free_guess(head);
+        return NULL;
+    }
 
+    /* the work line may force the number of threads: "SEARCH,8" */
+    int threads = -1;
+    char *comma = work_s ? strchr(work_s, ',') : NULL;
+    if (comma) {
+        *comma = '\0';
+        threads = atoi(comma + 1);
+    }
     WORK work = parse_work(work_s);
     const char *status_arg = wif_status ? wif_status : (target_wif ? target_wif : "");
     Configuration *cfg = configuration_create(address, wif, status_arg,
                                               work, head);
+    if (cfg && threads > 0) {
+        cfg->forced_threads = threads;
+        configuration_set_force_threads(cfg, &cfg->forced_threads);
+    }
     free(work_s);
     free(wif);
     free(wif_status);
@@ -128,13 +169,74 @@ Configuration *configuration_load_from_file(const char *filename) {
 }
 
 
+/* Tokens are separated by blanks or commas; "chars:weight" gives every
+ * character of the token that weight. */
+int configuration_parse_guess(guess_entry *ge, const char *line) {
+    size_t n = 0, len = strlen(line);
+    const char *p = line;
+
+    ge->weights = NULL;
+    if (!strchr(line, ':')) {
+        ge->chars = strdup(line);
+        return ge->chars != NULL;
+    }
+    ge->chars = malloc(len + 1);
+    ge->weights = malloc((len + 1) * sizeof(double));
+    if (!ge->chars || !ge->weights)
+        return 0;
+    for (;;) {
+        const char *start;
+        size_t k;
+        double w = 1;
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+        if (!*p)
+            break;
+        start = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != ',' && *p != ':')
+            p++;
+        k = (size_t)(p - start);
+        if (*p == ':') {
+            char *end;
+            w = strtod(p + 1, &end);
+            if (end == p + 1 || !(w > 0 && w < 1e300) ||
+                (*end && *end != ' ' && *end != '\t' && *end != ','))
+                return 0;
+            p = end;
+        }
+        if (k == 0)
+            return 0;
+        memcpy(ge->chars + n, start, k);
+        for (size_t i = 0; i < k; ++i)
+            ge->weights[n + i] = w;
+        n += k;
+    }
+    ge->chars[n] = '\0';
+    return 1;
+}
+
+void configuration_free_guess(guess_entry *guess) {
+    while (guess) {
+        guess_entry *next = guess->next;
+        free(guess->chars);
+        free(guess->weights);
+        free(guess);
+        guess = next;
+    }
+}
+
 void configuration_free(Configuration *config) {
     if (!config) return;
+    configuration_free_guess(config->guess);
     free(config->target_address);
     free(config->wif);
     free(config->wif_status);
     free(config->address);
     free(config->address_hash);
+    free(config->checkpoint_file);
+    free(config->shard_file);
+    free(config->metrics_file);
+    free(config->results_file);
 
     if (config->email_config) {
         free(config->email_config->email_from);
@@ -192,3 +294,89 @@ void configuration_set_force_threads(Configuration *config, int *threads) {
     if (config) config->force_threads = threads;
 }
 
+void configuration_set_checkpoint(Configuration *config, const char *file, int period) {
+    if (!config) return;
+    free(config->checkpoint_file);
+    config->checkpoint_file = file ? strdup(file) : NULL;
+    config->checkpoint_period = period;
+}
+
+const char *configuration_get_checkpoint_file(const Configuration *config) {
+    return config ? config->checkpoint_file : NULL;
+}
+
+int configuration_get_checkpoint_period(const Configuration *config) {
+    return config ? config->checkpoint_period : 0;
+}
+
+void configuration_set_max_runtime(Configuration *config, int seconds) {
+    if (config) config->max_runtime = seconds;
+}
+
+int configuration_get_max_runtime(const Configuration *config) {
+    return config ? config->max_runtime : 0;
+}
+
+void configuration_set_shard(Configuration *config, int index, int count, const char *file) {
+    if (!config) return;
+    config->shard_index = index;
+    config->shard_count = count;
+    free(config->shard_file);
+    config->shard_file = file ? strdup(file) : NULL;
+}
+
+int configuration_get_shard_index(const Configuration *config) {
+    return config ? config->shard_index : 0;
+}
+
+int configuration_get_shard_count(const Configuration *config) {
+    return config ? config->shard_count : 0;
+}
+
+const char *configuration_get_shard_file(const Configuration *config) {
+    return config ? config->shard_file : NULL;
+}
+
+void configuration_set_progress(Configuration *config, int period, const char *metrics_file,
+                                int metrics_period) {
+    if (!config) return;
+    config->progress_period = period;
+    free(config->metrics_file);
+    config->metrics_file = metrics_file ? strdup(metrics_file) : NULL;
+    config->metrics_period = metrics_period;
+}
+
+int configuration_get_progress_period(const Configuration *config) {
+    return config ? config->progress_period : 0;
+}
+
+const char *configuration_get_metrics_file(const Configuration *config) {
+    return config ? config->metrics_file : NULL;
+}
+
+int configuration_get_metrics_period(const Configuration *config) {
+    return config ? config->metrics_period : 0;
+}
+
+void configuration_set_results(Configuration *config, const char *file, int sync) {
+    if (!config) return;
+    free(config->results_file);
+    config->results_file = file ? strdup(file) : NULL;
+    config->results_sync = sync;
+}
+
+const char *configuration_get_results_file(const Configuration *config) {
+    return config ? config->results_file : NULL;
+}
+
+int configuration_get_results_sync(const Configuration *config) {
+    return config ? config->results_sync : 0;
+}
+
+void configuration_set_key_threads(Configuration *config, int threads) {
+    if (config) config->key_threads = threads > 0 ? threads : 0;
+}
+
+int configuration_get_key_threads(const Configuration *config) {
+    return config ? config->key_threads : 0;
+}
@@ -18,13 +18,21 @@ typedef enum {
     WORK_JUMP,
     WORK_ROTATE,
     WORK_SEARCH,
-    WORK_ALIKE
+    WORK_ALIKE,
+    WORK_LIST
 
 } WORK;
 
+/* The name of ``work`` as on the work line, "START" for WORK_START. */
+const char *work_to_string(WORK work);
+
+/* A hint line lists the characters a position may be, e.g. "acoe", or
+ * weighs them, "a:6 c:2 o e:0.5" (a weight of 1 when left out): the
+ * weighted solvers try the likelier characters first. */
 typedef struct guess_entry {
     int index;
     char *chars;
+    double *weights; /* one per character of chars, NULL if unweighted */
     struct guess_entry *next;
 } guess_entry;
 
@@ -45,7 +53,20 @@ typedef struct {
     unsigned char *address_hash;
     int compressed;
     int *force_threads;
+    int forced_threads; /* storage for a thread count read from the file */
     EmailConfiguration *email_config;
+    char *checkpoint_file;  /* NULL: no checkpoints */
+    int checkpoint_period;  /* seconds */
+    int max_runtime;        /* seconds, 0 for no limit */
+    int shard_index;        /* 0-based, of shard_count */
+    int shard_count;        /* 0 or 1: the whole keyspace */
+    char *shard_file;       /* results of the shard */
+    int progress_period;    /* seconds between progress lines, 0 for none */
+    char *metrics_file;     /* NULL: no metrics file */
+    int metrics_period;     /* seconds */
+    char *results_file;     /* NULL: results are not streamed */
+    int results_sync;       /* seconds between fsyncs, 0: every result, -1: never */
+    int key_threads;        /* threads deriving and hashing public keys, 0: the solver's */
 } Configuration;
 
 Configuration *configuration_create(const char *targetAddress,
@@ -56,6 +77,11 @@ Configuration *configuration_create(const char *targetAddress,
 
 Configuration *configuration_load_from_file(const char *filename);
 
+/* Parse one hint line into ``ge``.  Returns 0 if a weight is invalid. */
+int configuration_parse_guess(guess_entry *ge, const char *line);
+/* The configuration owns its hint list, configuration_free() frees it. */
+void configuration_free_guess(guess_entry *guess);
+
 void configuration_free(Configuration *config);
 
 int configuration_get_checksum_chars(int compressed);
@@ -74,4 +100,24 @@ EmailConfiguration *configuration_get_email(const Configuration *config);
 int *configuration_get_force_threads(const Configuration *config);
 void configuration_set_force_threads(Configuration *config, int *threads);
 
+void configuration_set_checkpoint(Configuration *config, const char *file, int period);
+const char *configuration_get_checkpoint_file(const Configuration *config);
+int configuration_get_checkpoint_period(const Configuration *config);
+void configuration_set_max_runtime(Configuration *config, int seconds);
+int configuration_get_max_runtime(const Configuration *config);
+void configuration_set_shard(Configuration *config, int index, int count, const char *file);
+int configuration_get_shard_index(const Configuration *config);
+int configuration_get_shard_count(const Configuration *config);
+const char *configuration_get_shard_file(const Configuration *config);
+void configuration_set_progress(Configuration *config, int period, const char *metrics_file,
+                                int metrics_period);
+int configuration_get_progress_period(const Configuration *config);
+const char *configuration_get_metrics_file(const Configuration *config);
+int configuration_get_metrics_period(const Configuration *config);
+void configuration_set_results(Configuration *config, const char *file, int sync);
+const char *configuration_get_results_file(const Configuration *config);
+int configuration_get_results_sync(const Configuration *config);
+void configuration_set_key_threads(Configuration *config, int threads);
+int configuration_get_key_threads(const Configuration *config);
+
 #endif /* CONFIGURATION_H */
@@ -0,0 +1,466 @@
+#include <string.h>
+#include <time.h>
+#include "hash.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HASH_X86 1
+#include <immintrin.h>
+#endif
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint32_t SHA256_INIT[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static uint32_t load_be32(const unsigned char *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void store_be32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+void sha256_transform(uint32_t state[8], const unsigned char block[64]) {
+    uint32_t w[64];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 16; i++)
+        w[i] = load_be32(block + 4 * i);
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) +
+                      SHA256_K[i] + w[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/* state = SHA256 of a single padded block holding ``len`` bytes */
+static void sha256_one_block(uint32_t state[8], const unsigned char *msg, size_t len) {
+    unsigned char block[64] = {0};
+    memcpy(block, msg, len);
+    block[len] = 0x80;
+    block[62] = (unsigned char)(len >> 5);
+    block[63] = (unsigned char)(len << 3);
+    memcpy(state, SHA256_INIT, sizeof(SHA256_INIT));
+    sha256_transform(state, block);
+}
+
+void sha256_short(const unsigned char *msg, size_t len, unsigned char out[32]) {
+    uint32_t state[8];
+    sha256_one_block(state, msg, len);
+    for (int i = 0; i < 8; i++)
+        store_be32(out + 4 * i, state[i]);
+}
+
+/* Pad a message of at most HASH160_MSG_MAX bytes into one or two blocks;
+ * returns the number of blocks. */
+static int sha256_pad(unsigned char block[128], const unsigned char *msg, size_t len) {
+    int blocks = len > SHA256_BLOCK_MAX ? 2 : 1;
+    memset(block, 0, 64 * blocks);
+    memcpy(block, msg, len);
+    block[len] = 0x80;
+    block[64 * blocks - 2] = (unsigned char)(len >> 5);
+    block[64 * blocks - 1] = (unsigned char)(len << 3);
+    return blocks;
+}
+
+uint32_t sha256d_checksum(const unsigned char *msg, size_t len) {
+    uint32_t state[8];
+    unsigned char block[64] = {0};
+
+    sha256_one_block(state, msg, len);
+    /* the 32 byte digest is hashed again, padded in place */
+    for (int i = 0; i < 8; i++)
+        store_be32(block + 4 * i, state[i]);
+    block[32] = 0x80;
+    block[62] = 0x01; /* 256 bits */
+    memcpy(state, SHA256_INIT, sizeof(SHA256_INIT));
+    sha256_transform(state, block);
+    return state[0];
+}
+
+static const unsigned char RIPEMD160_R[2][80] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+     7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+     3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+     1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+     4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13},
+    {5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+     6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+     15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+     8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+     12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11}};
+
+static const unsigned char RIPEMD160_S[2][80] = {
+    {11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+     7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+     11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+     11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+     9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6},
+    {8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+     9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+     9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+     15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+     8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11}};
+
+static const uint32_t RIPEMD160_K[2][5] = {
+    {0x00000000, 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xa953fd4e},
+    {0x50a28be6, 0x5c4dd124, 0x6d703ef3, 0x7a6d76e9, 0x00000000}};
+
+static const uint32_t RIPEMD160_INIT[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* The five boolean functions of RIPEMD160; the right line uses them in
+ * reverse order. */
+#define RIPEMD160_F(round, x, y, z)                                                  \
+    ((round) == 0 ? (x) ^ (y) ^ (z) :                                                \
+     (round) == 1 ? ((x) & (y)) | (~(x) & (z)) :                                     \
+     (round) == 2 ? ((x) | ~(y)) ^ (z) :                                             \
+     (round) == 3 ? ((x) & (z)) | ((y) & ~(z)) :                                     \
+                    (x) ^ ((y) | ~(z)))
+
+/* RIPEMD160 compression of the 16 little endian words ``x``. */
+static void ripemd160_compress(uint32_t state[5], const uint32_t x[16]) {
+    uint32_t l[5], r[5];
+    memcpy(l, state, sizeof(l));
+    memcpy(r, state, sizeof(r));
+    for (int j = 0; j < 80; j++) {
+        int round = j >> 4;
+        uint32_t t = l[0] + RIPEMD160_F(round, l[1], l[2], l[3]) + x[RIPEMD160_R[0][j]] +
+                     RIPEMD160_K[0][round];
+        t = ROTL(t, RIPEMD160_S[0][j]) + l[4];
+        l[0] = l[4]; l[4] = l[3]; l[3] = ROTL(l[2], 10); l[2] = l[1]; l[1] = t;
+
+        t = r[0] + RIPEMD160_F(4 - round, r[1], r[2], r[3]) + x[RIPEMD160_R[1][j]] +
+            RIPEMD160_K[1][round];
+        t = ROTL(t, RIPEMD160_S[1][j]) + r[4];
+        r[0] = r[4]; r[4] = r[3]; r[3] = ROTL(r[2], 10); r[2] = r[1]; r[1] = t;
+    }
+    uint32_t t = state[1] + l[2] + r[3];
+    state[1] = state[2] + l[3] + r[4];
+    state[2] = state[3] + l[4] + r[0];
+    state[3] = state[4] + l[0] + r[1];
+    state[4] = state[0] + l[1] + r[2];
+    state[0] = t;
+}
+
+void ripemd160_transform(uint32_t state[5], const unsigned char block[64]) {
+    uint32_t x[16];
+    for (int i = 0; i < 16; i++)
+        x[i] = (uint32_t)block[4 * i] | ((uint32_t)block[4 * i + 1] << 8) |
+               ((uint32_t)block[4 * i + 2] << 16) | ((uint32_t)block[4 * i + 3] << 24);
+    ripemd160_compress(state, x);
+}
+
+/* RIPEMD160 of the 32 byte digest held in a SHA256 state. */
+static void ripemd160_of_sha256(const uint32_t sha[8], unsigned char out[20]) {
+    uint32_t x[16] = {0}, state[5];
+    for (int i = 0; i < 8; i++)
+        x[i] = __builtin_bswap32(sha[i]);
+    x[8] = 0x80;
+    x[14] = 256;
+    memcpy(state, RIPEMD160_INIT, sizeof(state));
+    ripemd160_compress(state, x);
+    for (int i = 0; i < 5; i++) {
+        out[4 * i] = (unsigned char)state[i];
+        out[4 * i + 1] = (unsigned char)(state[i] >> 8);
+        out[4 * i + 2] = (unsigned char)(state[i] >> 16);
+        out[4 * i + 3] = (unsigned char)(state[i] >> 24);
+    }
+}
+
+void hash160(const unsigned char *msg, size_t len, unsigned char out[20]) {
+    uint32_t state[8];
+    unsigned char block[128];
+    int blocks = sha256_pad(block, msg, len);
+    memcpy(state, SHA256_INIT, sizeof(SHA256_INIT));
+    for (int i = 0; i < blocks; i++)
+        sha256_transform(state, block + 64 * i);
+    ripemd160_of_sha256(state, out);
+}
+
+#ifdef HASH_X86
+
+/* One block for each of two independent messages with the SHA extensions.
+ * The rounds of the two messages are interleaved to hide the latency of
+ * sha256rnds2.  The state is kept as ABEF/CDGH inside the loop. */
+__attribute__((target("sha,sse4.1")))
+static void sha256_transform_shani_x2(uint32_t *state[2], const unsigned char *block[2]) {
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i st0[2], st1[2], abef[2], cdgh[2], m[2][4];
+
+    for (int x = 0; x < 2; x++) {
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[x][0]), 0xB1);
+        st1[x] = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[x][4]), 0x1B);
+        st0[x] = _mm_alignr_epi8(tmp, st1[x], 8);
+        st1[x] = _mm_blend_epi16(st1[x], tmp, 0xF0);
+        abef[x] = st0[x];
+        cdgh[x] = st1[x];
+        for (int i = 0; i < 4; i++)
+            m[x][i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(block[x] + 16 * i)), mask);
+    }
+    for (int i = 0; i < 16; i++) {
+        __m128i k = _mm_loadu_si128((const __m128i *)&SHA256_K[4 * i]);
+        for (int x = 0; x < 2; x++) {
+            __m128i msg = _mm_add_epi32(m[x][i & 3], k);
+            st1[x] = _mm_sha256rnds2_epu32(st1[x], st0[x], msg);
+            st0[x] = _mm_sha256rnds2_epu32(st0[x], st1[x], _mm_shuffle_epi32(msg, 0x0E));
+            if (i < 12) {
+                /* m[i & 3] moves on from W[4i..4i+3] to W[4i+16..4i+19] */
+                __m128i t = _mm_sha256msg1_epu32(m[x][i & 3], m[x][(i + 1) & 3]);
+                t = _mm_add_epi32(t, _mm_alignr_epi8(m[x][(i + 3) & 3], m[x][(i + 2) & 3], 4));
+                m[x][i & 3] = _mm_sha256msg2_epu32(t, m[x][(i + 3) & 3]);
+            }
+        }
+    }
+    for (int x = 0; x < 2; x++) {
+        __m128i a = _mm_shuffle_epi32(_mm_add_epi32(st0[x], abef[x]), 0x1B);
+        __m128i c = _mm_shuffle_epi32(_mm_add_epi32(st1[x], cdgh[x]), 0xB1);
+        _mm_storeu_si128((__m128i *)&state[x][0], _mm_blend_epi16(a, c, 0xF0));
+        _mm_storeu_si128((__m128i *)&state[x][4], _mm_alignr_epi8(c, a, 8));
+    }
+}
+
+static void sha256d_batch_shani(const unsigned char *msgs, size_t stride, size_t len, uint32_t *out) {
+    uint32_t state[2][8];
+    unsigned char block[2][64];
+    uint32_t *states[2] = {state[0], state[1]};
+    const unsigned char *blocks[2] = {block[0], block[1]};
+
+    for (int x = 0; x < 2; x++) {
+        memset(block[x], 0, 64);
+        memcpy(block[x], msgs + x * stride, len);
+        block[x][len] = 0x80;
+        block[x][62] = (unsigned char)(len >> 5);
+        block[x][63] = (unsigned char)(len << 3);
+        memcpy(state[x], SHA256_INIT, sizeof(SHA256_INIT));
+    }
+    sha256_transform_shani_x2(states, blocks);
+    for (int x = 0; x < 2; x++) {
+        memset(block[x], 0, 64);
+        for (int i = 0; i < 8; i++)
+            store_be32(block[x] + 4 * i, state[x][i]);
+        block[x][32] = 0x80;
+        block[x][62] = 0x01;
+        memcpy(state[x], SHA256_INIT, sizeof(SHA256_INIT));
+    }
+    sha256_transform_shani_x2(states, blocks);
+    out[0] = state[0][0];
+    out[1] = state[1][0];
+}
+
+static void hash160_batch_shani(const unsigned char *msgs, size_t stride, size_t len, unsigned char *out) {
+    uint32_t state[2][8];
+    unsigned char block[2][128];
+    uint32_t *states[2] = {state[0], state[1]};
+    int blocks = 1;
+
+    for (int x = 0; x < 2; x++) {
+        blocks = sha256_pad(block[x], msgs + x * stride, len);
+        memcpy(state[x], SHA256_INIT, sizeof(SHA256_INIT));
+    }
+    for (int b = 0; b < blocks; b++) {
+        const unsigned char *blk[2] = {block[0] + 64 * b, block[1] + 64 * b};
+        sha256_transform_shani_x2(states, blk);
+    }
+    ripemd160_of_sha256(state[0], out);
+    ripemd160_of_sha256(state[1], out + 20);
+}
+
+#define SHA256_LANES 8
+#define SHA256_LANES_FN sha256d_batch_avx2
+#define HASH160_LANES_FN hash160_batch_avx2
+#define SHA256_LANES_TARGET "avx2"
+#include "sha256_lanes.h"
+#undef SHA256_LANES
+#undef SHA256_LANES_FN
+#undef HASH160_LANES_FN
+#undef SHA256_LANES_TARGET
+
+#define SHA256_LANES 16
+#define SHA256_LANES_FN sha256d_batch_avx512
+#define HASH160_LANES_FN hash160_batch_avx512
+#define SHA256_LANES_TARGET "avx512f"
+#include "sha256_lanes.h"
+#undef SHA256_LANES
+#undef SHA256_LANES_FN
+#undef HASH160_LANES_FN
+#undef SHA256_LANES_TARGET
+
+#endif /* HASH_X86 */
+
+static void sha256d_batch_scalar(const unsigned char *msgs, size_t stride, size_t len, uint32_t *out) {
+    (void)stride;
+    out[0] = sha256d_checksum(msgs, len);
+}
+
+static void hash160_batch_scalar(const unsigned char *msgs, size_t stride, size_t len, unsigned char *out) {
+    (void)stride;
+    hash160(msgs, len, out);
+}
+
+/* A kernel hashes ``lanes`` messages per call. */
+typedef struct {
+    const char *name;
+    int lanes;
+    void (*fn)(const unsigned char *msgs, size_t stride, size_t len, uint32_t *out);
+    void (*hash160)(const unsigned char *msgs, size_t stride, size_t len, unsigned char *out);
+} Sha256Impl;
+
+static const Sha256Impl SHA256_IMPLS[] = {
+    [SHA256_IMPL_SCALAR] = {"scalar", 1, sha256d_batch_scalar, hash160_batch_scalar},
+#ifdef HASH_X86
+    [SHA256_IMPL_SHANI] = {"sha-ni", 2, sha256d_batch_shani, hash160_batch_shani},
+    [SHA256_IMPL_AVX2] = {"avx2", 8, sha256d_batch_avx2, hash160_batch_avx2},
+    [SHA256_IMPL_AVX512] = {"avx512", 16, sha256d_batch_avx512, hash160_batch_avx512},
+#endif
+};
+
+static const Sha256Impl *sha256_impl = &SHA256_IMPLS[SHA256_IMPL_SCALAR];
+static const Sha256Impl *hash160_impl = &SHA256_IMPLS[SHA256_IMPL_SCALAR];
+
+int sha256_impl_supported(sha256_impl_id id) {
+    switch (id) {
+    case SHA256_IMPL_AUTO:
+    case SHA256_IMPL_SCALAR:
+        return 1;
+#ifdef HASH_X86
+    case SHA256_IMPL_SHANI:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+    case SHA256_IMPL_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    case SHA256_IMPL_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return 0;
+    }
+}
+
+/* Time a kernel on a few thousand messages: WIF payloads for the checksum,
+ * compressed public keys for hash160. */
+static double impl_seconds(const Sha256Impl *impl, int hash160) {
+    enum { MSGS = 512, ROUNDS = 8 };
+    static unsigned char msgs[MSGS * 64];
+    uint32_t out[MSGS * 5];
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i + impl->lanes <= MSGS; i += impl->lanes) {
+            if (hash160)
+                impl->hash160(msgs + 64 * i, 64, 33, (unsigned char *)out + 20 * i);
+            else
+                impl->fn(msgs + 64 * i, 64, 34, out + i);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+}
+
+static sha256_impl_id fastest_impl(int hash160) {
+    sha256_impl_id best = SHA256_IMPL_SCALAR;
+    double best_time = impl_seconds(&SHA256_IMPLS[best], hash160);
+    for (int i = SHA256_IMPL_SCALAR + 1; i < (int)(sizeof(SHA256_IMPLS) / sizeof(SHA256_IMPLS[0])); i++) {
+        double t;
+        if (!sha256_impl_supported((sha256_impl_id)i))
+            continue;
+        t = impl_seconds(&SHA256_IMPLS[i], hash160);
+        if (t < best_time) {
+            best = (sha256_impl_id)i;
+            best_time = t;
+        }
+    }
+    return best;
+}
+
+/* Pick the kernels used by sha256d_checksum_batch() and hash160_batch().
+ * With SHA256_IMPL_AUTO every supported kernel is timed on a few thousand
+ * messages and the fastest one wins, separately for the two batch
+ * functions; which of SHA-NI and the vector kernels is ahead differs between
+ * CPU generations.  Not thread safe: call it before the solver threads
+ * start.  Returns 0 if the CPU lacks the instructions. */
+int sha256_select_impl(sha256_impl_id id) {
+    if (id == SHA256_IMPL_AUTO) {
+        sha256_impl = &SHA256_IMPLS[fastest_impl(0)];
+        hash160_impl = &SHA256_IMPLS[fastest_impl(1)];
+        return 1;
+    }
+    if (!sha256_impl_supported(id))
+        return 0;
+    sha256_impl = &SHA256_IMPLS[id];
+    hash160_impl = &SHA256_IMPLS[id];
+    return 1;
+}
+
+const char *sha256_impl_name(void) {
+    return sha256_impl->name;
+}
+
+const char *hash160_impl_name(void) {
+    return hash160_impl->name;
+}
+
+void sha256d_checksum_batch(const unsigned char *msgs, size_t stride, size_t len, size_t n,
+                            uint32_t *out) {
+    const Sha256Impl *impl = sha256_impl;
+    size_t i = 0;
+    for (; i + impl->lanes <= n; i += impl->lanes)
+        impl->fn(msgs + i * stride, stride, len, out + i);
+    if (i < n) {
+        /* pad the last call with copies of the first message */
+        unsigned char tail[SHA256_LANES_MAX * 64];
+        uint32_t sums[SHA256_LANES_MAX];
+        for (int j = 0; j < impl->lanes; j++)
+            memcpy(tail + 64 * j, msgs + (i + (i + j < n ? j : 0)) * stride, len);
+        impl->fn(tail, 64, len, sums);
+        memcpy(out + i, sums, (n - i) * sizeof(uint32_t));
+    }
+}
+
+void hash160_batch(const unsigned char *msgs, size_t stride, size_t len, size_t n,
+                   unsigned char *out) {
+    const Sha256Impl *impl = hash160_impl;
+    size_t i = 0;
+    for (; i + impl->lanes <= n; i += impl->lanes)
+        impl->hash160(msgs + i * stride, stride, len, out + 20 * i);
+    if (i < n) {
+        unsigned char tail[SHA256_LANES_MAX * HASH160_MSG_MAX];
+        unsigned char hashes[SHA256_LANES_MAX * 20];
+        for (int j = 0; j < impl->lanes; j++)
+            memcpy(tail + HASH160_MSG_MAX * j, msgs + (i + (i + j < n ? j : 0)) * stride, len);
+        impl->hash160(tail, HASH160_MSG_MAX, len, hashes);
+        memcpy(out + 20 * i, hashes, (n - i) * 20);
+    }
+}
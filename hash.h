@@ -0,0 +1,54 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Hashing for the candidate hot path.  Every message hashed per candidate
+ * (a WIF payload, a public key, a SHA256 digest) fits in one or two 64 byte
+ * blocks, so these functions work on stack buffers only and never
+ * allocate. */
+#define SHA256_BLOCK_MAX 55  /* longest message that fits in one block */
+#define HASH160_MSG_MAX 119  /* longest message that fits in two blocks */
+
+void sha256_transform(uint32_t state[8], const unsigned char block[64]);
+
+/* SHA256 of a message of at most SHA256_BLOCK_MAX bytes. */
+void sha256_short(const unsigned char *msg, size_t len, unsigned char out[32]);
+
+/* First 4 bytes of SHA256(SHA256(msg)), the Base58Check checksum, for a
+ * message of at most SHA256_BLOCK_MAX bytes. */
+uint32_t sha256d_checksum(const unsigned char *msg, size_t len);
+
+void ripemd160_transform(uint32_t state[5], const unsigned char block[64]);
+
+/* RIPEMD160(SHA256(msg)), the public key hash of a serialized public key
+ * (33 or 65 bytes), for a message of at most HASH160_MSG_MAX bytes. */
+void hash160(const unsigned char *msg, size_t len, unsigned char out[20]);
+
+/* Checksums and hash160s of many messages at once.  The kernel is picked at runtime from
+ * the instructions the CPU offers; every kernel gives the same results. */
+#define SHA256_LANES_MAX 16
+
+typedef enum {
+    SHA256_IMPL_AUTO,
+    SHA256_IMPL_SCALAR,
+    SHA256_IMPL_SHANI,  /* SHA extensions, 2 interleaved messages */
+    SHA256_IMPL_AVX2,   /* 8 messages per pass */
+    SHA256_IMPL_AVX512  /* 16 messages per pass */
+} sha256_impl_id;
+
+int sha256_impl_supported(sha256_impl_id id);
+int sha256_select_impl(sha256_impl_id id);
+const char *sha256_impl_name(void);
+const char *hash160_impl_name(void);
+
+/* out[i] = sha256d_checksum(msgs + i * stride, len) for i < n */
+void sha256d_checksum_batch(const unsigned char *msgs, size_t stride, size_t len, size_t n,
+                            uint32_t *out);
+
+/* out + 20 * i = hash160(msgs + i * stride, len) for i < n */
+void hash160_batch(const unsigned char *msgs, size_t stride, size_t len, size_t n,
+                   unsigned char *out);
+
+#endif /* HASH_H */
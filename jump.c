@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "configuration.h"
+#include "jump.h"
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* num += i * t->diff for a step count of up to 128 bits */
+static void add_steps(const JumpTables *t, wif_num *num, unsigned __int128 i) {
+    wif_num lo = t->diff, hi = t->diff;
+    wif_num_mul_word(&lo, (uint64_t)i);
+    wif_num_add(num, &lo);
+    if (i >> 64) {
+        wif_num_mul_word(&hi, (uint64_t)(i >> 64));
+        memmove(&hi.v[1], &hi.v[0], (WIF_NUM_LIMBS - 1) * sizeof(uint64_t));
+        hi.v[0] = 0;
+        wif_num_add(num, &hi);
+    }
+}
+
+/* Steps i (mod 2^(40 - s)) that give the value a 0x01 compression flag.
+ * Write the low 40 bits of the base value as a * 2^s + b; i steps turn them
+ * into ((a + i * q) mod M) * 2^s + b with q = 29^s odd, so the flag byte
+ * only depends on c = a + i * q mod M, the valid c form one interval, and
+ * each maps back to i = (c - a) / q mod M. */
+static int find_residues(JumpTables *t, int s) {
+    const uint64_t low40 = t->base.v[0] & ((1ULL << 40) - 1);
+    uint64_t mask, a, b, q = 1, qinv;
+    int64_t c_lo, c_hi, lo_num, hi_num;
+
+    if (!t->compressed || s >= 40) {
+        t->modulus = 1;
+        t->residue_count = !t->compressed || ((low40 >> 32) & 0xFF) == 0x01;
+        t->residues = malloc(sizeof(uint64_t));
+        if (t->residues)
+            t->residues[0] = 0;
+        return t->residues != NULL;
+    }
+
+    t->modulus = 1ULL << (40 - s);
+    mask = t->modulus - 1;
+    a = low40 >> s;
+    b = low40 & ((1ULL << s) - 1);
+    for (int k = 0; k < s; k++)
+        q *= 29;
+    /* Newton's iteration doubles the correct low bits of the inverse */
+    qinv = q;
+    for (int k = 0; k < 6; k++)
+        qinv *= 2 - q * qinv;
+
+    lo_num = (int64_t)(1ULL << 32) - (int64_t)b;
+    hi_num = (int64_t)(1ULL << 33) - 1 - (int64_t)b;
+    c_lo = lo_num <= 0 ? 0 : (lo_num + (int64_t)(1ULL << s) - 1) >> s;
+    c_hi = hi_num < 0 ? -1 : hi_num >> s;
+    if (c_hi > (int64_t)mask)
+        c_hi = (int64_t)mask;
+    t->residue_count = c_hi >= c_lo ? (uint64_t)(c_hi - c_lo + 1) : 0;
+    if (t->residue_count > JUMP_MAX_RESIDUES) {
+        fprintf(stderr, "Error: JUMP needs at least 16 known characters after the unknown ones\n");
+        return 0;
+    }
+    t->residues = malloc((t->residue_count ? t->residue_count : 1) * sizeof(uint64_t));
+    if (!t->residues)
+        return 0;
+    for (uint64_t k = 0; k < t->residue_count; k++)
+        t->residues[k] = (((uint64_t)c_lo + k - a) * qinv) & mask;
+    qsort(t->residues, t->residue_count, sizeof(uint64_t), cmp_u64);
+    return 1;
+}
+
+/* Build the tables for a WIF whose unknown characters form one block.
+ * Returns NULL when JUMP cannot be used for it. */
+JumpTables *jump_tables_create(const char *wif, int compressed) {
+    JumpTables *t = calloc(1, sizeof(JumpTables));
+    char buf[WIF_CHARS_MAX + 1];
+    unsigned __int128 limit = 1, blocks;
+    uint64_t rem, tail = 0;
+    int s;
+
+    if (!t)
+        return NULL;
+    t->len = (int)strlen(wif);
+    t->compressed = compressed;
+    t->first = -1;
+    if (t->len != (compressed ? COMPRESSED_WIF_LENGTH : COMPRESSED_WIF_LENGTH - 1)) {
+        fprintf(stderr, "Error: JUMP needs a WIF of full length\n");
+        goto fail;
+    }
+    for (int i = 0; i < t->len; ++i) {
+        if (wif[i] != UNKNOWN_CHAR)
+            continue;
+        if (t->first >= 0 && i != t->last + 1) {
+            fprintf(stderr, "Error: JUMP needs the unknown characters in one block\n");
+            goto fail;
+        }
+        if (t->first < 0)
+            t->first = i;
+        t->last = i;
+    }
+    if (t->first < 0 || t->last - t->first + 1 > 21) {
+        fprintf(stderr, "Error: JUMP needs 1 to 21 unknown characters\n");
+        goto fail;
+    }
+
+    memcpy(t->wif, wif, t->len + 1);
+    memcpy(buf, wif, t->len + 1);
+    memset(buf + t->first, '1', t->last - t->first + 1);
+    if (!wif_num_from_base58(&t->base, buf)) {
+        fprintf(stderr, "Error: WIF contains characters outside of Base58\n");
+        goto fail;
+    }
+    s = t->len - 1 - t->last;
+    wif_num_set_pow58(&t->diff, s);
+    if (!find_residues(t, s))
+        goto fail;
+
+    /* ranks below 58^u: whole periods plus the residues of the last one */
+    for (int i = t->first; i <= t->last; ++i)
+        limit *= 58;
+    blocks = limit / t->modulus;
+    rem = (uint64_t)(limit % t->modulus);
+    for (uint64_t k = 0; k < t->residue_count; k++)
+        tail += t->residues[k] < rem;
+    if (t->residue_count && blocks > (UINT64_MAX - tail) / t->residue_count) {
+        fprintf(stderr, "Error: too many unknown characters, keyspace exceeds 2^64\n");
+        goto fail;
+    }
+    t->total = (uint64_t)blocks * t->residue_count + tail;
+    return t;
+
+fail:
+    jump_tables_free(t);
+    return NULL;
+}
+
+void jump_tables_free(JumpTables *t) {
+    if (!t)
+        return;
+    free(t->residues);
+    free(t);
+}
+
+/* First rank whose block value is not below the one of ``wif``, so that a
+ * search can resume from a WIF it printed.  0 if ``wif`` does not match the
+ * known characters. */
+uint64_t jump_rank(const JumpTables *t, const char *wif) {
+    unsigned __int128 i = 0;
+    uint64_t lo = 0, hi = t->residue_count, rank;
+
+    if ((int)strlen(wif) != t->len)
+        return 0;
+    for (int k = 0; k < t->len; ++k) {
+        int d = base58_digit(wif[k]);
+        if (k < t->first || k > t->last) {
+            if (wif[k] != t->wif[k])
+                return 0;
+        } else if (d < 0) {
+            return 0;
+        } else {
+            i = i * 58 + (unsigned)d;
+        }
+    }
+    while (lo < hi) {
+        uint64_t mid = (lo + hi) / 2;
+        if (t->residues[mid] < (uint64_t)(i % t->modulus))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    rank = (uint64_t)(i / t->modulus) * t->residue_count + lo;
+    return rank < t->total ? rank : t->total;
+}
+
+/* num = value of the candidate at ``rank`` */
+void jump_value(const JumpTables *t, uint64_t rank, wif_num *num) {
+    unsigned __int128 i = (unsigned __int128)(rank / t->residue_count) * t->modulus +
+                          t->residues[rank % t->residue_count];
+    *num = t->base;
+    add_steps(t, num, i);
+}
+
+/* Move ``num`` from the candidate at ``rank`` to the one at rank + 1. */
+void jump_next(const JumpTables *t, uint64_t rank, wif_num *num) {
+    uint64_t k = rank % t->residue_count;
+    uint64_t gap = k + 1 < t->residue_count ? t->residues[k + 1] - t->residues[k]
+                                            : t->modulus - t->residues[k] + t->residues[0];
+    add_steps(t, num, gap);
+}
@@ -0,0 +1,38 @@
+#ifndef JUMP_H
+#define JUMP_H
+
+#include "bitcoin.h"
+
+#define JUMP_MAX_RESIDUES (1 << 16)
+
+/* JUMP treats the unknown characters of a WIF as one block: their Base58
+ * value i adds i * 58^s to the value of the WIF, where s is the number of
+ * known characters after the block.  A step of the block only moves the bits
+ * above the lowest s, so the compression flag byte (bits 32..39) takes its
+ * valid value 0x01 for the same few residues of i in every period of
+ * 2^(40 - s) steps, the jump length.  Only those steps are visited.
+ *
+ * Rank r stands for i = (r / residue_count) * modulus + residues[r %
+ * residue_count], so candidates come in increasing order of the block and a
+ * WIF can be turned back into the rank to resume from. */
+typedef struct {
+    int len;
+    int compressed;
+    char wif[WIF_CHARS_MAX + 1];
+    int first, last;          /* unknown block */
+    wif_num base;             /* value with every unknown character at '1' */
+    wif_num diff;             /* 58^s */
+    uint64_t modulus;         /* jump length */
+    uint64_t *residues;       /* steps i mod modulus with a valid flag, ascending */
+    uint64_t residue_count;
+    uint64_t total;           /* number of ranks */
+} JumpTables;
+
+JumpTables *jump_tables_create(const char *wif, int compressed);
+void jump_tables_free(JumpTables *t);
+
+uint64_t jump_rank(const JumpTables *t, const char *wif);
+void jump_value(const JumpTables *t, uint64_t rank, wif_num *num);
+void jump_next(const JumpTables *t, uint64_t rank, wif_num *num);
+
+#endif /* JUMP_H */
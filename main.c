@@ -1,4 +1,9 @@
+#include "checkpoint.h"
 #include "configuration.h"
+#include "plan.h"
+#include "progress.h"
+#include "shard.h"
+#include "sink.h"
 #include "worker.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -52,29 +57,135 @@ static void read_email_configuration(Configuration *config, const char *file) {
     }
 }
 
+static void usage(void) {
+    show_file("help.txt");
+    show_file("footer.txt");
+}
+
 int main(int argc, char **argv) {
-    if (argc < 2 || (strcmp(argv[1], "--help") == 0)) {
-        show_file("help.txt");
-        show_file("footer.txt");
+    const char *files[2] = {NULL, NULL};
+    const char *checkpoint = NULL, *metrics = NULL, *results = NULL, *gen_table = NULL;
+    char shard_file[1024], default_checkpoint[sizeof(shard_file) + 16];
+    int nfiles = 0, period = CHECKPOINT_PERIOD, max_runtime = 0, no_checkpoint = 0;
+    int shard = 0, shards = 0;
+    int progress = STATUS_PERIOD / 1000, metrics_period = PROGRESS_METRICS_PERIOD;
+    int plan_only = 0, plan_auto = 0, results_sync = SINK_SYNC_EVERY, key_threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--help") == 0) {
+            usage();
+            return 0;
+        } else if (strcmp(arg, "--plan") == 0) {
+            plan_only = 1;
+        } else if (strcmp(arg, "--auto") == 0) {
+            plan_auto = 1;
+        } else if (strcmp(arg, "--no-checkpoint") == 0) {
+            no_checkpoint = 1;
+        } else if (strcmp(arg, "--checkpoint") == 0 && i + 1 < argc) {
+            checkpoint = argv[++i];
+        } else if (strcmp(arg, "--checkpoint-interval") == 0 && i + 1 < argc) {
+            period = atoi(argv[++i]);
+        } else if (strcmp(arg, "--max-runtime") == 0 && i + 1 < argc) {
+            max_runtime = atoi(argv[++i]);
+        } else if (strcmp(arg, "--progress-interval") == 0 && i + 1 < argc) {
+            progress = atoi(argv[++i]);
+        } else if (strcmp(arg, "--metrics") == 0 && i + 1 < argc) {
+            metrics = argv[++i];
+        } else if (strcmp(arg, "--metrics-interval") == 0 && i + 1 < argc) {
+            metrics_period = atoi(argv[++i]);
+        } else if (strcmp(arg, "--results") == 0 && i + 1 < argc) {
+            results = argv[++i];
+        } else if (strcmp(arg, "--results-sync") == 0 && i + 1 < argc) {
+            if (!sink_parse_sync(argv[++i], &results_sync)) {
+                fprintf(stderr, "Invalid sync policy: %s (expected every, never or seconds)\n",
+                        argv[i]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--key-threads") == 0 && i + 1 < argc) {
+            key_threads = atoi(argv[++i]);
+        } else if (strcmp(arg, "--gen-table") == 0 && i + 1 < argc) {
+            gen_table = argv[++i];
+        } else if (strcmp(arg, "--shard") == 0 && i + 1 < argc) {
+            if (!shard_parse(argv[++i], &shard, &shards)) {
+                fprintf(stderr, "Invalid shard: %s (expected i/N)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--merge") == 0) {
+            return shard_merge((const char *const *)argv + i + 1, (size_t)(argc - i - 1)) ? 0 : 1;
+        } else if (strncmp(arg, "--", 2) == 0 || nfiles == 2) {
+            fprintf(stderr, "Unknown argument: %s\n", arg);
+            return 1;
+        } else {
+            files[nfiles++] = arg;
+        }
+    }
+    if (nfiles == 0) {
+        usage();
         return 0;
     }
+    /* before anything multiplies, the plan's calibration included */
+    if (gen_table && !ec_gen_table_open(gen_table))
+        fprintf(stderr, "Warning: cannot use the generator table %s, using the built-in one\n",
+                gen_table);
 
-    const char *config_file = argv[1];
+    const char *config_file = files[0];
     Configuration *cfg = configuration_load_from_file(config_file);
+    Configuration *planned = NULL;
     if (!cfg) {
         fprintf(stderr, "Failed to load configuration: %s\n", config_file);
         return 1;
     }
 
-    if (argc > 2) {
-        read_email_configuration(cfg, argv[2]);
+    /* size the job and time every solver that can do it; --auto goes on
+     * with the fastest */
+    if (plan_only || plan_auto) {
+        Plan plan;
+        if (!plan_create(cfg, PLAN_CALIBRATION, &plan)) {
+            fprintf(stderr, "Nothing to plan: %s has no WIF\n", config_file);
+            configuration_free(cfg);
+            return 1;
+        }
+        plan_print(stdout, &plan);
+        /* a timing run that found the key leaves nothing to run */
+        if (plan_only || plan.found_count > 0) {
+            configuration_free(cfg);
+            return 0;
+        }
+        if (plan.best >= 0 && plan.strategies[plan.best].work != configuration_get_work(cfg))
+            planned = plan_configuration(cfg, plan.strategies[plan.best].work);
+    }
+    Configuration *job = planned ? planned : cfg;
+
+    if (files[1]) {
+        read_email_configuration(job, files[1]);
+    }
+
+    /* shard results and progress go next to the configuration file unless
+     * told otherwise, one file per shard */
+    if (shards > 1) {
+        snprintf(shard_file, sizeof(shard_file), "%s.shard-%d-of-%d", config_file, shard + 1,
+                 shards);
+        configuration_set_shard(job, shard, shards, shard_file);
+    }
+    if (!checkpoint) {
+        snprintf(default_checkpoint, sizeof(default_checkpoint), "%s.checkpoint",
+                 shards > 1 ? shard_file : config_file);
+        checkpoint = default_checkpoint;
     }
+    configuration_set_checkpoint(job, no_checkpoint ? NULL : checkpoint, period);
+    configuration_set_max_runtime(job, max_runtime);
+    configuration_set_progress(job, progress, metrics, metrics_period);
+    configuration_set_results(job, results, results_sync);
+    configuration_set_key_threads(job, key_threads);
 
-    Worker *worker = worker_create(cfg);
+    Worker *worker = worker_create(job);
     worker_run(worker);
 
     worker_free(worker);
+    configuration_free(planned);
     configuration_free(cfg);
+    ec_gen_table_close();
 
     show_file("footer.txt");
     return 0;
@@ -0,0 +1,441 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bitcoin.h"
+#include "jump.h"
+#include "plan.h"
+#include "progress.h"
+#include "worker.h"
+
+#define ROTATE_RADIX 57 /* replacements of a character */
+
+/* The job as a full-length WIF with UNKNOWN_CHAR where a character is
+ * missing, and the characters each of those may be. */
+typedef struct {
+    int len;
+    int compressed;
+    char wif[WIF_CHARS_MAX + 1];
+    const char *sets[WIF_CHARS_MAX];
+    const double *weights[WIF_CHARS_MAX];
+    int unknown, first, last;
+} Pattern;
+
+static const char *next_set(const guess_entry **ge, const double **weights) {
+    const char *chars = BASE58_ALPHABET;
+    *weights = NULL;
+    if (*ge) {
+        if (strcmp((*ge)->chars, "*") != 0) {
+            chars = (*ge)->chars;
+            *weights = (*ge)->weights;
+        }
+        *ge = (*ge)->next;
+    }
+    return chars;
+}
+
+/* SEARCH and JUMP name the unknown characters, END only the prefix. */
+static int pattern_create(const Configuration *config, Pattern *p) {
+    const char *wif = configuration_get_wif(config);
+    const guess_entry *ge = config->guess;
+    WORK work = configuration_get_work(config);
+    size_t len;
+
+    memset(p, 0, sizeof(*p));
+    p->first = -1;
+    p->compressed = configuration_is_compressed(config);
+    if (!wif || (len = strlen(wif)) > WIF_CHARS_MAX)
+        return 0;
+    memcpy(p->wif, wif, len + 1);
+    p->len = (int)len;
+    if (work == WORK_END) {
+        int full = p->compressed ? COMPRESSED_WIF_LENGTH : COMPRESSED_WIF_LENGTH - 1;
+        if (p->len < full) {
+            memset(p->wif + p->len, UNKNOWN_CHAR, full - p->len);
+            p->wif[full] = '\0';
+            p->len = full;
+        }
+    } else if (work != WORK_SEARCH && work != WORK_JUMP) {
+        return 0;
+    }
+    for (int i = 0; i < p->len; ++i) {
+        if (p->wif[i] != UNKNOWN_CHAR)
+            continue;
+        p->sets[i] = work == WORK_JUMP ? BASE58_ALPHABET : next_set(&ge, &p->weights[i]);
+        if (p->first < 0)
+            p->first = i;
+        p->last = i;
+        p->unknown++;
+    }
+    return 1;
+}
+
+static int full_length(const Pattern *p) {
+    return p->len == (p->compressed ? COMPRESSED_WIF_LENGTH : COMPRESSED_WIF_LENGTH - 1);
+}
+
+static const char *jump_shape(const Pattern *p) {
+    if (!full_length(p))
+        return "needs a WIF of full length";
+    if (p->unknown == 0 || p->last - p->first + 1 != p->unknown)
+        return "the unknown characters are not in one block";
+    if (p->unknown > 21)
+        return "more than 21 unknown characters";
+    if (p->len - 1 - p->last < 16)
+        return "fewer than 16 known characters after the unknown ones";
+    return NULL;
+}
+
+static const char *end_shape(const Pattern *p) {
+    if (p->unknown == 0 || p->last != p->len - 1 || p->last - p->first + 1 != p->unknown)
+        return "the unknown characters are not at the end";
+    return NULL;
+}
+
+static guess_entry *guess_add(guess_entry **head, guess_entry *tail, const char *chars,
+                              const double *weights) {
+    guess_entry *ge = calloc(1, sizeof(guess_entry));
+    if (!ge)
+        return tail;
+    ge->index = tail ? tail->index + 1 : 0;
+    ge->chars = strdup(chars);
+    if (weights && (ge->weights = malloc(strlen(chars) * sizeof(double) + 1)))
+        memcpy(ge->weights, weights, strlen(chars) * sizeof(double));
+    if (tail)
+        tail->next = ge;
+    else
+        *head = ge;
+    return ge;
+}
+
+Configuration *plan_configuration(const Configuration *config, WORK work) {
+    WORK own = configuration_get_work(config);
+    const char *status = configuration_get_wif_status(config);
+    guess_entry *guess = NULL, *tail = NULL;
+    char wif[WIF_CHARS_MAX + 1];
+    int *threads = configuration_get_force_threads(config);
+    Configuration *c;
+    Pattern p;
+
+    if (!pattern_create(config, &p)) {
+        const char *orig = configuration_get_wif(config);
+        if (work != own || !orig || strlen(orig) > WIF_CHARS_MAX)
+            return NULL;
+        strcpy(wif, orig);
+        for (const guess_entry *ge = config->guess; ge; ge = ge->next)
+            tail = guess_add(&guess, tail, ge->chars, ge->weights);
+    } else {
+        if ((work == WORK_JUMP && jump_shape(&p)) || (work == WORK_END && end_shape(&p)) ||
+            (work != WORK_SEARCH && work != WORK_JUMP && work != WORK_END))
+            return NULL;
+        strcpy(wif, p.wif);
+        if (work == WORK_END)
+            wif[p.first] = '\0';
+        for (int i = 0; work != WORK_JUMP && i < p.len; ++i)
+            if (p.sets[i])
+                tail = guess_add(&guess, tail, p.sets[i], p.weights[i]);
+        /* the status line of JUMP is a WIF to resume from */
+        if (work != own)
+            status = "";
+    }
+    c = configuration_create(configuration_get_target_address(config), wif, status, work,
+                             guess);
+    if (c && threads) {
+        c->forced_threads = *threads;
+        configuration_set_force_threads(c, &c->forced_threads);
+    }
+    return c;
+}
+
+/* Keep the keys a timing run found, once each. */
+static void plan_found(Plan *plan, const Worker *w) {
+    for (size_t i = 0; i < w->result_count && plan->found_count < PLAN_FOUND_MAX; ++i) {
+        int seen = 0;
+        for (int k = 0; k < plan->found_count && !seen; ++k)
+            seen = strcmp(plan->found[k], w->results[i]) == 0;
+        if (!seen && strlen(w->results[i]) <= WIF_CHARS_MAX)
+            strcpy(plan->found[plan->found_count++], w->results[i]);
+    }
+}
+
+/* Candidates per second of a short run of the job as ``work``. */
+static double calibrate(const Configuration *config, WORK work, int seconds, Plan *plan) {
+    Configuration *c = plan_configuration(config, work);
+    Worker *w;
+    double rate = 0;
+    int out, null;
+
+    if (!c)
+        return 0;
+    configuration_set_max_runtime(c, seconds);
+    configuration_set_progress(c, 0, NULL, 0);
+    fflush(stdout);
+    out = dup(STDOUT_FILENO);
+    null = open("/dev/null", O_WRONLY);
+    if (out >= 0 && null >= 0)
+        dup2(null, STDOUT_FILENO);
+    if (null >= 0)
+        close(null);
+    w = worker_create(c);
+    if (w) {
+        worker_run(w);
+        if (w->elapsed > 0)
+            rate = (double)w->tried / w->elapsed;
+        plan_found(plan, w);
+    }
+    fflush(stdout);
+    if (out >= 0) {
+        dup2(out, STDOUT_FILENO);
+        close(out);
+    }
+    worker_free(w);
+    configuration_free(c);
+    return rate;
+}
+
+/* Product of the set sizes; 0 if it reaches 2^64. */
+static uint64_t search_count(const Pattern *p) {
+    unsigned __int128 n = 1;
+    for (int i = 0; i < p->len; ++i) {
+        if (!p->sets[i])
+            continue;
+        n *= strlen(p->sets[i]);
+        if (n > UINT64_MAX)
+            return 0;
+    }
+    return (uint64_t)n;
+}
+
+/* Unknown checksum characters of a full WIF are derived from the key, not
+ * searched: each candidate is then about span / 2^shift keys, of which the
+ * known characters below the top unknown one keep 1 in 58 each. */
+static void size_search(const Pattern *p, PlanStrategy *s) {
+    Pattern top = *p;
+    int window = full_length(p) ? configuration_get_checksum_chars(p->compressed) : 0;
+    int derived = -1, known = 0;
+    double span = 1;
+
+    for (int e = 0; e < window; ++e) {
+        if (p->wif[p->len - 1 - e] == UNKNOWN_CHAR) {
+            top.sets[p->len - 1 - e] = NULL;
+            derived = e;
+        }
+    }
+    for (int e = 0; e <= derived; ++e) {
+        span *= 58;
+        if (p->wif[p->len - 1 - e] != UNKNOWN_CHAR)
+            known++;
+    }
+    s->candidates = search_count(&top);
+    if (s->candidates == 0)
+        s->reason = "2^64 candidates or more";
+    if (derived < 0) {
+        s->survivors = s->keys = (double)s->candidates / 4294967296.0;
+        return;
+    }
+    s->survivors = -1;
+    s->keys = (double)s->candidates * span / (p->compressed ? 1099511627776.0 : 4294967296.0);
+    while (known--)
+        s->keys /= 58;
+}
+
+static void size_jump(const Configuration *config, const Pattern *p, PlanStrategy *s) {
+    const char *status = configuration_get_wif_status(config);
+    JumpTables *t;
+    if ((s->reason = jump_shape(p)))
+        return;
+    t = jump_tables_create(p->wif, p->compressed);
+    if (!t) {
+        s->reason = "no jump applies to this WIF";
+        return;
+    }
+    s->candidates = t->total;
+    if (configuration_get_work(config) == WORK_JUMP && status && *status)
+        s->candidates -= jump_rank(t, status);
+    s->survivors = s->keys = (double)s->candidates / 4294967296.0;
+    jump_tables_free(t);
+}
+
+/* END computes a public key for every key of its interval, unless the hint
+ * sets leave fewer strings than keys and it walks them like SEARCH. */
+static void size_end(const Pattern *p, PlanStrategy *s) {
+    char prefix[WIF_CHARS_MAX + 1];
+    wif_num first;
+    uint64_t walk = search_count(p);
+    if ((s->reason = end_shape(p)))
+        return;
+    memcpy(prefix, p->wif, p->first);
+    prefix[p->first] = '\0';
+    if (!worker_end_key_range(prefix, p->unknown, p->compressed, &first, &s->candidates)) {
+        s->reason = "2^64 keys or more";
+        return;
+    }
+    if (walk && walk < s->candidates) {
+        s->reason = "the hint sets leave fewer WIFs than keys, END would run SEARCH";
+        return;
+    }
+    s->survivors = -1;
+    s->keys = (double)s->candidates;
+}
+
+static uint64_t binomial(int n, int k) {
+    unsigned __int128 r = 1;
+    if (k < 0 || k > n)
+        return 0;
+    for (int i = 1; i <= k; ++i)
+        r = r * (unsigned)(n - k + i) / (unsigned)i;
+    return r > UINT64_MAX ? 0 : (uint64_t)r;
+}
+
+/* Every WIF differing in 1 .. depth characters; a character outside of
+ * Base58 is always among them. */
+static void size_rotate(const Configuration *config, PlanStrategy *s) {
+    const char *wif = configuration_get_wif(config);
+    const char *status = configuration_get_wif_status(config);
+    int len = (int)strlen(wif), bad = 0, depth = 1;
+    unsigned __int128 total = 0;
+
+    if (status && *status && atoi(status) >= 1 && atoi(status) <= len)
+        depth = atoi(status);
+    for (int i = 0; i < len; ++i)
+        bad += base58_digit(wif[i]) < 0;
+    for (int d = 1; d <= depth && bad <= 1; ++d) {
+        int m = d - bad;
+        unsigned __int128 n = binomial(len - bad, m);
+        for (int i = 0; i < m && n; ++i)
+            n *= ROTATE_RADIX;
+        if (bad)
+            n *= ROTATE_RADIX + 1;
+        total += n;
+        if (total > UINT64_MAX)
+            break;
+    }
+    if (bad > 1)
+        s->reason = "more than one character outside of Base58";
+    else if (total > UINT64_MAX)
+        s->reason = "2^64 candidates or more";
+    else
+        s->candidates = (uint64_t)total;
+    s->survivors = s->keys = (double)s->candidates / 4294967296.0;
+}
+
+/* Positions holding a character of some hint set take every character of
+ * the first such set. */
+static void size_alike(const Configuration *config, PlanStrategy *s) {
+    const char *wif = configuration_get_wif(config);
+    unsigned __int128 n = 1;
+    for (size_t i = 0; wif[i] && n <= UINT64_MAX; ++i) {
+        for (const guess_entry *ge = config->guess; ge; ge = ge->next) {
+            if (strchr(ge->chars, wif[i])) {
+                n *= strlen(ge->chars);
+                break;
+            }
+        }
+    }
+    if (n > UINT64_MAX)
+        s->reason = "2^64 candidates or more";
+    else
+        s->candidates = (uint64_t)n;
+    s->survivors = s->keys = (double)s->candidates / 4294967296.0;
+}
+
+/* LIST ranks are the bytes of the candidate file; a line of 53 is a WIF,
+ * about one in 2^32 of them passes the checksum. */
+static void size_list(const Configuration *config, PlanStrategy *s) {
+    const char *path = configuration_get_wif(config);
+    struct stat st;
+    if (strcmp(path, "-") == 0) {
+        s->reason = "reads standard input";
+        return;
+    }
+    if (stat(path, &st) != 0) {
+        s->reason = "the candidate file cannot be read";
+        return;
+    }
+    s->candidates = (uint64_t)st.st_size;
+    s->survivors = s->keys = (double)s->candidates / 53 / 4294967296.0;
+}
+
+int plan_create(const Configuration *config, int calibration, Plan *plan) {
+    static const WORK alternatives[PLAN_STRATEGIES] = {WORK_SEARCH, WORK_JUMP, WORK_END};
+    Pattern p;
+
+    memset(plan, 0, sizeof(*plan));
+    plan->best = -1;
+    plan->work = configuration_get_work(config);
+    if (!configuration_get_wif(config))
+        return 0;
+    if (pattern_create(config, &p)) {
+        plan->unknown = p.unknown;
+        for (int i = 0; i < PLAN_STRATEGIES; ++i) {
+            PlanStrategy *s = &plan->strategies[plan->count++];
+            s->work = alternatives[i];
+            if (s->work == WORK_SEARCH)
+                size_search(&p, s);
+            else if (s->work == WORK_JUMP)
+                size_jump(config, &p, s);
+            else
+                size_end(&p, s);
+        }
+    } else {
+        PlanStrategy *s = &plan->strategies[plan->count++];
+        s->work = plan->work;
+        if (s->work == WORK_ROTATE)
+            size_rotate(config, s);
+        else if (s->work == WORK_ALIKE)
+            size_alike(config, s);
+        else if (s->work == WORK_LIST)
+            size_list(config, s);
+        else
+            s->reason = "unknown solver";
+    }
+    for (int i = 0; i < plan->count; ++i) {
+        PlanStrategy *s = &plan->strategies[i];
+        s->seconds = -1;
+        if (s->reason || calibration <= 0)
+            continue;
+        s->rate = calibrate(config, s->work, calibration, plan);
+        if (s->rate <= 0)
+            continue;
+        s->seconds = (double)s->candidates / s->rate;
+        if (plan->best < 0 || s->seconds < plan->strategies[plan->best].seconds)
+            plan->best = i;
+    }
+    return 1;
+}
+
+void plan_print(FILE *f, const Plan *plan) {
+    char eta[32];
+    fprintf(f, "Plan for %s", work_to_string(plan->work));
+    if (plan->work == WORK_SEARCH || plan->work == WORK_JUMP || plan->work == WORK_END)
+        fprintf(f, ", %d unknown character(s)", plan->unknown);
+    fprintf(f, "\n");
+    for (int i = 0; i < plan->count; ++i) {
+        const PlanStrategy *s = &plan->strategies[i];
+        fprintf(f, "%-7s ", work_to_string(s->work));
+        if (s->reason) {
+            fprintf(f, "not applicable: %s\n", s->reason);
+            continue;
+        }
+        progress_format_duration(s->seconds, eta, sizeof(eta));
+        fprintf(f, "%llu candidates, ", (unsigned long long)s->candidates);
+        if (s->survivors < 0)
+            fprintf(f, "no checksum filter, ");
+        else
+            fprintf(f, "%.3g checksum survivors, ", s->survivors);
+        fprintf(f, "%.3g public keys, ", s->keys);
+        if (s->rate > 0)
+            fprintf(f, "%.0f/s, about %s\n", s->rate, eta);
+        else
+            fprintf(f, "rate unknown\n");
+    }
+    if (plan->best >= 0) {
+        const PlanStrategy *s = &plan->strategies[plan->best];
+        progress_format_duration(s->seconds, eta, sizeof(eta));
+        fprintf(f, "Fastest: %s, about %s%s\n", work_to_string(s->work), eta,
+                s->work == plan->work ? "" : " (--auto runs it)");
+    }
+    for (int i = 0; i < plan->found_count; ++i)
+        fprintf(f, "Found while timing: %s\n", plan->found[i]);
+}
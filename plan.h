@@ -0,0 +1,51 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "bitcoin.h"
+#include "configuration.h"
+
+#define PLAN_CALIBRATION 2 /* seconds each strategy is measured for */
+#define PLAN_STRATEGIES 3
+#define PLAN_FOUND_MAX 8   /* keys the timing runs may turn up */
+
+/* A job with unknown characters on known positions can be solved by SEARCH
+ * (every combination), JUMP (one block of unknowns, only the steps with a
+ * valid compression flag) or END (unknowns at the end, every private key of
+ * the interval the prefix leaves).  The plan sizes the job for each of them
+ * and times a short run of each on this machine. */
+typedef struct {
+    WORK work;
+    const char *reason;   /* why the strategy does not apply, or NULL */
+    uint64_t candidates;  /* keyspace ranks: WIFs, keys for END, bytes for LIST */
+    double survivors;     /* expected to pass the WIF checksum, -1: no filter */
+    double keys;          /* expected public keys to compute */
+    double rate;          /* measured candidates per second, 0 if unknown */
+    double seconds;       /* estimated wall time, -1 if unknown */
+} PlanStrategy;
+
+typedef struct {
+    WORK work;            /* of the configuration */
+    int unknown;          /* unknown characters */
+    PlanStrategy strategies[PLAN_STRATEGIES];
+    int count;
+    int best;             /* index of the fastest, or -1 */
+    /* keys a timing run found: the job is done already */
+    char found[PLAN_FOUND_MAX][WIF_CHARS_MAX + 1];
+    int found_count;
+} Plan;
+
+/* Size the job of ``config`` for every strategy and, unless ``calibration``
+ * is 0, time each applicable one for that many seconds (stdout is muted
+ * meanwhile, the keys those runs find are kept in ``found``).  ROTATE,
+ * ALIKE and LIST have no alternative and are sized only.  Returns 0 if the
+ * configuration has no WIF. */
+int plan_create(const Configuration *config, int calibration, Plan *plan);
+void plan_print(FILE *f, const Plan *plan);
+
+/* The job of ``config`` recast for the solver ``work``, e.g. the plan's
+ * best strategy; NULL if it does not apply. */
+Configuration *plan_configuration(const Configuration *config, WORK work);
+
+#endif /* PLAN_H */
@@ -0,0 +1,131 @@
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "progress.h"
+
+static volatile sig_atomic_t requested;
+static struct sigaction old_usr1;
+
+static void on_signal(int sig) {
+    (void)sig;
+    requested = 1;
+}
+
+void progress_catch_signal(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    requested = 0;
+    sigaction(SIGUSR1, &sa, &old_usr1);
+}
+
+void progress_restore_signal(void) {
+    sigaction(SIGUSR1, &old_usr1, NULL);
+}
+
+int progress_requested(void) {
+    return __atomic_exchange_n(&requested, 0, __ATOMIC_RELAXED) != 0;
+}
+
+void progress_sum(ProgressCounters *out, const ProgressCounters *c) {
+    out->tried += __atomic_load_n(&c->tried, __ATOMIC_RELAXED);
+    out->survivors += __atomic_load_n(&c->survivors, __ATOMIC_RELAXED);
+    out->evaluated += __atomic_load_n(&c->evaluated, __ATOMIC_RELAXED);
+    out->results += __atomic_load_n(&c->results, __ATOMIC_RELAXED);
+}
+
+double progress_eta(const ProgressReport *r) {
+    if (r->done >= r->total)
+        return 0;
+    if (r->rate <= 0)
+        return -1;
+    return (double)(r->total - r->done) / r->rate;
+}
+
+void progress_format_duration(double seconds, char *buf, size_t size) {
+    unsigned long long s, d, h, m;
+    if (seconds < 0) {
+        snprintf(buf, size, "?");
+        return;
+    }
+    s = (unsigned long long)(seconds + 0.5);
+    d = s / 86400;
+    h = s / 3600 % 24;
+    m = s / 60 % 60;
+    s %= 60;
+    if (d)
+        snprintf(buf, size, "%llud%02lluh%02llum%02llus", d, h, m, s);
+    else if (h)
+        snprintf(buf, size, "%lluh%02llum%02llus", h, m, s);
+    else if (m)
+        snprintf(buf, size, "%llum%02llus", m, s);
+    else
+        snprintf(buf, size, "%llus", s);
+}
+
+static double percent(const ProgressReport *r) {
+    return r->total ? 100.0 * (double)r->done / (double)r->total : 100.0;
+}
+
+void progress_print(FILE *f, const ProgressReport *r) {
+    char eta[32];
+    progress_format_duration(progress_eta(r), eta, sizeof(eta));
+    fprintf(f, "Progress: %.2f%% %llu/%llu candidates, %.0f/s, ETA %s, %llu checksum(s) passed, "
+               "%llu key(s) checked, %llu result(s)\n",
+            percent(r), (unsigned long long)r->done, (unsigned long long)r->total, r->rate, eta,
+            (unsigned long long)r->counters.survivors, (unsigned long long)r->counters.evaluated,
+            (unsigned long long)r->counters.results);
+    fflush(f);
+}
+
+static void metric(FILE *f, const char *name, const char *type, const char *help, double value) {
+    fprintf(f, "# HELP %s %s\n# TYPE %s %s\n%s %.17g\n", name, help, name, type, name, value);
+}
+
+int progress_write_metrics(const char *path, const ProgressReport *r) {
+    char tmp[1024];
+    FILE *f;
+    int ok;
+
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+        return 0;
+    f = fopen(tmp, "w");
+    if (!f) {
+        perror(tmp);
+        return 0;
+    }
+    metric(f, "wifcrack_candidates_total", "counter", "Candidates tried by this process.",
+           (double)r->counters.tried);
+    metric(f, "wifcrack_checksum_survivors_total", "counter",
+           "Candidates with a valid WIF checksum.", (double)r->counters.survivors);
+    metric(f, "wifcrack_ec_evaluations_total", "counter", "Public keys computed and hashed.",
+           (double)r->counters.evaluated);
+    metric(f, "wifcrack_results_total", "counter", "Keys found.", (double)r->counters.results);
+    metric(f, "wifcrack_stage", "gauge", "Scheduler run of the job (ROTATE depth).", r->stage);
+    metric(f, "wifcrack_keyspace_candidates", "gauge", "Candidates in the current run.",
+           (double)r->total);
+    metric(f, "wifcrack_keyspace_done", "gauge", "Candidates of the current run done.",
+           (double)r->done);
+    metric(f, "wifcrack_progress_ratio", "gauge", "Fraction of the current run done.",
+           percent(r) / 100);
+    metric(f, "wifcrack_candidates_per_second", "gauge", "Rate of the current run.", r->rate);
+    metric(f, "wifcrack_eta_seconds", "gauge", "Seconds left at that rate, -1 if unknown.",
+           progress_eta(r));
+    metric(f, "wifcrack_elapsed_seconds", "gauge", "Seconds since the current run started.",
+           r->elapsed);
+    metric(f, "wifcrack_threads", "gauge", "Solver threads.", r->threads);
+    metric(f, "wifcrack_last_update_timestamp_seconds", "gauge",
+           "Unix time of this report; a stale value means a stuck process.",
+           (double)time(NULL));
+    ok = fclose(f) == 0;
+    if (!ok || rename(tmp, path) != 0) {
+        perror(path);
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
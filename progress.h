@@ -0,0 +1,60 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PROGRESS_METRICS_PERIOD 10 /* seconds between metrics files by default */
+
+/* Counters of one solver thread.  Only that thread writes them, with
+ * progress_add(), and the reporter reads them with progress_sum(); relaxed
+ * atomics keep both sides free of locks and system calls.  A cache line of
+ * their own keeps the threads from invalidating each other's. */
+typedef struct {
+    uint64_t tried;     /* candidates (keyspace ranks) done */
+    uint64_t survivors; /* passed the WIF checksum */
+    uint64_t evaluated; /* public keys computed and hashed */
+    uint64_t results;
+} __attribute__((aligned(64))) ProgressCounters;
+
+static inline void progress_add(uint64_t *counter, uint64_t n) {
+    __atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
+
+/* out += c, read from another thread */
+void progress_sum(ProgressCounters *out, const ProgressCounters *c);
+
+/* A snapshot of a job, as printed and written to the metrics file.  ``done``
+ * and ``total`` count the ranks of the current scheduler run (``stage``, see
+ * Checkpoint), including those a checkpoint had done already. */
+typedef struct {
+    ProgressCounters counters;
+    uint64_t done, total;
+    int stage;
+    int threads;
+    double elapsed; /* seconds of the current run */
+    double rate;    /* candidates per second in it */
+} ProgressReport;
+
+/* Seconds left at the current rate, or -1 if unknown. */
+double progress_eta(const ProgressReport *r);
+
+/* "1d02h03m04s", "2h03m04s", "3m04s" or "4s"; "?" for a negative time. */
+void progress_format_duration(double seconds, char *buf, size_t size);
+
+/* One human readable line: percent done, rate, ETA. */
+void progress_print(FILE *f, const ProgressReport *r);
+
+/* Write the report in the Prometheus text format, through a temporary
+ * file renamed over ``path``, so that a scraper never reads half of it.
+ * Returns 1 on success. */
+int progress_write_metrics(const char *path, const ProgressReport *r);
+
+/* SIGUSR1 asks for a report; progress_requested() returns 1 once per
+ * signal. */
+void progress_catch_signal(void);
+void progress_restore_signal(void);
+int progress_requested(void);
+
+#endif /* PROGRESS_H */
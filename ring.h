@@ -0,0 +1,40 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RING_CAPACITY 8 /* a power of two */
+
+/* A bounded queue of pointers between exactly one producer thread and one
+ * consumer thread.  Each side writes only its own index, and the slot is
+ * published with release/acquire ordering, so neither side takes a lock.
+ * The indexes sit on cache lines of their own. */
+typedef struct {
+    void *slots[RING_CAPACITY];
+    uint64_t head __attribute__((aligned(64))); /* next slot to fill, producer only */
+    uint64_t tail __attribute__((aligned(64))); /* next slot to take, consumer only */
+} SpscRing;
+
+/* Returns 0 if the ring is full. */
+static inline int ring_push(SpscRing *r, void *p) {
+    uint64_t head = r->head;
+    if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == RING_CAPACITY)
+        return 0;
+    r->slots[head % RING_CAPACITY] = p;
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/* Returns NULL if the ring is empty. */
+static inline void *ring_pop(SpscRing *r) {
+    uint64_t tail = r->tail;
+    void *p;
+    if (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == tail)
+        return NULL;
+    p = r->slots[tail % RING_CAPACITY];
+    __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+    return p;
+}
+
+#endif /* RING_H */
@@ -0,0 +1,415 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "scheduler.h"
+#include "topology.h"
+
+/* Each split halves a range, so a deque never holds more than 65 entries. */
+#define DEQUE_SIZE 128
+#define DEQUE_MASK (DEQUE_SIZE - 1)
+
+/* The owner pushes and pops at the bottom, thieves take from the top.  The
+ * lock is only contended while a thread is stealing. */
+typedef struct {
+    pthread_mutex_t lock;
+    SchedulerRange ranges[DEQUE_SIZE];
+    unsigned top, bottom;
+} __attribute__((aligned(64))) SchedDeque;
+
+typedef struct {
+    Scheduler *s;
+    int id;
+    int cpu;        /* to pin the thread to, or -1 */
+    uint64_t rng;
+    pthread_t handle;
+} SchedThread;
+
+/* The keyspace starts as a list of seed ranges, cut so that there is at
+ * least one per thread; a thread takes a new seed whenever its own deque is
+ * empty, before it tries to steal. */
+struct Scheduler {
+    scheduler_range_fn fn;
+    void *arg;
+    int threads;
+    uint64_t grain;
+    SchedDeque *deques;
+    SchedulerRange *seeds;
+    size_t seed_count;
+    pthread_mutex_t lock;   /* guards the two flags below for the waits */
+    pthread_cond_t wake;
+    int paused, finished;
+    _Atomic size_t next_seed __attribute__((aligned(64)));
+    _Atomic int stop __attribute__((aligned(64)));
+    _Atomic int pause;
+    _Atomic int active;     /* threads holding or looking for a range */
+    _Atomic uint64_t pending __attribute__((aligned(64))); /* ranks not processed yet */
+};
+
+int scheduler_thread_count(const Configuration *config) {
+    int *forced = configuration_get_force_threads(config);
+    long n = forced && *forced > 0 ? *forced : topology_get()->workers;
+    if (n < 1)
+        n = 1;
+    if (n > SCHEDULER_MAX_THREADS)
+        n = SCHEDULER_MAX_THREADS;
+    return (int)n;
+}
+
+void scheduler_stop(Scheduler *s) {
+    atomic_store_explicit(&s->stop, 1, memory_order_relaxed);
+}
+
+int scheduler_stopped(const Scheduler *s) {
+    return atomic_load_explicit(&((Scheduler *)s)->stop, memory_order_relaxed);
+}
+
+static void deque_push(SchedDeque *d, SchedulerRange r) {
+    pthread_mutex_lock(&d->lock);
+    d->ranges[d->bottom++ & DEQUE_MASK] = r;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static int deque_pop(SchedDeque *d, SchedulerRange *r) {
+    int ok = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom != d->top) {
+        *r = d->ranges[--d->bottom & DEQUE_MASK];
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static int deque_steal(SchedDeque *d, SchedulerRange *r) {
+    int ok = 0;
+    if (pthread_mutex_trylock(&d->lock) != 0)
+        return 0;
+    if (d->bottom != d->top) {
+        *r = d->ranges[d->top++ & DEQUE_MASK];
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static int steal(SchedThread *t, SchedulerRange *r) {
+    Scheduler *s = t->s;
+    int start;
+    t->rng ^= t->rng << 13;
+    t->rng ^= t->rng >> 7;
+    t->rng ^= t->rng << 17;
+    start = (int)(t->rng % (uint64_t)s->threads);
+    for (int i = 0; i < s->threads; ++i) {
+        int victim = (start + i) % s->threads;
+        if (victim != t->id && deque_steal(&s->deques[victim], r))
+            return 1;
+    }
+    return 0;
+}
+
+static int take_seed(Scheduler *s, SchedulerRange *r) {
+    size_t i;
+    if (atomic_load_explicit(&s->next_seed, memory_order_relaxed) >= s->seed_count)
+        return 0;
+    i = atomic_fetch_add(&s->next_seed, 1);
+    if (i >= s->seed_count)
+        return 0;
+    *r = s->seeds[i];
+    return 1;
+}
+
+static void wait_resumed(Scheduler *s) {
+    pthread_mutex_lock(&s->lock);
+    while (s->paused && !scheduler_stopped(s))
+        pthread_cond_wait(&s->wake, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void *scheduler_thread(void *arg) {
+    SchedThread *t = arg;
+    Scheduler *s = t->s;
+    SchedDeque *own = &s->deques[t->id];
+    SchedulerRange r;
+
+    while (!scheduler_stopped(s)) {
+        /* announce first, then look at the flag: scheduler_pause() sets the
+         * flag first, then waits for the count to drop to zero */
+        atomic_fetch_add(&s->active, 1);
+        if (atomic_load(&s->pause)) {
+            atomic_fetch_sub(&s->active, 1);
+            wait_resumed(s);
+            continue;
+        }
+        if (!deque_pop(own, &r) && !take_seed(s, &r) && !steal(t, &r)) {
+            atomic_fetch_sub(&s->active, 1);
+            if (atomic_load(&s->pending) == 0)
+                break;
+            sched_yield();
+            continue;
+        }
+        /* keep the lower half, leave the upper half for thieves */
+        while (r.end - r.begin > s->grain) {
+            uint64_t mid = r.begin + (r.end - r.begin) / 2;
+            deque_push(own, (SchedulerRange){mid, r.end});
+            r.end = mid;
+        }
+        s->fn(s, t->id, r.begin, r.end, s->arg);
+        atomic_fetch_sub(&s->pending, r.end - r.begin);
+        atomic_fetch_sub(&s->active, 1);
+    }
+    return NULL;
+}
+
+/* Threads other than the caller stay on their CPU for good, so that the
+ * memory they touch first is on its node. */
+static void *scheduler_start(void *arg) {
+    SchedThread *t = arg;
+    topology_pin(t->cpu, NULL);
+    return scheduler_thread(t);
+}
+
+typedef struct {
+    Scheduler *s;
+    scheduler_monitor_fn fn;
+    void *arg;
+} SchedMonitor;
+
+static void *monitor_thread(void *arg) {
+    SchedMonitor *m = arg;
+    m->fn(m->s, m->arg);
+    return NULL;
+}
+
+int scheduler_sleep(Scheduler *s, unsigned ms) {
+    struct timespec until;
+    int running;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += ms / 1000;
+    until.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&s->lock);
+    if (!s->finished)
+        pthread_cond_timedwait(&s->wake, &s->lock, &until);
+    running = !s->finished;
+    pthread_mutex_unlock(&s->lock);
+    return running;
+}
+
+void scheduler_pause(Scheduler *s) {
+    pthread_mutex_lock(&s->lock);
+    s->paused = 1;
+    pthread_mutex_unlock(&s->lock);
+    atomic_store(&s->pause, 1);
+    while (atomic_load(&s->active) != 0)
+        sched_yield();
+}
+
+void scheduler_resume(Scheduler *s) {
+    atomic_store(&s->pause, 0);
+    pthread_mutex_lock(&s->lock);
+    s->paused = 0;
+    pthread_cond_broadcast(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static int cmp_range(const void *a, const void *b) {
+    const SchedulerRange *x = a, *y = b;
+    return x->begin < y->begin ? -1 : x->begin > y->begin;
+}
+
+SchedulerRange *scheduler_remaining(Scheduler *s, size_t *count) {
+    size_t seed = atomic_load(&s->next_seed), n = 0, m = 0;
+    SchedulerRange *out;
+
+    *count = 0;
+    if (seed > s->seed_count)
+        seed = s->seed_count;
+    n = s->seed_count - seed;
+    for (int i = 0; i < s->threads; ++i)
+        n += s->deques[i].bottom - s->deques[i].top;
+    if (n == 0 || !(out = malloc(n * sizeof(SchedulerRange))))
+        return NULL;
+    memcpy(out, s->seeds + seed, (s->seed_count - seed) * sizeof(SchedulerRange));
+    m = s->seed_count - seed;
+    for (int i = 0; i < s->threads; ++i) {
+        for (unsigned k = s->deques[i].top; k != s->deques[i].bottom; ++k)
+            out[m++] = s->deques[i].ranges[k & DEQUE_MASK];
+    }
+    qsort(out, n, sizeof(SchedulerRange), cmp_range);
+    m = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (m > 0 && out[m - 1].end == out[i].begin)
+            out[m - 1].end = out[i].end;
+        else
+            out[m++] = out[i];
+    }
+    *count = m;
+    return out;
+}
+
+int scheduler_first_remaining(Scheduler *s, uint64_t *rank) {
+    size_t seed = atomic_load(&s->next_seed);
+    int found = 0;
+
+    for (size_t i = seed; i < s->seed_count; ++i) {
+        if (!found || s->seeds[i].begin < *rank)
+            *rank = s->seeds[i].begin;
+        found = 1;
+    }
+    for (int i = 0; i < s->threads; ++i) {
+        for (unsigned k = s->deques[i].top; k != s->deques[i].bottom; ++k) {
+            const SchedulerRange *r = &s->deques[i].ranges[k & DEQUE_MASK];
+            if (!found || r->begin < *rank)
+                *rank = r->begin;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+SchedulerRange *scheduler_order_ranges(const SchedulerRange *ranges, size_t n, int threads,
+                                       size_t *count) {
+    uint64_t first = (uint64_t)(threads < 1 ? 1 : threads) * SCHEDULER_GRAIN_MIN;
+    size_t cap = 0, m = 0;
+    SchedulerRange *out;
+
+    /* at most 64 blocks, each cut in ``threads`` pieces, per range */
+    for (size_t i = 0; i < n; ++i)
+        cap += 65 * (size_t)(threads < 1 ? 1 : threads) + 1;
+    *count = 0;
+    if (!(out = malloc((cap ? cap : 1) * sizeof(SchedulerRange))))
+        return NULL;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t begin = 0, size = first;
+        for (;;) {
+            /* the block [begin, begin + size), clipped to the range */
+            uint64_t end = size > UINT64_MAX - begin ? UINT64_MAX : begin + size;
+            uint64_t lo = begin > ranges[i].begin ? begin : ranges[i].begin;
+            uint64_t hi = end < ranges[i].end ? end : ranges[i].end;
+            if (lo < hi) {
+                uint64_t piece = (hi - lo) / (uint64_t)threads + 1;
+                for (uint64_t b = lo; b < hi; b = hi - b > piece ? b + piece : hi)
+                    out[m++] = (SchedulerRange){b, hi - b > piece ? b + piece : hi};
+            }
+            if (end >= ranges[i].end || end == UINT64_MAX)
+                break;
+            begin = end;
+            size = size > UINT64_MAX / 2 ? UINT64_MAX : size * 2;
+        }
+    }
+    *count = m;
+    return out;
+}
+
+int scheduler_run(uint64_t total, int threads, scheduler_range_fn fn, void *arg) {
+    SchedulerRange all = {0, total};
+    return scheduler_run_ranges(&all, 1, threads, fn, NULL, arg);
+}
+
+/* Cut the ranges into seeds of at most total / threads ranks each, so that
+ * every thread starts with its own share. */
+static int make_seeds(Scheduler *s, const SchedulerRange *ranges, size_t count, uint64_t total) {
+    uint64_t share = total / s->threads + (total % s->threads != 0);
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i)
+        n += (ranges[i].end - ranges[i].begin) / share + ((ranges[i].end - ranges[i].begin) % share != 0);
+    s->seeds = malloc((n ? n : 1) * sizeof(SchedulerRange));
+    if (!s->seeds)
+        return 0;
+    for (size_t i = 0; i < count; ++i) {
+        for (uint64_t b = ranges[i].begin; b < ranges[i].end;) {
+            uint64_t e = ranges[i].end - b > share ? b + share : ranges[i].end;
+            s->seeds[s->seed_count++] = (SchedulerRange){b, e};
+            b = e;
+        }
+    }
+    return 1;
+}
+
+int scheduler_run_ranges(const SchedulerRange *ranges, size_t count, int threads,
+                         scheduler_range_fn fn, scheduler_monitor_fn monitor, void *arg) {
+    Scheduler s = {0};
+    SchedThread *ts;
+    SchedMonitor m = {&s, monitor, arg};
+    pthread_t monitor_handle;
+    TopologyMask caller;
+    uint64_t total = 0;
+    int started = 1, monitored = 0, pinned;
+
+    if (threads < 1)
+        threads = 1;
+    for (size_t i = 0; i < count; ++i)
+        total += ranges[i].end - ranges[i].begin;
+    if (total == 0)
+        return 1;
+    s.fn = fn;
+    s.arg = arg;
+    s.threads = threads;
+    s.grain = total / ((uint64_t)threads * 64);
+    if (s.grain < SCHEDULER_GRAIN_MIN)
+        s.grain = SCHEDULER_GRAIN_MIN;
+    if (s.grain > SCHEDULER_GRAIN_MAX)
+        s.grain = SCHEDULER_GRAIN_MAX;
+    atomic_init(&s.next_seed, 0);
+    atomic_init(&s.stop, 0);
+    atomic_init(&s.pause, 0);
+    atomic_init(&s.active, 0);
+    atomic_init(&s.pending, total);
+
+    s.deques = aligned_alloc(64, sizeof(SchedDeque) * threads);
+    ts = calloc(threads, sizeof(SchedThread));
+    if (!s.deques || !ts || !make_seeds(&s, ranges, count, total)) {
+        free(s.deques);
+        free(ts);
+        free(s.seeds);
+        return 0;
+    }
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.wake, NULL);
+
+    for (int i = 0; i < threads; ++i) {
+        pthread_mutex_init(&s.deques[i].lock, NULL);
+        s.deques[i].top = s.deques[i].bottom = 0;
+        ts[i].s = &s;
+        ts[i].id = i;
+        ts[i].cpu = topology_cpu(topology_get(), i);
+        ts[i].rng = 0x9E3779B97F4A7C15ULL * (i + 1);
+    }
+
+    /* if some threads fail to start, the others take their seeds */
+    for (; started < threads; ++started) {
+        if (pthread_create(&ts[started].handle, NULL, scheduler_start, &ts[started]) != 0)
+            break;
+    }
+    if (monitor)
+        monitored = pthread_create(&monitor_handle, NULL, monitor_thread, &m) == 0;
+    /* the caller is thread 0 only for the length of the run */
+    pinned = topology_pin(ts[0].cpu, &caller);
+    scheduler_thread(&ts[0]);
+    if (pinned)
+        topology_unpin(&caller);
+    for (int i = 1; i < started; ++i)
+        pthread_join(ts[i].handle, NULL);
+
+    pthread_mutex_lock(&s.lock);
+    s.finished = 1;
+    pthread_cond_broadcast(&s.wake);
+    pthread_mutex_unlock(&s.lock);
+    if (monitored)
+        pthread_join(monitor_handle, NULL);
+
+    for (int i = 0; i < threads; ++i)
+        pthread_mutex_destroy(&s.deques[i].lock);
+    pthread_cond_destroy(&s.wake);
+    pthread_mutex_destroy(&s.lock);
+    free(s.deques);
+    free(s.seeds);
+    free(ts);
+    return 1;
+}
@@ -0,0 +1,79 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "configuration.h"
+
+#define SCHEDULER_MAX_THREADS 1024
+#define SCHEDULER_GRAIN_MIN 256
+#define SCHEDULER_GRAIN_MAX (1ULL << 16)
+
+/* Work-stealing scheduler over a keyspace of ranks [0, total).  Every thread
+ * starts with an equal share of the keyspace in its own deque, splits what it
+ * takes in halves until a piece is small enough to run, and steals the
+ * oldest (largest) piece of another thread once its deque runs dry. */
+typedef struct Scheduler Scheduler;
+
+/* Process the ranks [begin, end).  ``thread`` is in [0, threads) and may be
+ * used to index per-thread state.  Long ranges should poll
+ * scheduler_stopped(). */
+typedef void (*scheduler_range_fn)(Scheduler *s, int thread, uint64_t begin, uint64_t end,
+                                   void *arg);
+
+typedef struct {
+    uint64_t begin, end;
+} SchedulerRange;
+
+/* Runs on a thread of its own for the length of a run, next to the workers,
+ * e.g. to write checkpoints.  It should loop on scheduler_sleep() and return
+ * once that reports the end of the run. */
+typedef void (*scheduler_monitor_fn)(Scheduler *s, void *arg);
+
+/* Number of threads to use: the forced count from the configuration when
+ * set, otherwise one per core within the CPU quota (see topology.h). */
+int scheduler_thread_count(const Configuration *config);
+
+/* Run ``fn`` over the whole keyspace on ``threads`` threads (the caller is
+ * thread 0), thread i pinned to topology_cpu(topology_get(), i).  Returns 1
+ * once every range was processed or the run was stopped, 0 if the deques
+ * could not be allocated. */
+int scheduler_run(uint64_t total, int threads, scheduler_range_fn fn, void *arg);
+
+/* The same over the union of ``count`` disjoint ranges, e.g. the ranges a
+ * checkpoint left to do, with an optional monitor. */
+int scheduler_run_ranges(const SchedulerRange *ranges, size_t count, int threads,
+                         scheduler_range_fn fn, scheduler_monitor_fn monitor, void *arg);
+
+/* For orders that put the likeliest candidates first: cut ``ranges`` into
+ * blocks of ranks [0, b), [b, 3b), [3b, 7b) ... with b = threads *
+ * SCHEDULER_GRAIN_MIN, and every block into one seed per thread, so that
+ * the threads work their way up from the lowest ranks together and the
+ * ranks in flight stay within a factor of two.  Returns a new array (NULL
+ * on failure) of ``count`` ranges for scheduler_run_ranges(). */
+SchedulerRange *scheduler_order_ranges(const SchedulerRange *ranges, size_t n, int threads,
+                                       size_t *count);
+
+/* Wait up to ``ms`` milliseconds; returns 0 once the run is over. */
+int scheduler_sleep(Scheduler *s, unsigned ms);
+
+/* Stop handing out ranges and wait until every range in flight is done, so
+ * that scheduler_remaining() is exact.  Only for the monitor; the workers
+ * carry on after scheduler_resume(). */
+void scheduler_pause(Scheduler *s);
+void scheduler_resume(Scheduler *s);
+
+/* Ranges not processed yet, sorted and merged, in a new array (NULL if
+ * nothing is left or on failure).  Only valid while paused. */
+SchedulerRange *scheduler_remaining(Scheduler *s, size_t *count);
+
+/* The lowest rank not processed yet, so that every rank below it is done:
+ * the begin of the first of those ranges.  Returns 0 if nothing is left.
+ * Only valid while paused, like scheduler_remaining(). */
+int scheduler_first_remaining(Scheduler *s, uint64_t *rank);
+
+/* Cancel the run; ranges already handed out finish at their next poll. */
+void scheduler_stop(Scheduler *s);
+int scheduler_stopped(const Scheduler *s);
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,667 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "secp256k1.h"
+
+typedef unsigned __int128 uint128_t;
+
+#define M52 0xFFFFFFFFFFFFFULL
+#define M48 0x0FFFFFFFFFFFFULL
+/* 2^256 = 0x1000003D1 (mod p) */
+#define P_FOLD 0x1000003D1ULL
+/* 2^260 = R (mod p), used to fold the upper half of a product */
+#define R_FOLD 0x1000003D10ULL
+
+static const unsigned char GX[32] = {
+    0x79, 0xBE, 0x66, 0x7E, 0xF9, 0xDC, 0xBB, 0xAC, 0x55, 0xA0, 0x62, 0x95, 0xCE, 0x87, 0x0B, 0x07,
+    0x02, 0x9B, 0xFC, 0xDB, 0x2D, 0xCE, 0x28, 0xD9, 0x59, 0xF2, 0x81, 0x5B, 0x16, 0xF8, 0x17, 0x98};
+static const unsigned char GY[32] = {
+    0x48, 0x3A, 0xDA, 0x77, 0x26, 0xA3, 0xC4, 0x65, 0x5D, 0xA4, 0xFB, 0xFC, 0x0E, 0x11, 0x08, 0xA8,
+    0xFD, 0x17, 0xB4, 0x48, 0xA6, 0x85, 0x54, 0x19, 0x9C, 0x47, 0xD0, 0x8F, 0xFB, 0x10, 0xD4, 0xB8};
+/* group order n, big-endian 64-bit words */
+static const uint64_t ORDER[4] = {
+    0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFEULL, 0xBAAEDCE6AF48A03BULL, 0xBFD25E8CD0364141ULL};
+
+static uint64_t load_be64(const unsigned char *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static void store_be64(unsigned char *p, uint64_t v) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = (unsigned char)v;
+        v >>= 8;
+    }
+}
+
+void secp_fe_set_b32(secp_fe *r, const unsigned char *a) {
+    uint64_t w3 = load_be64(a), w2 = load_be64(a + 8), w1 = load_be64(a + 16), w0 = load_be64(a + 24);
+    r->n[0] = w0 & M52;
+    r->n[1] = ((w0 >> 52) | (w1 << 12)) & M52;
+    r->n[2] = ((w1 >> 40) | (w2 << 24)) & M52;
+    r->n[3] = ((w2 >> 28) | (w3 << 36)) & M52;
+    r->n[4] = w3 >> 16;
+}
+
+void secp_fe_get_b32(unsigned char *r, const secp_fe *a) {
+    secp_fe t = *a;
+    secp_fe_normalize(&t);
+    store_be64(r + 24, t.n[0] | (t.n[1] << 52));
+    store_be64(r + 16, (t.n[1] >> 12) | (t.n[2] << 40));
+    store_be64(r + 8, (t.n[2] >> 24) | (t.n[3] << 28));
+    store_be64(r, (t.n[3] >> 36) | (t.n[4] << 16));
+}
+
+/* Reduce to magnitude 1 without the final conditional subtraction of p. */
+void secp_fe_normalize_weak(secp_fe *r) {
+    uint64_t t0 = r->n[0], t1 = r->n[1], t2 = r->n[2], t3 = r->n[3], t4 = r->n[4];
+    uint64_t x = t4 >> 48;
+    t4 &= M48;
+    t0 += x * P_FOLD;
+    t1 += t0 >> 52; t0 &= M52;
+    t2 += t1 >> 52; t1 &= M52;
+    t3 += t2 >> 52; t2 &= M52;
+    t4 += t3 >> 52; t3 &= M52;
+    r->n[0] = t0; r->n[1] = t1; r->n[2] = t2; r->n[3] = t3; r->n[4] = t4;
+}
+
+/* Fully reduce to the unique representative in [0, p). */
+void secp_fe_normalize(secp_fe *r) {
+    uint64_t t0 = r->n[0], t1 = r->n[1], t2 = r->n[2], t3 = r->n[3], t4 = r->n[4];
+    uint64_t m, x = t4 >> 48;
+    t4 &= M48;
+    t0 += x * P_FOLD;
+    t1 += t0 >> 52; t0 &= M52;
+    t2 += t1 >> 52; t1 &= M52; m = t1;
+    t3 += t2 >> 52; t2 &= M52; m &= t2;
+    t4 += t3 >> 52; t3 &= M52; m &= t3;
+    /* at most one more subtraction of p is needed */
+    x = (t4 >> 48) | ((t4 == M48) & (m == M52) & (t0 >= 0xFFFFEFFFFFC2FULL));
+    t0 += x * P_FOLD;
+    t1 += t0 >> 52; t0 &= M52;
+    t2 += t1 >> 52; t1 &= M52;
+    t3 += t2 >> 52; t2 &= M52;
+    t4 += t3 >> 52; t3 &= M52;
+    t4 &= M48;
+    r->n[0] = t0; r->n[1] = t1; r->n[2] = t2; r->n[3] = t3; r->n[4] = t4;
+}
+
+int secp_fe_is_zero(const secp_fe *a) {
+    secp_fe t = *a;
+    secp_fe_normalize(&t);
+    return (t.n[0] | t.n[1] | t.n[2] | t.n[3] | t.n[4]) == 0;
+}
+
+/* requires a normalized input */
+int secp_fe_is_odd(const secp_fe *a) {
+    return (int)(a->n[0] & 1);
+}
+
+/* r += a; the magnitudes add up */
+void secp_fe_add(secp_fe *r, const secp_fe *a) {
+    for (int i = 0; i < 5; i++)
+        r->n[i] += a->n[i];
+}
+
+/* r *= k; the magnitude is multiplied by k */
+void secp_fe_mul_int(secp_fe *r, int k) {
+    for (int i = 0; i < 5; i++)
+        r->n[i] *= (uint64_t)k;
+}
+
+/* r = -a where a has magnitude at most m; the result has magnitude m + 1 */
+void secp_fe_negate(secp_fe *r, const secp_fe *a, int m) {
+    uint64_t k = 2 * (uint64_t)(m + 1);
+    r->n[0] = 0xFFFFEFFFFFC2FULL * k - a->n[0];
+    r->n[1] = M52 * k - a->n[1];
+    r->n[2] = M52 * k - a->n[2];
+    r->n[3] = M52 * k - a->n[3];
+    r->n[4] = M48 * k - a->n[4];
+}
+
+/* The product is accumulated column by column; the columns above 2^260 are
+ * folded back with R_FOLD as soon as they are produced so that nothing
+ * overflows 128 bits. */
+void secp_fe_mul(secp_fe *r, const secp_fe *a, const secp_fe *b) {
+    uint128_t c, d;
+    uint64_t t3, t4, tx, u0;
+    const uint64_t a0 = a->n[0], a1 = a->n[1], a2 = a->n[2], a3 = a->n[3], a4 = a->n[4];
+    const uint64_t b0 = b->n[0], b1 = b->n[1], b2 = b->n[2], b3 = b->n[3], b4 = b->n[4];
+
+    d = (uint128_t)a0 * b3 + (uint128_t)a1 * b2 + (uint128_t)a2 * b1 + (uint128_t)a3 * b0;
+    c = (uint128_t)a4 * b4;
+    d += (uint128_t)((uint64_t)c & M52) * R_FOLD; c >>= 52;
+    t3 = (uint64_t)d & M52; d >>= 52;
+
+    d += (uint128_t)a0 * b4 + (uint128_t)a1 * b3 + (uint128_t)a2 * b2 + (uint128_t)a3 * b1 + (uint128_t)a4 * b0;
+    d += c * R_FOLD;
+    t4 = (uint64_t)d & M52; d >>= 52;
+    tx = t4 >> 48; t4 &= M48;
+
+    c = (uint128_t)a0 * b0;
+    d += (uint128_t)a1 * b4 + (uint128_t)a2 * b3 + (uint128_t)a3 * b2 + (uint128_t)a4 * b1;
+    u0 = (uint64_t)d & M52; d >>= 52;
+    u0 = (u0 << 4) | tx;
+    c += (uint128_t)u0 * (R_FOLD >> 4);
+    r->n[0] = (uint64_t)c & M52; c >>= 52;
+
+    c += (uint128_t)a0 * b1 + (uint128_t)a1 * b0;
+    d += (uint128_t)a2 * b4 + (uint128_t)a3 * b3 + (uint128_t)a4 * b2;
+    c += (uint128_t)((uint64_t)d & M52) * R_FOLD; d >>= 52;
+    r->n[1] = (uint64_t)c & M52; c >>= 52;
+
+    c += (uint128_t)a0 * b2 + (uint128_t)a1 * b1 + (uint128_t)a2 * b0;
+    d += (uint128_t)a3 * b4 + (uint128_t)a4 * b3;
+    c += (uint128_t)((uint64_t)d & M52) * R_FOLD; d >>= 52;
+    r->n[2] = (uint64_t)c & M52; c >>= 52;
+
+    c += d * R_FOLD + t3;
+    r->n[3] = (uint64_t)c & M52; c >>= 52;
+    c += t4;
+    r->n[4] = (uint64_t)c;
+}
+
+void secp_fe_sqr(secp_fe *r, const secp_fe *a) {
+    uint128_t c, d;
+    uint64_t t3, t4, tx, u0;
+    uint64_t a0 = a->n[0], a1 = a->n[1], a2 = a->n[2], a3 = a->n[3], a4 = a->n[4];
+
+    d = (uint128_t)(a0 * 2) * a3 + (uint128_t)(a1 * 2) * a2;
+    c = (uint128_t)a4 * a4;
+    d += (uint128_t)((uint64_t)c & M52) * R_FOLD; c >>= 52;
+    t3 = (uint64_t)d & M52; d >>= 52;
+
+    a4 *= 2;
+    d += (uint128_t)a0 * a4 + (uint128_t)(a1 * 2) * a3 + (uint128_t)a2 * a2;
+    d += c * R_FOLD;
+    t4 = (uint64_t)d & M52; d >>= 52;
+    tx = t4 >> 48; t4 &= M48;
+
+    c = (uint128_t)a0 * a0;
+    d += (uint128_t)a1 * a4 + (uint128_t)(a2 * 2) * a3;
+    u0 = (uint64_t)d & M52; d >>= 52;
+    u0 = (u0 << 4) | tx;
+    c += (uint128_t)u0 * (R_FOLD >> 4);
+    r->n[0] = (uint64_t)c & M52; c >>= 52;
+
+    a0 *= 2;
+    c += (uint128_t)a0 * a1;
+    d += (uint128_t)a2 * a4 + (uint128_t)a3 * a3;
+    c += (uint128_t)((uint64_t)d & M52) * R_FOLD; d >>= 52;
+    r->n[1] = (uint64_t)c & M52; c >>= 52;
+
+    c += (uint128_t)a0 * a2 + (uint128_t)a1 * a1;
+    d += (uint128_t)a3 * a4;
+    c += (uint128_t)((uint64_t)d & M52) * R_FOLD; d >>= 52;
+    r->n[2] = (uint64_t)c & M52; c >>= 52;
+
+    c += d * R_FOLD + t3;
+    r->n[3] = (uint64_t)c & M52; c >>= 52;
+    c += t4;
+    r->n[4] = (uint64_t)c;
+}
+
+static void fe_sqr_n(secp_fe *r, const secp_fe *a, int n) {
+    secp_fe_sqr(r, a);
+    while (--n > 0)
+        secp_fe_sqr(r, r);
+}
+
+/* r = a^(p-2).  The exponent has runs of 1 bits of length 223, 22, 2 and 1;
+ * 2^k-1 powers for those runs are built with an addition chain. */
+void secp_fe_inv(secp_fe *r, const secp_fe *a) {
+    secp_fe x2, x3, x6, x9, x11, x22, x44, x88, x176, x220, x223, t;
+
+    secp_fe_sqr(&x2, a);
+    secp_fe_mul(&x2, &x2, a);
+    secp_fe_sqr(&x3, &x2);
+    secp_fe_mul(&x3, &x3, a);
+    fe_sqr_n(&x6, &x3, 3);
+    secp_fe_mul(&x6, &x6, &x3);
+    fe_sqr_n(&x9, &x6, 3);
+    secp_fe_mul(&x9, &x9, &x3);
+    fe_sqr_n(&x11, &x9, 2);
+    secp_fe_mul(&x11, &x11, &x2);
+    fe_sqr_n(&x22, &x11, 11);
+    secp_fe_mul(&x22, &x22, &x11);
+    fe_sqr_n(&x44, &x22, 22);
+    secp_fe_mul(&x44, &x44, &x22);
+    fe_sqr_n(&x88, &x44, 44);
+    secp_fe_mul(&x88, &x88, &x44);
+    fe_sqr_n(&x176, &x88, 88);
+    secp_fe_mul(&x176, &x176, &x88);
+    fe_sqr_n(&x220, &x176, 44);
+    secp_fe_mul(&x220, &x220, &x44);
+    fe_sqr_n(&x223, &x220, 3);
+    secp_fe_mul(&x223, &x223, &x3);
+
+    fe_sqr_n(&t, &x223, 23);
+    secp_fe_mul(&t, &t, &x22);
+    fe_sqr_n(&t, &t, 5);
+    secp_fe_mul(&t, &t, a);
+    fe_sqr_n(&t, &t, 3);
+    secp_fe_mul(&t, &t, &x2);
+    fe_sqr_n(&t, &t, 2);
+    secp_fe_mul(r, &t, a);
+}
+
+/* Invert n non-zero elements with a single inversion (Montgomery's trick):
+ * one inversion plus 3(n-1) multiplications.  ``r`` must not alias ``a``. */
+void secp_fe_inv_all(secp_fe *r, const secp_fe *a, size_t n) {
+    secp_fe u, t;
+    if (n == 0)
+        return;
+    r[0] = a[0];
+    for (size_t i = 1; i < n; i++)
+        secp_fe_mul(&r[i], &r[i - 1], &a[i]);
+    secp_fe_inv(&u, &r[n - 1]);
+    for (size_t i = n - 1; i > 0; i--) {
+        secp_fe_mul(&r[i], &r[i - 1], &u);
+        secp_fe_mul(&t, &u, &a[i]);
+        u = t;
+    }
+    r[0] = u;
+}
+
+void secp_gej_set_infinity(secp_gej *r) {
+    memset(r, 0, sizeof(*r));
+    r->infinity = 1;
+}
+
+void secp_gej_set_ge(secp_gej *r, const secp_ge *a) {
+    r->x = a->x;
+    r->y = a->y;
+    memset(&r->z, 0, sizeof(r->z));
+    r->z.n[0] = 1;
+    r->infinity = a->infinity;
+}
+
+void secp_gej_neg(secp_gej *r, const secp_gej *a) {
+    *r = *a;
+    secp_fe_negate(&r->y, &a->y, 1);
+    secp_fe_normalize_weak(&r->y);
+}
+
+/* dbl-2009-l for a = 0: 2M + 5S */
+void secp_gej_double(secp_gej *r, const secp_gej *a) {
+    secp_fe A, B, C, D, E, F, t, u;
+
+    if (a->infinity) {
+        secp_gej_set_infinity(r);
+        return;
+    }
+    secp_fe_sqr(&A, &a->x);
+    secp_fe_sqr(&B, &a->y);
+    secp_fe_sqr(&C, &B);
+
+    t = a->x;
+    secp_fe_add(&t, &B);
+    secp_fe_sqr(&D, &t);
+    secp_fe_negate(&t, &A, 1);
+    secp_fe_add(&D, &t);
+    secp_fe_negate(&t, &C, 1);
+    secp_fe_add(&D, &t);
+    secp_fe_mul_int(&D, 2);
+    secp_fe_normalize_weak(&D);
+
+    E = A;
+    secp_fe_mul_int(&E, 3);
+    secp_fe_sqr(&F, &E);
+
+    /* z3 = 2 * y1 * z1, computed first since r may alias a */
+    secp_fe_mul(&r->z, &a->y, &a->z);
+    secp_fe_mul_int(&r->z, 2);
+    secp_fe_normalize_weak(&r->z);
+
+    /* x3 = F - 2D */
+    secp_fe_negate(&t, &D, 1);
+    secp_fe_mul_int(&t, 2);
+    r->x = F;
+    secp_fe_add(&r->x, &t);
+    secp_fe_normalize_weak(&r->x);
+
+    /* y3 = E * (D - x3) - 8C */
+    secp_fe_negate(&t, &r->x, 1);
+    secp_fe_add(&t, &D);
+    secp_fe_mul(&u, &E, &t);
+    secp_fe_mul_int(&C, 8);
+    secp_fe_negate(&t, &C, 8);
+    secp_fe_add(&u, &t);
+    secp_fe_normalize_weak(&u);
+    r->y = u;
+    r->infinity = 0;
+}
+
+/* Shared tail of the addition formulas once U1, S1, H = U2 - U1 and
+ * R = S2 - S1 are known; ``z`` is the product of the input z coordinates. */
+static void gej_add_finish(secp_gej *r, const secp_fe *u1, const secp_fe *s1,
+                           const secp_fe *h, const secp_fe *rr, const secp_fe *z) {
+    secp_fe h2, h3, u1h2, t, x3, y3;
+
+    secp_fe_sqr(&h2, h);
+    secp_fe_mul(&h3, h, &h2);
+    secp_fe_mul(&u1h2, u1, &h2);
+
+    /* x3 = R^2 - H^3 - 2 * U1 * H^2 */
+    secp_fe_sqr(&x3, rr);
+    secp_fe_negate(&t, &h3, 1);
+    secp_fe_add(&x3, &t);
+    secp_fe_negate(&t, &u1h2, 1);
+    secp_fe_mul_int(&t, 2);
+    secp_fe_add(&x3, &t);
+    secp_fe_normalize_weak(&x3);
+
+    /* y3 = R * (U1 * H^2 - x3) - S1 * H^3 */
+    secp_fe_negate(&t, &x3, 1);
+    secp_fe_add(&t, &u1h2);
+    secp_fe_mul(&y3, rr, &t);
+    secp_fe_mul(&t, s1, &h3);
+    secp_fe_negate(&t, &t, 1);
+    secp_fe_add(&y3, &t);
+    secp_fe_normalize_weak(&y3);
+
+    secp_fe_mul(&r->z, z, h);
+    r->x = x3;
+    r->y = y3;
+    r->infinity = 0;
+}
+
+/* add-1998-cmo-2: 12M + 4S */
+void secp_gej_add(secp_gej *r, const secp_gej *a, const secp_gej *b) {
+    secp_fe z1z1, z2z2, u1, u2, s1, s2, h, rr, z;
+
+    if (a->infinity) {
+        *r = *b;
+        return;
+    }
+    if (b->infinity) {
+        *r = *a;
+        return;
+    }
+    secp_fe_sqr(&z1z1, &a->z);
+    secp_fe_sqr(&z2z2, &b->z);
+    secp_fe_mul(&u1, &a->x, &z2z2);
+    secp_fe_mul(&u2, &b->x, &z1z1);
+    secp_fe_mul(&s1, &a->y, &b->z);
+    secp_fe_mul(&s1, &s1, &z2z2);
+    secp_fe_mul(&s2, &b->y, &a->z);
+    secp_fe_mul(&s2, &s2, &z1z1);
+
+    secp_fe_negate(&h, &u1, 1);
+    secp_fe_add(&h, &u2);
+    secp_fe_negate(&rr, &s1, 1);
+    secp_fe_add(&rr, &s2);
+    if (secp_fe_is_zero(&h)) {
+        if (secp_fe_is_zero(&rr))
+            secp_gej_double(r, a);
+        else
+            secp_gej_set_infinity(r);
+        return;
+    }
+    secp_fe_mul(&z, &a->z, &b->z);
+    gej_add_finish(r, &u1, &s1, &h, &rr, &z);
+}
+
+/* Mixed addition with an affine point (z2 = 1): 8M + 3S */
+void secp_gej_add_ge(secp_gej *r, const secp_gej *a, const secp_ge *b) {
+    secp_fe z1z1, u2, s2, h, rr, u1, s1, z;
+
+    if (a->infinity) {
+        secp_gej_set_ge(r, b);
+        return;
+    }
+    if (b->infinity) {
+        *r = *a;
+        return;
+    }
+    secp_fe_sqr(&z1z1, &a->z);
+    secp_fe_mul(&u2, &b->x, &z1z1);
+    secp_fe_mul(&s2, &b->y, &a->z);
+    secp_fe_mul(&s2, &s2, &z1z1);
+
+    secp_fe_negate(&h, &a->x, 1);
+    secp_fe_add(&h, &u2);
+    secp_fe_negate(&rr, &a->y, 1);
+    secp_fe_add(&rr, &s2);
+    if (secp_fe_is_zero(&h)) {
+        if (secp_fe_is_zero(&rr))
+            secp_gej_double(r, a);
+        else
+            secp_gej_set_infinity(r);
+        return;
+    }
+    u1 = a->x;
+    s1 = a->y;
+    z = a->z;
+    gej_add_finish(r, &u1, &s1, &h, &rr, &z);
+}
+
+/* Convert to affine coordinates; the result is fully normalized. */
+void secp_ge_set_gej(secp_ge *r, const secp_gej *a) {
+    secp_fe zi, zi2, zi3;
+
+    r->infinity = a->infinity;
+    if (a->infinity)
+        return;
+    secp_fe_inv(&zi, &a->z);
+    secp_fe_sqr(&zi2, &zi);
+    secp_fe_mul(&zi3, &zi2, &zi);
+    secp_fe_mul(&r->x, &a->x, &zi2);
+    secp_fe_mul(&r->y, &a->y, &zi3);
+    secp_fe_normalize(&r->x);
+    secp_fe_normalize(&r->y);
+}
+
+/* SEC1 encoding: 33 bytes compressed or 65 bytes uncompressed.  Returns the
+ * length, 0 for the point at infinity. */
+size_t secp_ge_serialize(unsigned char *out, const secp_ge *a, int compressed) {
+    if (a->infinity)
+        return 0;
+    secp_fe_get_b32(out + 1, &a->x);
+    if (compressed) {
+        out[0] = secp_fe_is_odd(&a->y) ? 0x03 : 0x02;
+        return 33;
+    }
+    out[0] = 0x04;
+    secp_fe_get_b32(out + 33, &a->y);
+    return 65;
+}
+
+/* r = a mod n for a 32 byte big-endian a.  Since 2^256 < 2n a single
+ * conditional subtraction is enough.  Returns 0 when the result is zero. */
+int secp_scalar_reduce(unsigned char *r, const unsigned char *a) {
+    uint64_t w[4], borrow = 0;
+    int ge = 1;
+
+    for (int i = 0; i < 4; i++)
+        w[i] = load_be64(a + 8 * i);
+    for (int i = 0; i < 4; i++) {
+        if (w[i] != ORDER[i]) {
+            ge = w[i] > ORDER[i];
+            break;
+        }
+    }
+    if (ge) {
+        for (int i = 3; i >= 0; i--) {
+            uint64_t y = ORDER[i] + borrow;
+            uint64_t nb = (y < borrow) || (w[i] < y);
+            w[i] -= y;
+            borrow = nb;
+        }
+    }
+    for (int i = 0; i < 4; i++)
+        store_be64(r + 8 * i, w[i]);
+    return (w[0] | w[1] | w[2] | w[3]) != 0;
+}
+
+/* Fixed-base window table: gen_table[i][j] = j * 16^i * G.  Every 4 bit
+ * window of the scalar has its own row, so a multiplication is at most 64
+ * mixed additions and no doublings. */
+#define GEN_WINDOWS 64
+#define GEN_WINDOW_SIZE 16
+
+static secp_ge gen_table[GEN_WINDOWS][GEN_WINDOW_SIZE];
+static pthread_once_t gen_table_once = PTHREAD_ONCE_INIT;
+
+static void gen_table_build(void) {
+    static secp_gej jac[GEN_WINDOWS * GEN_WINDOW_SIZE];
+    static secp_fe zs[GEN_WINDOWS * GEN_WINDOW_SIZE], zinv[GEN_WINDOWS * GEN_WINDOW_SIZE];
+    secp_gej base;
+    size_t n = 0;
+
+    secp_fe_set_b32(&base.x, GX);
+    secp_fe_set_b32(&base.y, GY);
+    memset(&base.z, 0, sizeof(base.z));
+    base.z.n[0] = 1;
+    base.infinity = 0;
+
+    for (int i = 0; i < GEN_WINDOWS; i++) {
+        jac[i * GEN_WINDOW_SIZE + 1] = base;
+        for (int j = 2; j < GEN_WINDOW_SIZE; j++)
+            secp_gej_add(&jac[i * GEN_WINDOW_SIZE + j], &jac[i * GEN_WINDOW_SIZE + j - 1], &base);
+        for (int k = 0; k < 4; k++)
+            secp_gej_double(&base, &base);
+    }
+    for (int i = 0; i < GEN_WINDOWS; i++)
+        for (int j = 1; j < GEN_WINDOW_SIZE; j++)
+            zs[n++] = jac[i * GEN_WINDOW_SIZE + j].z;
+    secp_fe_inv_all(zinv, zs, n);
+
+    n = 0;
+    for (int i = 0; i < GEN_WINDOWS; i++) {
+        gen_table[i][0].infinity = 1;
+        for (int j = 1; j < GEN_WINDOW_SIZE; j++) {
+            const secp_gej *p = &jac[i * GEN_WINDOW_SIZE + j];
+            secp_ge *g = &gen_table[i][j];
+            secp_fe zi2, zi3;
+            secp_fe_sqr(&zi2, &zinv[n]);
+            secp_fe_mul(&zi3, &zi2, &zinv[n]);
+            secp_fe_mul(&g->x, &p->x, &zi2);
+            secp_fe_mul(&g->y, &p->y, &zi3);
+            secp_fe_normalize(&g->x);
+            secp_fe_normalize(&g->y);
+            g->infinity = 0;
+            n++;
+        }
+    }
+}
+
+void secp_fe_to_storage(secp_fe_storage *r, const secp_fe *a) {
+    r->n[0] = a->n[0] | a->n[1] << 52;
+    r->n[1] = a->n[1] >> 12 | a->n[2] << 40;
+    r->n[2] = a->n[2] >> 24 | a->n[3] << 28;
+    r->n[3] = a->n[3] >> 36 | a->n[4] << 16;
+}
+
+void secp_fe_from_storage(secp_fe *r, const secp_fe_storage *a) {
+    r->n[0] = a->n[0] & 0xFFFFFFFFFFFFFULL;
+    r->n[1] = a->n[0] >> 52 | (a->n[1] & 0xFFFFFFFFFFULL) << 12;
+    r->n[2] = a->n[1] >> 40 | (a->n[2] & 0xFFFFFFFULL) << 24;
+    r->n[3] = a->n[2] >> 28 | (a->n[3] & 0xFFFFULL) << 36;
+    r->n[4] = a->n[3] >> 16;
+}
+
+/* Build one window at a time: its 2^16 - 1 points by mixed additions of the
+ * window base, one inversion for all of them, and the base of the next
+ * window as the last point plus the base. */
+int secp_gen_wide_build(secp_ge_storage *table) {
+    const size_t n = SECP_GEN_WIDE_SIZE - 1;
+    secp_gej *jac = malloc(n * sizeof(secp_gej));
+    secp_fe *zs = malloc(n * sizeof(secp_fe)), *zinv = malloc(n * sizeof(secp_fe));
+    secp_gej next;
+    secp_ge base;
+
+    if (!jac || !zs || !zinv) {
+        free(jac);
+        free(zs);
+        free(zinv);
+        return 0;
+    }
+    secp_fe_set_b32(&base.x, GX);
+    secp_fe_set_b32(&base.y, GY);
+    base.infinity = 0;
+    for (int i = 0; i < SECP_GEN_WIDE_WINDOWS; i++) {
+        secp_ge_storage *row = table + (size_t)i * SECP_GEN_WIDE_SIZE;
+        secp_gej_set_ge(&jac[0], &base);
+        for (size_t j = 1; j < n; j++)
+            secp_gej_add_ge(&jac[j], &jac[j - 1], &base);
+        secp_gej_add_ge(&next, &jac[n - 1], &base);
+        for (size_t j = 0; j < n; j++)
+            zs[j] = jac[j].z;
+        secp_fe_inv_all(zinv, zs, n);
+
+        memset(&row[0], 0, sizeof(row[0]));
+        for (size_t j = 0; j < n; j++) {
+            secp_fe zi2, zi3, x, y;
+            secp_fe_sqr(&zi2, &zinv[j]);
+            secp_fe_mul(&zi3, &zi2, &zinv[j]);
+            secp_fe_mul(&x, &jac[j].x, &zi2);
+            secp_fe_mul(&y, &jac[j].y, &zi3);
+            secp_fe_normalize(&x);
+            secp_fe_normalize(&y);
+            secp_fe_to_storage(&row[j + 1].x, &x);
+            secp_fe_to_storage(&row[j + 1].y, &y);
+        }
+        secp_ge_set_gej(&base, &next);
+    }
+    free(jac);
+    free(zs);
+    free(zinv);
+    return 1;
+}
+
+static const secp_ge_storage *gen_wide;
+
+void secp_gen_wide_use(const secp_ge_storage *table) {
+    __atomic_store_n(&gen_wide, table, __ATOMIC_RELEASE);
+}
+
+/* r = scalar * G with the built-in 4 bit table. */
+static void ecmult_gen_small(secp_gej *r, const unsigned char *scalar) {
+    secp_gej_set_infinity(r);
+    pthread_once(&gen_table_once, gen_table_build);
+    for (int i = 0; i < GEN_WINDOWS; i++) {
+        int d = (scalar[31 - i / 2] >> (4 * (i & 1))) & 0xF;
+        if (d)
+            secp_gej_add_ge(r, r, &gen_table[i][d]);
+    }
+}
+
+int secp_gen_wide_check(const secp_ge_storage *table, int window, unsigned j) {
+    const secp_ge_storage *e = table + (size_t)window * SECP_GEN_WIDE_SIZE + j;
+    unsigned char scalar[32] = {0};
+    secp_ge_storage want;
+    secp_gej p;
+    secp_ge g;
+
+    scalar[31 - 2 * window] = j & 0xFF;
+    scalar[30 - 2 * window] = j >> 8;
+    ecmult_gen_small(&p, scalar);
+    secp_ge_set_gej(&g, &p);
+    secp_fe_to_storage(&want.x, &g.x);
+    secp_fe_to_storage(&want.y, &g.y);
+    return memcmp(e, &want, sizeof(want)) == 0;
+}
+
+/* r = scalar * G for a 32 byte big-endian scalar already reduced mod n. */
+void secp_ecmult_gen(secp_gej *r, const unsigned char *scalar) {
+    const secp_ge_storage *wide = __atomic_load_n(&gen_wide, __ATOMIC_ACQUIRE);
+    secp_gej_set_infinity(r);
+    if (wide) {
+        for (int i = 0; i < SECP_GEN_WIDE_WINDOWS; i++) {
+            unsigned d = scalar[31 - 2 * i] | (unsigned)scalar[30 - 2 * i] << 8;
+            const secp_ge_storage *e = wide + (size_t)i * SECP_GEN_WIDE_SIZE + d;
+            secp_ge g;
+            if (!d)
+                continue;
+            secp_fe_from_storage(&g.x, &e->x);
+            secp_fe_from_storage(&g.y, &e->y);
+            g.infinity = 0;
+            secp_gej_add_ge(r, r, &g);
+        }
+        return;
+    }
+    ecmult_gen_small(r, scalar);
+}
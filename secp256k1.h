@@ -0,0 +1,92 @@
+#ifndef SECP256K1_H
+#define SECP256K1_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Native secp256k1 arithmetic used by the ec_* helpers in bitcoin.c.
+ *
+ * Field elements are stored as 5 limbs of 52 bits.  Limbs may exceed 52 bits
+ * between operations; the "magnitude" of an element bounds by how much.  All
+ * functions below accept inputs of magnitude <= 8 and return magnitude 1
+ * unless documented otherwise.  Nothing here is constant time: it is meant
+ * for key search, not for signing. */
+typedef struct {
+    uint64_t n[5];
+} secp_fe;
+
+/* affine point */
+typedef struct {
+    secp_fe x, y;
+    int infinity;
+} secp_ge;
+
+/* Jacobian point: (x / z^2, y / z^3) */
+typedef struct {
+    secp_fe x, y, z;
+    int infinity;
+} secp_gej;
+
+void secp_fe_set_b32(secp_fe *r, const unsigned char *a);
+void secp_fe_get_b32(unsigned char *r, const secp_fe *a);
+void secp_fe_normalize(secp_fe *r);
+void secp_fe_normalize_weak(secp_fe *r);
+int secp_fe_is_zero(const secp_fe *a);
+int secp_fe_is_odd(const secp_fe *a);
+void secp_fe_add(secp_fe *r, const secp_fe *a);
+void secp_fe_mul_int(secp_fe *r, int k);
+void secp_fe_negate(secp_fe *r, const secp_fe *a, int m);
+void secp_fe_mul(secp_fe *r, const secp_fe *a, const secp_fe *b);
+void secp_fe_sqr(secp_fe *r, const secp_fe *a);
+void secp_fe_inv(secp_fe *r, const secp_fe *a);
+void secp_fe_inv_all(secp_fe *r, const secp_fe *a, size_t n);
+
+void secp_gej_set_infinity(secp_gej *r);
+void secp_gej_set_ge(secp_gej *r, const secp_ge *a);
+void secp_gej_neg(secp_gej *r, const secp_gej *a);
+void secp_gej_double(secp_gej *r, const secp_gej *a);
+void secp_gej_add(secp_gej *r, const secp_gej *a, const secp_gej *b);
+void secp_gej_add_ge(secp_gej *r, const secp_gej *a, const secp_ge *b);
+void secp_ge_set_gej(secp_ge *r, const secp_gej *a);
+
+size_t secp_ge_serialize(unsigned char *out, const secp_ge *a, int compressed);
+
+/* A normalized field element packed in 4 limbs of 64 bits, the form of the
+ * points of a stored table. */
+typedef struct {
+    uint64_t n[4];
+} secp_fe_storage;
+
+typedef struct {
+    secp_fe_storage x, y;
+} secp_ge_storage;
+
+void secp_fe_to_storage(secp_fe_storage *r, const secp_fe *a);
+void secp_fe_from_storage(secp_fe *r, const secp_fe_storage *a);
+
+int secp_scalar_reduce(unsigned char *r, const unsigned char *a);
+void secp_ecmult_gen(secp_gej *r, const unsigned char *scalar);
+
+/* A wider fixed-base table for secp_ecmult_gen: 16 windows of 16 bits,
+ * table[i * SECP_GEN_WIDE_SIZE + j] = j * 2^(16 i) * G (entry 0 unused), so
+ * that a multiplication is at most 16 mixed additions instead of 64.  It
+ * takes SECP_GEN_WIDE_BYTES, too much to build at every start; see
+ * ec_gen_table_open() for a file built once and mapped by every process. */
+#define SECP_GEN_WIDE_BITS 16
+#define SECP_GEN_WIDE_WINDOWS (256 / SECP_GEN_WIDE_BITS)
+#define SECP_GEN_WIDE_SIZE (1 << SECP_GEN_WIDE_BITS)
+#define SECP_GEN_WIDE_BYTES \
+    ((size_t)SECP_GEN_WIDE_WINDOWS * SECP_GEN_WIDE_SIZE * sizeof(secp_ge_storage))
+
+/* Fill ``table`` (SECP_GEN_WIDE_BYTES).  Returns 0 if out of memory. */
+int secp_gen_wide_build(secp_ge_storage *table);
+
+/* From now on, multiply with ``table``, or with the built-in 4 bit table
+ * again if NULL.  The table must stay valid while in use. */
+void secp_gen_wide_use(const secp_ge_storage *table);
+
+/* Whether entry ``j`` (1 ... SECP_GEN_WIDE_SIZE - 1) of ``window`` holds
+ * its point, computed again with the built-in table. */
+int secp_gen_wide_check(const secp_ge_storage *table, int window, unsigned j);
+
+#endif /* SECP256K1_H */
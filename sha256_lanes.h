@@ -0,0 +1,182 @@
+/* Multi-buffer SHA256d checksum and hash160 kernels, instantiated by hash.c
+ * once per vector width.  Before including this file define:
+ *
+ *   SHA256_LANES          number of 32 bit lanes (8 for AVX2, 16 for AVX-512)
+ *   SHA256_LANES_FN       name of the generated checksum function
+ *   HASH160_LANES_FN      name of the generated hash160 function
+ *   SHA256_LANES_TARGET   target attribute string, e.g. "avx2"
+ *
+ * Lane j hashes the message at msgs + j * stride.  The state of all lanes is
+ * kept transposed, one vector per state word, so the rounds run once for
+ * every lane at the same time; the second hash (SHA256 for the checksum,
+ * RIPEMD160 for hash160) starts from the first digest without leaving the
+ * vector registers. */
+
+#define SHA256_LANES_JOIN2(a, b) a##b
+#define SHA256_LANES_JOIN(a, b) SHA256_LANES_JOIN2(a, b)
+#define LV SHA256_LANES_JOIN(sha256_vec, SHA256_LANES)
+#define LV_COMPRESS SHA256_LANES_JOIN(sha256_compress_x, SHA256_LANES)
+#define LV_RIPEMD160 SHA256_LANES_JOIN(ripemd160_compress_x, SHA256_LANES)
+
+typedef uint32_t LV __attribute__((vector_size(4 * SHA256_LANES)));
+
+#define LV_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define LV_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define LV_ROUND(a, b, c, d, e, f, g, h, k, w)                                         \
+    do {                                                                             \
+        LV t1_ = (h) + (LV_ROTR(e, 6) ^ LV_ROTR(e, 11) ^ LV_ROTR(e, 25)) +          \
+                 (((e) & (f)) ^ (~(e) & (g))) + (k) + (w);                             \
+        LV t2_ = (LV_ROTR(a, 2) ^ LV_ROTR(a, 13) ^ LV_ROTR(a, 22)) +                \
+                 (((a) & (b)) ^ ((a) & (c)) ^ ((b) & (c)));                            \
+        (d) += t1_;                                                                   \
+        (h) = t1_ + t2_;                                                              \
+    } while (0)
+
+/* s = SHA256 compression of s with the message words w (clobbered). */
+__attribute__((target(SHA256_LANES_TARGET)))
+static inline void LV_COMPRESS(LV s[8], LV w[16]) {
+    LV a = s[0], b = s[1], c = s[2], d = s[3];
+    LV e = s[4], f = s[5], g = s[6], h = s[7];
+
+    for (int i = 0; i < 64; i += 8) {
+        if (i >= 16) {
+            for (int k = i; k < i + 8; k++) {
+                LV w15 = w[(k - 15) & 15], w2 = w[(k - 2) & 15];
+                w[k & 15] += (LV_ROTR(w15, 7) ^ LV_ROTR(w15, 18) ^ (w15 >> 3)) +
+                             w[(k - 7) & 15] +
+                             (LV_ROTR(w2, 17) ^ LV_ROTR(w2, 19) ^ (w2 >> 10));
+            }
+        }
+        LV_ROUND(a, b, c, d, e, f, g, h, SHA256_K[i + 0], w[(i + 0) & 15]);
+        LV_ROUND(h, a, b, c, d, e, f, g, SHA256_K[i + 1], w[(i + 1) & 15]);
+        LV_ROUND(g, h, a, b, c, d, e, f, SHA256_K[i + 2], w[(i + 2) & 15]);
+        LV_ROUND(f, g, h, a, b, c, d, e, SHA256_K[i + 3], w[(i + 3) & 15]);
+        LV_ROUND(e, f, g, h, a, b, c, d, SHA256_K[i + 4], w[(i + 4) & 15]);
+        LV_ROUND(d, e, f, g, h, a, b, c, SHA256_K[i + 5], w[(i + 5) & 15]);
+        LV_ROUND(c, d, e, f, g, h, a, b, SHA256_K[i + 6], w[(i + 6) & 15]);
+        LV_ROUND(b, c, d, e, f, g, h, a, SHA256_K[i + 7], w[(i + 7) & 15]);
+    }
+    s[0] += a; s[1] += b; s[2] += c; s[3] += d;
+    s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+}
+
+/* s = RIPEMD160 compression of s with the little endian message words x.
+ * Both lines of a round use one boolean function each, so the round loop is
+ * unrolled by hand and the function is picked outside the step loop. */
+#define LV_RIPEMD_STEP(side, fn, j)                                                   \
+    do {                                                                             \
+        LV t_ = v[side][0] + (fn) + x[RIPEMD160_R[side][j]] + RIPEMD160_K[side][(j) >> 4]; \
+        t_ = LV_ROTL(t_, RIPEMD160_S[side][j]) + v[side][4];                          \
+        v[side][0] = v[side][4];                                                      \
+        v[side][4] = v[side][3];                                                      \
+        v[side][3] = LV_ROTL(v[side][2], 10);                                         \
+        v[side][2] = v[side][1];                                                      \
+        v[side][1] = t_;                                                              \
+    } while (0)
+#define LV_RIPEMD_ROUND(round, fl, fr)                                                \
+    for (int j = 16 * (round); j < 16 * (round) + 16; j++) {                         \
+        LV *l_ = v[0], *r_ = v[1];                                                   \
+        LV_RIPEMD_STEP(0, fl(l_[1], l_[2], l_[3]), j);                                \
+        LV_RIPEMD_STEP(1, fr(r_[1], r_[2], r_[3]), j);                                \
+    }
+#define LV_F0(x, y, z) ((x) ^ (y) ^ (z))
+#define LV_F1(x, y, z) (((x) & (y)) | (~(x) & (z)))
+#define LV_F2(x, y, z) (((x) | ~(y)) ^ (z))
+#define LV_F3(x, y, z) (((x) & (z)) | ((y) & ~(z)))
+#define LV_F4(x, y, z) ((x) ^ ((y) | ~(z)))
+
+__attribute__((target(SHA256_LANES_TARGET)))
+static inline void LV_RIPEMD160(LV s[5], const LV x[16]) {
+    LV v[2][5], t;
+    for (int i = 0; i < 5; i++)
+        v[0][i] = v[1][i] = s[i];
+    LV_RIPEMD_ROUND(0, LV_F0, LV_F4)
+    LV_RIPEMD_ROUND(1, LV_F1, LV_F3)
+    LV_RIPEMD_ROUND(2, LV_F2, LV_F2)
+    LV_RIPEMD_ROUND(3, LV_F3, LV_F1)
+    LV_RIPEMD_ROUND(4, LV_F4, LV_F0)
+    t = s[1] + v[0][2] + v[1][3];
+    s[1] = s[2] + v[0][3] + v[1][4];
+    s[2] = s[3] + v[0][4] + v[1][0];
+    s[3] = s[4] + v[0][0] + v[1][1];
+    s[4] = s[0] + v[0][1] + v[1][2];
+    s[0] = t;
+}
+
+__attribute__((target(SHA256_LANES_TARGET)))
+static void SHA256_LANES_FN(const unsigned char *msgs, size_t stride, size_t len, uint32_t *out) {
+    LV w[16], s[8];
+    unsigned char block[128];
+
+    for (int j = 0; j < SHA256_LANES; j++) {
+        sha256_pad(block, msgs + j * stride, len);
+        for (int i = 0; i < 16; i++)
+            w[i][j] = load_be32(block + 4 * i);
+    }
+    for (int i = 0; i < 8; i++)
+        s[i] = (LV){0} + SHA256_INIT[i];
+    LV_COMPRESS(s, w);
+
+    /* the 32 byte digest padded to a block */
+    for (int i = 0; i < 8; i++)
+        w[i] = s[i];
+    for (int i = 8; i < 16; i++)
+        w[i] = (LV){0} + (uint32_t)(i == 8 ? 0x80000000u : i == 15 ? 256 : 0);
+    for (int i = 0; i < 8; i++)
+        s[i] = (LV){0} + SHA256_INIT[i];
+    LV_COMPRESS(s, w);
+
+    for (int j = 0; j < SHA256_LANES; j++)
+        out[j] = s[0][j];
+}
+
+__attribute__((target(SHA256_LANES_TARGET)))
+static void HASH160_LANES_FN(const unsigned char *msgs, size_t stride, size_t len, unsigned char *out) {
+    LV w[2][16], s[8], r[5];
+    unsigned char block[128];
+    int blocks = 1;
+
+    for (int j = 0; j < SHA256_LANES; j++) {
+        blocks = sha256_pad(block, msgs + j * stride, len);
+        for (int i = 0; i < 16 * blocks; i++)
+            w[i >> 4][i & 15][j] = load_be32(block + 4 * i);
+    }
+    for (int i = 0; i < 8; i++)
+        s[i] = (LV){0} + SHA256_INIT[i];
+    for (int b = 0; b < blocks; b++)
+        LV_COMPRESS(s, w[b]);
+
+    /* RIPEMD160 reads the digest as little endian words */
+    for (int i = 0; i < 8; i++) {
+        LV v = s[i];
+        w[0][i] = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+    }
+    for (int i = 8; i < 16; i++)
+        w[0][i] = (LV){0} + (uint32_t)(i == 8 ? 0x80 : i == 14 ? 256 : 0);
+    for (int i = 0; i < 5; i++)
+        r[i] = (LV){0} + RIPEMD160_INIT[i];
+    LV_RIPEMD160(r, w[0]);
+
+    for (int j = 0; j < SHA256_LANES; j++) {
+        for (int i = 0; i < 5; i++) {
+            uint32_t v = r[i][j];
+            memcpy(out + 20 * j + 4 * i, &v, 4); /* little endian host */
+        }
+    }
+}
+
+#undef LV_F4
+#undef LV_F3
+#undef LV_F2
+#undef LV_F1
+#undef LV_F0
+#undef LV_RIPEMD_ROUND
+#undef LV_RIPEMD_STEP
+#undef LV_ROUND
+#undef LV_ROTL
+#undef LV_ROTR
+#undef LV_RIPEMD160
+#undef LV_COMPRESS
+#undef LV
+#undef SHA256_LANES_JOIN
+#undef SHA256_LANES_JOIN2
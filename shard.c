@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shard.h"
+#include "textfile.h"
+
+#define SHARD_MAGIC "wifcrack-shard 1"
+#define SHARD_MAX 1000000
+
+static uint64_t shard_bound(uint64_t total, int index, int count) {
+    return (uint64_t)((unsigned __int128)total * (unsigned)index / (unsigned)count);
+}
+
+void shard_range(uint64_t total, int index, int count, SchedulerRange *out) {
+    if (count <= 1) {
+        out->begin = 0;
+        out->end = total;
+        return;
+    }
+    out->begin = shard_bound(total, index, count);
+    out->end = shard_bound(total, index + 1, count);
+}
+
+int shard_parse(const char *s, int *index, int *count) {
+    char *end;
+    long i = strtol(s, &end, 10), n;
+    if (end == s || *end != '/')
+        return 0;
+    s = end + 1;
+    n = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || n < 1 || n > SHARD_MAX || i < 1 || i > n)
+        return 0;
+    *index = (int)i - 1;
+    *count = (int)n;
+    return 1;
+}
+
+int shard_save(const char *path, const unsigned char config[32], int index, int count,
+               int done, char *const *results, size_t result_count) {
+    char tmp[1024], hex[65];
+    FILE *f = textfile_create(path, tmp, sizeof(tmp));
+    if (!f)
+        return 0;
+    textfile_hex(config, 32, hex);
+    fprintf(f, "%s\nconfig %s\nshard %d/%d\nstatus %s\nresults %zu\n", SHARD_MAGIC, hex,
+            index + 1, count, done ? "done" : "stopped", result_count);
+    for (size_t i = 0; i < result_count; ++i)
+        fprintf(f, "%s\n", results[i]);
+    return textfile_commit(f, tmp, path);
+}
+
+typedef struct {
+    char config[65];
+    int index, count, done;
+    char **results;
+    size_t result_count;
+} ShardFile;
+
+static void shard_file_clear(ShardFile *s) {
+    for (size_t i = 0; i < s->result_count; ++i)
+        free(s->results[i]);
+    free(s->results);
+}
+
+static int shard_read(const char *path, ShardFile *s) {
+    FILE *f = fopen(path, "r");
+    char line[256], status[16];
+    size_t n;
+    int ok = 0;
+
+    memset(s, 0, sizeof(*s));
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+    if (!fgets(line, sizeof(line), f) || strcmp(line, SHARD_MAGIC "\n") != 0 ||
+        fscanf(f, "config %64s\nshard %d/%d\nstatus %15s\nresults %zu\n", s->config, &s->index,
+               &s->count, status, &n) != 5 ||
+        s->count < 1 || s->index < 1 || s->index > s->count || n > (1 << 24))
+        goto out;
+    s->index--;
+    s->done = strcmp(status, "done") == 0;
+    s->results = calloc(n ? n : 1, sizeof(char *));
+    if (!s->results)
+        goto out;
+    for (; s->result_count < n; ++s->result_count) {
+        size_t len;
+        if (!fgets(line, sizeof(line), f))
+            goto out;
+        len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+        if (!(s->results[s->result_count] = strdup(line)))
+            goto out;
+    }
+    ok = 1;
+out:
+    fclose(f);
+    if (!ok)
+        fprintf(stderr, "Error: %s is not a shard result file\n", path);
+    return ok;
+}
+
+/* The shards must be of the same job, each exactly once, all finished. */
+int shard_merge(const char *const *paths, size_t n) {
+    ShardFile *files = calloc(n ? n : 1, sizeof(ShardFile));
+    unsigned char *seen = NULL;
+    size_t total = 0, missing = 0;
+    int ok = n > 0 && files;
+
+    for (size_t i = 0; ok && i < n; ++i)
+        ok = shard_read(paths[i], &files[i]);
+    if (ok && !(seen = calloc(files[0].count, 1)))
+        ok = 0;
+    for (size_t i = 0; ok && i < n; ++i) {
+        if (strcmp(files[i].config, files[0].config) != 0 || files[i].count != files[0].count) {
+            fprintf(stderr, "Error: %s belongs to another job\n", paths[i]);
+            ok = 0;
+        } else if (seen[files[i].index]++) {
+            fprintf(stderr, "Error: shard %d/%d given twice\n", files[i].index + 1,
+                    files[i].count);
+            ok = 0;
+        } else if (!files[i].done) {
+            fprintf(stderr, "Warning: shard %d/%d did not finish\n", files[i].index + 1,
+                    files[i].count);
+            missing++;
+        }
+    }
+    for (int i = 0; ok && i < files[0].count; ++i) {
+        if (!seen[i]) {
+            fprintf(stderr, "Warning: shard %d/%d is missing\n", i + 1, files[0].count);
+            missing++;
+        }
+    }
+    for (size_t i = 0; ok && i < n; ++i) {
+        for (size_t k = 0; k < files[i].result_count; ++k) {
+            int dup = 0;
+            /* results are few, a quadratic check is fine */
+            for (size_t j = 0; j < i && !dup; ++j)
+                for (size_t m = 0; m < files[j].result_count && !dup; ++m)
+                    dup = strcmp(files[j].results[m], files[i].results[k]) == 0;
+            for (size_t m = 0; m < k && !dup; ++m)
+                dup = strcmp(files[i].results[m], files[i].results[k]) == 0;
+            if (!dup) {
+                printf("%s\n", files[i].results[k]);
+                total++;
+            }
+        }
+    }
+    if (ok)
+        printf("%zu result(s), %s\n", total, missing ? "incomplete" : "all shards done");
+    for (size_t i = 0; files && i < n; ++i)
+        shard_file_clear(&files[i]);
+    free(files);
+    free(seen);
+    return ok && missing == 0;
+}
@@ -0,0 +1,27 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "scheduler.h"
+
+/* Static split of a job over several machines.  Shard i of n (0 <= i < n)
+ * gets the ranks [i * total / n, (i + 1) * total / n) of every scheduler
+ * run, so the shards are contiguous, differ in size by at most one rank and
+ * together cover the keyspace exactly once. */
+void shard_range(uint64_t total, int index, int count, SchedulerRange *out);
+
+/* Parse "i/n" with 1 <= i <= n into a 0-based index.  Returns 1 on
+ * success. */
+int shard_parse(const char *s, int *index, int *count);
+
+/* Every shard writes its results to a small text file; shard_merge() reads
+ * the files of all the shards of one job, checks that they belong together
+ * and are complete, and prints the results once each.  ``config`` is the
+ * hash of the job without the shard (checkpoint_keyspace_hash()).  Returns
+ * 1 on success. */
+int shard_save(const char *path, const unsigned char config[32], int index, int count,
+               int done, char *const *results, size_t result_count);
+int shard_merge(const char *const *paths, size_t n);
+
+#endif /* SHARD_H */
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sink.h"
+
+int sink_push(ResultSink *s, const SinkRecord *r) {
+    uint64_t pos = __atomic_load_n(&s->head, __ATOMIC_RELAXED);
+    for (;;) {
+        SinkCell *c = &s->cells[pos % SINK_CAPACITY];
+        int64_t lag = (int64_t)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - pos);
+        if (lag == 0) {
+            /* the cell is free for ``pos``: claim it, fill it, publish it */
+            if (__atomic_compare_exchange_n(&s->head, &pos, pos + 1, 1, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                c->record = *r;
+                __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (lag < 0) {
+            /* the writer has not read the cell of the last round yet */
+            __atomic_add_fetch(&s->dropped, 1, __ATOMIC_RELAXED);
+            return 0;
+        } else {
+            pos = __atomic_load_n(&s->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int sink_pop(ResultSink *s, SinkRecord *r) {
+    SinkCell *c = &s->cells[s->tail % SINK_CAPACITY];
+    if (__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) != s->tail + 1)
+        return 0;
+    *r = c->record;
+    __atomic_store_n(&c->seq, s->tail + SINK_CAPACITY, __ATOMIC_RELEASE);
+    s->tail++;
+    return 1;
+}
+
+static void sink_write(FILE *f, const SinkRecord *r) {
+    char stamp[32];
+    struct tm tm;
+    gmtime_r(&r->time, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    fprintf(f, "{\"wif\":\"%s\",\"address\":\"%s\",\"key\":\"", r->wif, r->address);
+    for (int i = 0; i < 32; i++)
+        fprintf(f, "%02x", r->key[i]);
+    fprintf(f, "\",\"mode\":\"%s\",\"time\":\"%s\"}\n", r->mode, stamp);
+}
+
+static void sink_sync(ResultSink *s) {
+    fflush(s->f);
+    if (s->sync != SINK_SYNC_NEVER)
+        fsync(fileno(s->f));
+}
+
+static void *sink_writer(void *arg) {
+    ResultSink *s = arg;
+    const struct timespec poll = {0, SINK_POLL_MS * 1000000L};
+    time_t synced = time(NULL);
+    int dirty = 0;
+    SinkRecord r;
+
+    for (;;) {
+        /* read before draining, so that nothing queued before the stop is
+         * left behind */
+        int stop = __atomic_load_n(&s->stop, __ATOMIC_ACQUIRE);
+        while (sink_pop(s, &r)) {
+            sink_write(s->f, &r);
+            __atomic_add_fetch(&s->written, 1, __ATOMIC_RELAXED);
+            dirty = 1;
+            if (s->sync == SINK_SYNC_EVERY) {
+                sink_sync(s);
+                dirty = 0;
+            }
+        }
+        if (dirty) {
+            fflush(s->f);
+            if (s->sync > 0 && time(NULL) - synced >= s->sync) {
+                sink_sync(s);
+                synced = time(NULL);
+                dirty = 0;
+            }
+        }
+        if (stop)
+            break;
+        nanosleep(&poll, NULL);
+    }
+    sink_sync(s);
+    return NULL;
+}
+
+ResultSink *sink_open(const char *path, int sync) {
+    ResultSink *s = calloc(1, sizeof(ResultSink));
+    if (!s)
+        return NULL;
+    for (uint64_t i = 0; i < SINK_CAPACITY; i++)
+        s->cells[i].seq = i;
+    s->sync = sync;
+    s->f = fopen(path, "a");
+    if (!s->f) {
+        perror(path);
+        free(s);
+        return NULL;
+    }
+    if (pthread_create(&s->thread, NULL, sink_writer, s) != 0) {
+        fclose(s->f);
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void sink_close(ResultSink *s) {
+    if (!s)
+        return;
+    __atomic_store_n(&s->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(s->thread, NULL);
+    fclose(s->f);
+    free(s);
+}
+
+int sink_parse_sync(const char *text, int *sync) {
+    char *end;
+    long n;
+    if (strcmp(text, "every") == 0) {
+        *sync = SINK_SYNC_EVERY;
+        return 1;
+    }
+    if (strcmp(text, "never") == 0) {
+        *sync = SINK_SYNC_NEVER;
+        return 1;
+    }
+    n = strtol(text, &end, 10);
+    if (end == text || *end || n <= 0 || n > 86400)
+        return 0;
+    *sync = (int)n;
+    return 1;
+}
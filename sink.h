@@ -0,0 +1,60 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "bitcoin.h"
+
+#define SINK_CAPACITY 1024     /* records waiting for the writer, at most */
+#define SINK_SYNC_EVERY 0      /* fsync after every record */
+#define SINK_SYNC_NEVER (-1)   /* leave it to the system */
+#define SINK_POLL_MS 10        /* writer sleep while the queue is empty */
+
+/* One hit, as streamed to the results file. */
+typedef struct {
+    char wif[WIF_CHARS_MAX + 1];
+    char address[BITCOIN_ADDRESS_MAX];
+    unsigned char key[32];
+    const char *mode;   /* solver name, a static string */
+    time_t time;
+} SinkRecord;
+
+/* Hits go out as JSON Lines while the job runs.  Solver threads put a
+ * record in a bounded queue (many producers, one consumer; a sequence number
+ * per cell, no locks) and go on; a writer thread of its own formats, writes
+ * and syncs them, so a slow disk never stalls a search.  When the queue is
+ * full the record is counted in ``dropped`` rather than waited for; the
+ * worker still holds every result. */
+typedef struct {
+    uint64_t seq;
+    SinkRecord record;
+} SinkCell;
+
+typedef struct {
+    SinkCell cells[SINK_CAPACITY];
+    uint64_t head;      /* next cell a producer claims */
+    uint64_t tail;      /* next cell the writer reads, writer only */
+    uint64_t dropped;
+    uint64_t written;
+    int stop;
+    int sync;           /* seconds between fsyncs, or SINK_SYNC_* */
+    FILE *f;
+    pthread_t thread;
+} ResultSink;
+
+/* Append to ``path`` and start the writer.  Returns NULL on failure. */
+ResultSink *sink_open(const char *path, int sync);
+
+/* Queue a record without blocking.  Returns 0 if the queue was full. */
+int sink_push(ResultSink *s, const SinkRecord *r);
+
+/* Write what is queued, sync and stop the writer.  Producers must be done. */
+void sink_close(ResultSink *s);
+
+/* "every", "never" or a number of seconds into ``sync``.  Returns 0 if the
+ * policy is none of them. */
+int sink_parse_sync(const char *text, int *sync);
+
+#endif /* SINK_H */
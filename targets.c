@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bitcoin.h"
+#include "targets.h"
+
+#define BLOOM_BITS_PER_TARGET 16
+#define BLOOM_MIN_BITS 12
+
+TargetSet *target_set_create(void) {
+    return calloc(1, sizeof(TargetSet));
+}
+
+void target_set_free(TargetSet *s) {
+    if (!s)
+        return;
+    free(s->hashes);
+    free(s->buckets);
+    free(s->bloom);
+    free(s);
+}
+
+int target_set_add(TargetSet *s, const unsigned char hash[20]) {
+    if (s->count == s->capacity) {
+        size_t cap = s->capacity ? s->capacity * 2 : 16;
+        unsigned char (*tmp)[20] = realloc(s->hashes, cap * 20);
+        if (!tmp)
+            return 0;
+        s->hashes = tmp;
+        s->capacity = cap;
+    }
+    memcpy(s->hashes[s->count++], hash, 20);
+    return 1;
+}
+
+int target_set_add_address(TargetSet *s, const char *address) {
+    unsigned char hash[20];
+    address_type type = decode_bitcoin_address(address, hash);
+    if (type == ADDRESS_INVALID || !target_set_add(s, hash))
+        return 0;
+    s->types |= 1U << type;
+    return 1;
+}
+
+/* Add every address of a file, one per line.  Blank lines and lines
+ * starting with '#' are skipped; lines that do not decode are reported and
+ * skipped.  Returns 0 if the file cannot be read. */
+int target_set_load(TargetSet *s, const char *filename) {
+    FILE *f = fopen(filename, "r");
+    char line[256];
+    size_t bad = 0;
+    if (!f)
+        return 0;
+    while (fgets(line, sizeof(line), f)) {
+        char *p = line;
+        size_t len;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        len = strlen(p);
+        while (len > 0 && (p[len - 1] == '\n' || p[len - 1] == '\r' || p[len - 1] == ' '))
+            p[--len] = '\0';
+        if (len == 0 || *p == '#')
+            continue;
+        if (!target_set_add_address(s, p))
+            bad++;
+    }
+    fclose(f);
+    if (bad)
+        fprintf(stderr, "Warning: skipped %zu invalid address(es) in %s\n", bad, filename);
+    return 1;
+}
+
+static int cmp_hash(const void *a, const void *b) {
+    return memcmp(a, b, 20);
+}
+
+static uint32_t hash_word(const unsigned char *h, int i) {
+    return (uint32_t)h[i] << 24 | (uint32_t)h[i + 1] << 16 | (uint32_t)h[i + 2] << 8 | h[i + 3];
+}
+
+/* Bloom filter probes, taken from bytes the bucket index does not use;
+ * the hashes are uniformly distributed already. */
+#define BLOOM_PROBE(s, h, i) (hash_word(h, 4 + 4 * (i)) & ((1U << (s)->bloom_bits) - 1))
+
+/* Sort and deduplicate the hashes and build the bucket index and the
+ * filter.  Returns 0 on allocation failure. */
+int target_set_finish(TargetSet *s) {
+    size_t n = 0, buckets;
+
+    if (s->count > 0) {
+        qsort(s->hashes, s->count, 20, cmp_hash);
+        for (size_t i = 0; i < s->count; i++) {
+            if (n == 0 || memcmp(s->hashes[n - 1], s->hashes[i], 20) != 0)
+                memmove(s->hashes[n++], s->hashes[i], 20);
+        }
+    }
+    s->count = n;
+
+    /* about one hash per bucket */
+    s->bucket_bits = 0;
+    while (s->bucket_bits < 24 && ((size_t)1 << s->bucket_bits) < n)
+        s->bucket_bits++;
+    buckets = (size_t)1 << s->bucket_bits;
+    free(s->buckets);
+    s->buckets = calloc(buckets + 1, sizeof(uint32_t));
+    if (!s->buckets)
+        return 0;
+    for (size_t i = 0; i < n; i++)
+        s->buckets[(s->bucket_bits ? hash_word(s->hashes[i], 0) >> (32 - s->bucket_bits) : 0) + 1]++;
+    for (size_t b = 0; b < buckets; b++)
+        s->buckets[b + 1] += s->buckets[b];
+
+    s->bloom_bits = BLOOM_MIN_BITS;
+    while (s->bloom_bits < 31 && ((size_t)1 << s->bloom_bits) < n * BLOOM_BITS_PER_TARGET)
+        s->bloom_bits++;
+    free(s->bloom);
+    s->bloom = calloc(((size_t)1 << s->bloom_bits) / 64, sizeof(uint64_t));
+    if (!s->bloom)
+        return 0;
+    for (size_t i = 0; i < n; i++) {
+        for (int k = 0; k < 3; k++) {
+            uint32_t bit = BLOOM_PROBE(s, s->hashes[i], k);
+            s->bloom[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+    return 1;
+}
+
+long target_set_find(const TargetSet *s, const unsigned char hash[20]) {
+    uint32_t b;
+    for (int k = 0; k < 3; k++) {
+        uint32_t bit = BLOOM_PROBE(s, hash, k);
+        if (!(s->bloom[bit >> 6] >> (bit & 63) & 1))
+            return -1;
+    }
+    b = s->bucket_bits ? hash_word(hash, 0) >> (32 - s->bucket_bits) : 0;
+    for (uint32_t i = s->buckets[b]; i < s->buckets[b + 1]; i++) {
+        if (memcmp(s->hashes[i], hash, 20) == 0)
+            return (long)i;
+    }
+    return -1;
+}
+
+int target_set_contains(const TargetSet *s, const unsigned char hash[20]) {
+    return target_set_find(s, hash) >= 0;
+}
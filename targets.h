@@ -0,0 +1,38 @@
+#ifndef TARGETS_H
+#define TARGETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Set of target public key hashes.  The hashes are kept sorted in one flat
+ * array, indexed by their leading bits so that a lookup only compares the
+ * one or two entries of a bucket.  Nearly every candidate misses, so a small
+ * Bloom filter in front answers most lookups with three bit tests.  Build
+ * the set with target_set_add() and target_set_finish(); after that it is
+ * read only and can be shared between threads. */
+typedef struct {
+    unsigned char (*hashes)[20];
+    size_t count;
+    size_t capacity;
+    int bucket_bits;
+    uint32_t *buckets;      /* 2^bucket_bits + 1 offsets into hashes */
+    int bloom_bits;
+    uint64_t *bloom;        /* 2^bloom_bits bits */
+    unsigned types;         /* 1 << address_type of every address added */
+} TargetSet;
+
+TargetSet *target_set_create(void);
+void target_set_free(TargetSet *s);
+
+int target_set_add(TargetSet *s, const unsigned char hash[20]);
+/* Any address decode_bitcoin_address() takes; all types share one set, the
+ * hashes of different types cannot collide in practice. */
+int target_set_add_address(TargetSet *s, const char *address);
+int target_set_load(TargetSet *s, const char *filename);
+int target_set_finish(TargetSet *s);
+
+int target_set_contains(const TargetSet *s, const unsigned char hash[20]);
+/* Index of ``hash`` in ``hashes``, -1 if it is not in the set. */
+long target_set_find(const TargetSet *s, const unsigned char hash[20]);
+
+#endif /* TARGETS_H */
@@ -0,0 +1,686 @@
+#include "bitcoin.h"
+#include "hash.h"
+#include "jump.h"
+#include "walk.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include <openssl/ripemd.h>
+#include <openssl/sha.h>
+
+static void hex_to_bytes(const char *hex, unsigned char *out, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        sscanf(hex + 2 * i, "%2hhx", &out[i]);
+}
+
+/* Reference hash160 computed with the OpenSSL EC_POINT API only. */
+static void openssl_hash160(const unsigned char *priv, int compressed, unsigned char *out) {
+    EC_GROUP *group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    EC_POINT *pt = EC_POINT_new(group);
+    BIGNUM *k = BN_bin2bn(priv, 32, NULL);
+    unsigned char pub[65], sha[32];
+    size_t len;
+
+    assert(EC_POINT_mul(group, pt, k, NULL, NULL, NULL));
+    len = EC_POINT_point2oct(group, pt,
+                             compressed ? POINT_CONVERSION_COMPRESSED : POINT_CONVERSION_UNCOMPRESSED,
+                             pub, sizeof(pub), NULL);
+    SHA256(pub, len, sha);
+    RIPEMD160(sha, 32, out);
+    BN_free(k);
+    EC_POINT_free(pt);
+    EC_GROUP_free(group);
+}
+
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ULL;
+
+static void random_scalar(unsigned char *out) {
+    for (int i = 0; i < 32; i++) {
+        rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        out[i] = (unsigned char)(rng_state >> 56);
+    }
+}
+
+static void test_sha256(void) {
+    static const struct {
+        const char *msg;
+        const char *digest;
+    } vectors[] = {
+        {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+    };
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        unsigned char expected[32], digest[32];
+        hex_to_bytes(vectors[i].digest, expected, 32);
+        sha256_short((const unsigned char *)vectors[i].msg, strlen(vectors[i].msg), digest);
+        assert(memcmp(digest, expected, 32) == 0);
+    }
+    /* every single block length against OpenSSL */
+    for (size_t len = 0; len <= SHA256_BLOCK_MAX; len++) {
+        unsigned char msg[SHA256_BLOCK_MAX], expected[32], digest[32];
+        uint32_t checksum;
+        random_scalar(msg);
+        random_scalar(msg + 23);
+        SHA256(msg, len, expected);
+        sha256_short(msg, len, digest);
+        assert(memcmp(digest, expected, 32) == 0);
+        SHA256(expected, 32, expected);
+        checksum = sha256d_checksum(msg, len);
+        assert(checksum == ((uint32_t)expected[0] << 24 | (uint32_t)expected[1] << 16 |
+                            (uint32_t)expected[2] << 8 | expected[3]));
+    }
+}
+
+/* Every kernel the CPU supports must agree with the scalar checksum, for
+ * batch sizes that are not a multiple of the lane count too. */
+static void test_sha256_batch(void) {
+    enum { N = 77, STRIDE = 40 };
+    static unsigned char msgs[N * STRIDE];
+    uint32_t expected[N], sums[N];
+    for (int i = 0; i < N * STRIDE; i += 32)
+        random_scalar(msgs + i);
+    for (int id = SHA256_IMPL_SCALAR; id <= SHA256_IMPL_AVX512; id++) {
+        if (!sha256_impl_supported((sha256_impl_id)id))
+            continue;
+        assert(sha256_select_impl((sha256_impl_id)id));
+        for (size_t len = 33; len <= 34; len++) {
+            for (int i = 0; i < N; i++)
+                expected[i] = sha256d_checksum(msgs + i * STRIDE, len);
+            for (size_t n = 1; n <= N; n += 19) {
+                memset(sums, 0, sizeof(sums));
+                sha256d_checksum_batch(msgs, STRIDE, len, n, sums);
+                assert(memcmp(sums, expected, n * sizeof(uint32_t)) == 0);
+            }
+        }
+    }
+    assert(sha256_select_impl(SHA256_IMPL_AUTO));
+}
+
+/* Batched checks report exactly the candidates wif_num_check_payload accepts. */
+static void test_hash160(void) {
+    static const struct {
+        const char *msg_hex;
+        const char *hash_hex;
+    } vectors[] = {
+        /* public keys of private key 1, compressed and uncompressed */
+        {"0279BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798",
+         "751e76e8199196d454941c45d1b3a323f1433bd6"},
+        {"0479BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798"
+         "483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8",
+         "91b24bf9f5288532960ac687abb035127b1d28a5"},
+    };
+    unsigned char msg[HASH160_MSG_MAX], hash[20], expected[20], sha[32];
+    uint32_t state[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    unsigned char block[64] = {0x61, 0x62, 0x63, 0x80};
+
+    /* RIPEMD160("abc") */
+    block[56] = 24;
+    ripemd160_transform(state, block);
+    hex_to_bytes("8eb208f7e05d987a9b044a8e98c6b087f15a0bfc", expected, 20);
+    for (int i = 0; i < 5; i++)
+        assert((uint32_t)(expected[4 * i] | expected[4 * i + 1] << 8 | expected[4 * i + 2] << 16 |
+                          (uint32_t)expected[4 * i + 3] << 24) == state[i]);
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        size_t len = strlen(vectors[i].msg_hex) / 2;
+        hex_to_bytes(vectors[i].msg_hex, msg, len);
+        hex_to_bytes(vectors[i].hash_hex, expected, 20);
+        hash160(msg, len, hash);
+        assert(memcmp(hash, expected, 20) == 0);
+    }
+    for (size_t len = 0; len <= HASH160_MSG_MAX; len++) {
+        for (size_t i = 0; i < len; i++)
+            msg[i] = (unsigned char)(i * 29 + len);
+        SHA256(msg, len, sha);
+        RIPEMD160(sha, 32, expected);
+        hash160(msg, len, hash);
+        assert(memcmp(hash, expected, 20) == 0);
+    }
+}
+
+static void test_hash160_batch(void) {
+    enum { N = 77, STRIDE = 96 };
+    static unsigned char msgs[N * STRIDE];
+    static unsigned char expected[N * 20], hashes[N * 20];
+    for (int i = 0; i < N * STRIDE; i += 32)
+        random_scalar(msgs + i);
+    for (int id = SHA256_IMPL_SCALAR; id <= SHA256_IMPL_AVX512; id++) {
+        if (!sha256_impl_supported((sha256_impl_id)id))
+            continue;
+        assert(sha256_select_impl((sha256_impl_id)id));
+        for (size_t len = 33; len <= 65; len += 32) {
+            for (int i = 0; i < N; i++)
+                hash160(msgs + i * STRIDE, len, expected + 20 * i);
+            for (size_t n = 1; n <= N; n += 19) {
+                memset(hashes, 0, sizeof(hashes));
+                hash160_batch(msgs, STRIDE, len, n, hashes);
+                assert(memcmp(hashes, expected, n * 20) == 0);
+            }
+        }
+    }
+    assert(sha256_select_impl(SHA256_IMPL_AUTO));
+}
+
+static void test_check_batch(void) {
+    static const char *wifs[2] = {"5KPk2XXRGVYQwBxkRGFm5KGnZYBYTBiamj5fMrCcUb93dY842Kv",
+                                  "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6"};
+    for (int compressed = 0; compressed < 2; compressed++) {
+        WifCheckBatch b;
+        wif_num valid, n;
+        unsigned char key[32];
+        size_t pass;
+        char wif[WIF_CHARS_MAX + 1];
+        int len = (int)strlen(wifs[compressed]);
+
+        assert(wif_num_from_base58(&valid, wifs[compressed]));
+        assert(decode_wif(wifs[compressed], key, NULL));
+        wif_num_to_base58(&valid, wif, len);
+        assert(strcmp(wif, wifs[compressed]) == 0);
+
+        wif_check_batch_init(&b, compressed);
+        n = valid;
+        for (int i = 0; i < WIF_CHECK_BATCH - 1; i++) {
+            n.v[1] += 1; /* key changes, checksum does not: rejected */
+            assert(!wif_check_batch_add(&b, &n));
+        }
+        assert(b.count == WIF_CHECK_BATCH - 1);
+        assert(wif_check_batch_add(&b, &valid));
+        pass = wif_check_batch_run(&b);
+        assert(pass == 1 && b.count == 0);
+        assert(wif_num_cmp(&b.nums[0], &valid) == 0);
+        assert(memcmp(wif_check_batch_key(&b, 0), key, 32) == 0);
+
+        /* the wrong compression flag never reaches the checksum */
+        wif_check_batch_init(&b, !compressed);
+        assert(!wif_check_batch_add(&b, &valid) && b.count == 0);
+    }
+}
+
+static void test_decode_wif(void) {
+    static const struct {
+        const char *wif;
+        int valid;
+        int compressed;
+    } vectors[] = {
+        {"5KPk2XXRGVYQwBxkRGFm5KGnZYBYTBiamj5fMrCcUb93dY842Kv", 1, 0},
+        {"L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6", 1, 1},
+        {"5HueCGU8rMjxEXxiPuD5BDku4MkFqeZyd4dZ1jvhTVqvbTLvyTJ", 1, 0},
+        {"KwdMAjGmerYanjeui5SHS7JkmpZvVipYvB2LJGU1ZxJwYvP98617", 1, 1},
+        /* one character off breaks the checksum */
+        {"L5EZftvrYaSudioZVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6", 0, 0},
+        {"5KPk2XXRGVYQwBxkRGFm5KGnZYBYTBiamj5fMrCcUb93dY842Kw", 0, 0},
+        /* not Base58, wrong length */
+        {"L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz0", 0, 0},
+        {"L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz", 0, 0},
+        {"L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6L5EZftvrYaSudiozVRzTqL", 0, 0},
+        {"", 0, 0},
+    };
+    char out[WIF_CHARS_MAX + 1];
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        unsigned char key[32], key2[32];
+        int compressed = -1;
+        wif_num n;
+        assert(decode_wif(vectors[i].wif, key, &compressed) == vectors[i].valid);
+        if (!vectors[i].valid)
+            continue;
+        assert(compressed == vectors[i].compressed);
+        assert(wif_num_from_base58(&n, vectors[i].wif));
+        assert(wif_num_check_payload(&n, compressed, key2));
+        assert(!wif_num_check_payload(&n, !compressed, NULL));
+        assert(memcmp(key, key2, 32) == 0);
+        assert(encode_wif(key, compressed, out) == (int)strlen(vectors[i].wif));
+        assert(strcmp(out, vectors[i].wif) == 0);
+    }
+    /* keys at both ends of the range */
+    for (int k = 0; k < 2; k++) {
+        unsigned char key[32], key2[32];
+        int compressed = -1;
+        memset(key, k ? 0xFF : 0, 32);
+        key[31] = 1;
+        for (int c = 0; c < 2; c++) {
+            assert(encode_wif(key, c, out) == (c ? 52 : 51));
+            assert(decode_wif(out, key2, &compressed) && compressed == c);
+            assert(memcmp(key, key2, 32) == 0);
+        }
+    }
+}
+
+/* Private keys are 1 ... n - 1. */
+static void test_private_key_valid(void) {
+    unsigned char key[32] = {0};
+    assert(!private_key_valid(key));
+    key[31] = 1;
+    assert(private_key_valid(key));
+    memcpy(key, "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFE"
+                "\xBA\xAE\xDC\xE6\xAF\x48\xA0\x3B\xBF\xD2\x5E\x8C\xD0\x36\x41\x40", 32);
+    assert(private_key_valid(key));
+    key[31]++;
+    assert(!private_key_valid(key));
+    memset(key, 0xFF, 32);
+    assert(!private_key_valid(key));
+}
+
+static void test_decode_address(void) {
+    static const struct {
+        const char *address;
+        const char *hash; /* NULL if the address must be rejected */
+    } vectors[] = {
+        /* key 1, compressed and uncompressed */
+        {"1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH", "751e76e8199196d454941c45d1b3a323f1433bd6"},
+        {"1EHNa6Q4Jz2uvNExL497mE43ikXhwF6kZm", "91b24bf9f5288532960ac687abb035127b1d28a5"},
+        /* leading zero bytes are leading '1's */
+        {"1111111111111111111114oLvT2", "0000000000000000000000000000000000000000"},
+        {"3H1qgYqxfzqxmMT9MKAjbxyrpVZ5YtA3wX", ""},
+        /* checksum, alphabet, length */
+        {"1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMJ", NULL},
+        {"1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAM0", NULL},
+        {"1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAM", NULL},
+        {"11BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH", NULL},
+        {"1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH", NULL},
+        {"", NULL},
+    };
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        unsigned char hash[20], expected[20];
+        int ok = base58_decode_bitcoin_address(vectors[i].address, hash);
+        assert(ok == (vectors[i].hash != NULL));
+        if (ok && vectors[i].hash[0]) {
+            hex_to_bytes(vectors[i].hash, expected, 20);
+            assert(memcmp(hash, expected, 20) == 0);
+        }
+    }
+}
+
+/* Every address type of key 1, and the P2SH-P2WPKH script hash. */
+static void test_address_types(void) {
+    static const struct {
+        const char *address;
+        address_type type;
+        const char *hash;
+    } vectors[] = {
+        {"1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH", ADDRESS_P2PKH, "751e76e8199196d454941c45d1b3a323f1433bd6"},
+        {"1EHNa6Q4Jz2uvNExL497mE43ikXhwF6kZm", ADDRESS_P2PKH, "91b24bf9f5288532960ac687abb035127b1d28a5"},
+        {"3JvL6Ymt8MVWiCNHC7oWU6nLeHNJKLZGLN", ADDRESS_P2SH, "bcfeb728b584253d5f3f70bcb780e9ef218a68f4"},
+        {"bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4", ADDRESS_P2WPKH, "751e76e8199196d454941c45d1b3a323f1433bd6"},
+        {"BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T4", ADDRESS_P2WPKH, "751e76e8199196d454941c45d1b3a323f1433bd6"},
+        /* mixed case, checksum, a 32 byte program (P2WSH), testnet version */
+        {"bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3T4", ADDRESS_INVALID, NULL},
+        {"bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t5", ADDRESS_INVALID, NULL},
+        {"bc1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3qccfmv3", ADDRESS_INVALID, NULL},
+        {"mrCDrCybB6J1vRfbwM5hemdJz73FwDBC8r", ADDRESS_INVALID, NULL},
+    };
+    unsigned char hash[20], expected[20], script[20];
+    char address[BITCOIN_ADDRESS_MAX];
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        assert(decode_bitcoin_address(vectors[i].address, hash) == vectors[i].type);
+        if (vectors[i].hash) {
+            hex_to_bytes(vectors[i].hash, expected, 20);
+            assert(memcmp(hash, expected, 20) == 0);
+            /* encoding gives the address back, bech32 in lower case */
+            assert(encode_bitcoin_address(vectors[i].type, hash, address));
+            assert(strcasecmp(address, vectors[i].address) == 0);
+        }
+    }
+    /* a leading zero byte is a '1' */
+    memset(hash, 0, 20);
+    assert(encode_bitcoin_address(ADDRESS_P2PKH, hash, address));
+    assert(strcmp(address, "1111111111111111111114oLvT2") == 0);
+    assert(!encode_bitcoin_address(ADDRESS_INVALID, hash, address));
+    hex_to_bytes("751e76e8199196d454941c45d1b3a323f1433bd6", hash, 20);
+    hex_to_bytes("bcfeb728b584253d5f3f70bcb780e9ef218a68f4", expected, 20);
+    p2wpkh_script_hash_batch(hash, 1, script);
+    assert(memcmp(script, expected, 20) == 0);
+}
+
+static void test_known_vectors(ec_context *ctx) {
+    static const struct {
+        const char *priv;
+        const char *hash_compressed;
+        const char *hash_uncompressed;
+    } vectors[] = {
+        {"0000000000000000000000000000000000000000000000000000000000000001",
+         "751e76e8199196d454941c45d1b3a323f1433bd6", "91b24bf9f5288532960ac687abb035127b1d28a5"},
+        /* n - 1 = -G */
+        {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140", NULL, NULL},
+        /* n + 1 must reduce to G */
+        {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364142",
+         "751e76e8199196d454941c45d1b3a323f1433bd6", "91b24bf9f5288532960ac687abb035127b1d28a5"},
+    };
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        unsigned char priv[32], expected[20], hash[20];
+        ec_point p;
+        hex_to_bytes(vectors[i].priv, priv, 32);
+        assert(ec_point_init(ctx, &p));
+        assert(ec_point_set_scalar(ctx, &p, priv, 32, 0));
+        for (int compressed = 0; compressed < 2; compressed++) {
+            const char *hex = compressed ? vectors[i].hash_compressed : vectors[i].hash_uncompressed;
+            if (hex)
+                hex_to_bytes(hex, expected, 20);
+            else
+                openssl_hash160(priv, compressed, expected);
+            assert(ec_point_hash160(ctx, &p, compressed, hash));
+            assert(memcmp(hash, expected, 20) == 0);
+        }
+        ec_point_clear(&p);
+    }
+}
+
+static void test_random_scalars(ec_context *ctx) {
+    for (int i = 0; i < 200; i++) {
+        unsigned char priv[32], expected[20], hash[20];
+        ec_point p;
+        random_scalar(priv);
+        assert(ec_point_init(ctx, &p));
+        assert(ec_point_set_scalar(ctx, &p, priv, 32, 0));
+        for (int compressed = 0; compressed < 2; compressed++) {
+            openssl_hash160(priv, compressed, expected);
+            assert(ec_point_hash160(ctx, &p, compressed, hash));
+            assert(memcmp(hash, expected, 20) == 0);
+        }
+        /* the legacy helper uses the OpenSSL EC_KEY API */
+        for (int compressed = 0; compressed < 2; compressed++) {
+            assert(generate_pubkey_hash_from_privkey(priv, compressed, expected));
+            assert(ec_point_hash160(ctx, &p, compressed, hash));
+            assert(memcmp(hash, expected, 20) == 0);
+        }
+        ec_point_clear(&p);
+    }
+}
+
+/* a*G + b*G == (a+b)*G, P + (-P) == infinity, P + P == 2P */
+static void test_group_laws(ec_context *ctx) {
+    for (int i = 0; i < 50; i++) {
+        unsigned char a[32], b[32], sum[33];
+        unsigned char h1[20], h2[20];
+        ec_point pa, pb, ps, pn;
+        unsigned carry = 0;
+
+        random_scalar(a);
+        random_scalar(b);
+        a[0] &= 0x7F;
+        b[0] &= 0x7F;
+        for (int k = 31; k >= 0; k--) {
+            carry += a[k] + b[k];
+            sum[k + 1] = (unsigned char)carry;
+            carry >>= 8;
+        }
+        sum[0] = (unsigned char)carry;
+
+        assert(ec_point_init(ctx, &pa) && ec_point_init(ctx, &pb));
+        assert(ec_point_init(ctx, &ps) && ec_point_init(ctx, &pn));
+        assert(ec_point_set_scalar(ctx, &pa, a, 32, 0));
+        assert(ec_point_set_scalar(ctx, &pb, b, 32, 0));
+        assert(ec_point_set_scalar(ctx, &ps, sum, 33, 0));
+
+        /* mix normalized and projective operands */
+        if (i & 1)
+            assert(ec_points_normalize(ctx, &pb, 1));
+        assert(ec_point_add(ctx, &pn, &pa, &pb));
+        assert(ec_point_hash160(ctx, &pn, 1, h1));
+        assert(ec_point_hash160(ctx, &ps, 1, h2));
+        assert(memcmp(h1, h2, 20) == 0);
+
+        assert(ec_point_add(ctx, &pn, &pa, &pa));
+        assert(ec_point_copy(&ps, &pa));
+        assert(ec_point_add(ctx, &ps, &ps, &pa));
+        assert(ec_point_hash160(ctx, &pn, 0, h1));
+        assert(ec_point_hash160(ctx, &ps, 0, h2));
+        assert(memcmp(h1, h2, 20) == 0);
+
+        assert(ec_point_set_scalar(ctx, &pn, a, 32, 1));
+        assert(ec_point_add(ctx, &pn, &pn, &pa));
+        assert(!ec_point_hash160(ctx, &pn, 1, h1));
+
+        ec_point_clear(&pa);
+        ec_point_clear(&pb);
+        ec_point_clear(&ps);
+        ec_point_clear(&pn);
+    }
+}
+
+/* Key 0 gives the point at infinity: it has a zero hash and a flag, the
+ * points around it are hashed all the same. */
+static void test_batch_hash(ec_context *ctx) {
+    enum { N = 300, ZERO = 70 };
+    static ec_point points[N];
+    static unsigned char privs[N][32], hashes[N * 20], infinite[N];
+    static const unsigned char zero[20];
+    for (int i = 0; i < N; i++) {
+        random_scalar(privs[i]);
+        if (i == ZERO)
+            memset(privs[i], 0, 32);
+        assert(ec_point_init(ctx, &points[i]));
+        assert(ec_point_set_scalar(ctx, &points[i], privs[i], 32, 0));
+    }
+    for (int compressed = 1; compressed >= 0; compressed--) {
+        assert(ec_points_hash160(ctx, points, N, compressed, hashes, infinite));
+        for (int i = 0; i < N; i++) {
+            unsigned char expected[20];
+            assert(infinite[i] == (i == ZERO));
+            if (i == ZERO) {
+                assert(memcmp(hashes + 20 * i, zero, 20) == 0);
+                continue;
+            }
+            openssl_hash160(privs[i], compressed, expected);
+            assert(memcmp(hashes + 20 * i, expected, 20) == 0);
+        }
+    }
+    for (int i = 0; i < N; i++)
+        ec_point_clear(&points[i]);
+}
+
+/* The point followed by the walk must match a direct multiplication. */
+/* JUMP visits exactly the block values with a valid compression flag, in
+ * increasing order, whatever the length of the known tail. */
+static void test_jump(void) {
+    static const struct {
+        const char *wif;
+        int compressed;
+    } cases[] = {
+        {"L5EZftvrYaSud___zTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6xx", 1}, /* s = 36 */
+        {"L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5___M9BAN6tMJX8oTWz6", 1}, /* s = 16 */
+        {"L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJ___oTWz", 1}, /* s = 4, no jump */
+        {"L5___tvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6", 1}, /* s = 47 */
+        {"5KPk2XXRGVYQwB___GFm5KGnZYBYTBiamj5fMrCcUb93dY842Kv", 0},
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        JumpTables *t = jump_tables_create(cases[c].wif, cases[c].compressed);
+        char wif[WIF_CHARS_MAX + 1];
+        const char *p = strchr(cases[c].wif, '_');
+        int first = (int)(p - cases[c].wif);
+        uint64_t rank = 0;
+        wif_num num;
+
+        if (c == 2) {
+            assert(t == NULL);
+            continue;
+        }
+        assert(t != NULL);
+        strcpy(wif, cases[c].wif);
+        if (t->total)
+            jump_value(t, 0, &num);
+        for (int i = 0; i < 58 * 58 * 58; i++) {
+            wif_num v;
+            wif[first] = BASE58_ALPHABET[i / (58 * 58)];
+            wif[first + 1] = BASE58_ALPHABET[i / 58 % 58];
+            wif[first + 2] = BASE58_ALPHABET[i % 58];
+            assert(wif_num_from_base58(&v, wif));
+            if (cases[c].compressed && ((v.v[0] >> 32) & 0xFF) != 0x01)
+                continue;
+            assert(rank < t->total);
+            assert(wif_num_cmp(&v, &num) == 0);
+            assert(jump_rank(t, wif) == rank);
+            if (++rank < t->total)
+                jump_next(t, rank - 1, &num);
+        }
+        assert(rank == t->total);
+        jump_tables_free(t);
+    }
+}
+
+static void test_walk(ec_context *ctx) {
+    static const char *wifs[2] = {
+        "5KPk2XXRGVYQwBxkRGFm5KGnZYBYTBiamj5fMrCcUb93dY842Kv",
+        "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6"};
+    GuessPos pos[3] = {{3, "zZ1a"}, {20, "123456789AB"}, {48, "xyzQ"}};
+    for (int compressed = 0; compressed < 2; compressed++) {
+        WalkTables *t = walk_tables_create(ctx, wifs[compressed], pos, 3, compressed, 1);
+        WalkState s;
+        ec_point q;
+        int n = 0;
+        assert(t && walk_state_init(&s, ctx, t));
+        assert(ec_point_init(ctx, &q));
+        do {
+            wif_num num, key, version = {{0, 0, 0, 0, 0x80}};
+            unsigned char bytes[40], h1[20], h2[20];
+            int negative;
+            assert(wif_num_from_base58(&num, s.wif));
+            assert(wif_num_cmp(&num, &s.num) == 0);
+            wif_num_shr(&key, &num, t->shift);
+            negative = wif_num_cmp(&key, &version) < 0;
+            if (negative) {
+                wif_num_sub(&version, &key);
+                key = version;
+            } else {
+                wif_num_sub(&key, &version);
+            }
+            wif_num_to_bytes(&key, bytes, sizeof(bytes));
+            assert(ec_point_set_scalar(ctx, &q, bytes, sizeof(bytes), negative));
+            assert(ec_point_hash160(ctx, &s.point, 1, h1));
+            assert(ec_point_hash160(ctx, &q, 1, h2));
+            assert(memcmp(h1, h2, 20) == 0);
+            n++;
+        } while (walk_next(&s, ctx));
+        assert(n == 4 * 11 * 4);
+        assert(walk_keyspace(t) == (uint64_t)n);
+
+        /* jumping to a rank lands on the candidate the walk visits there */
+        for (int rank = n - 1; rank >= 0; rank -= 7) {
+            WalkState seek, ref;
+            unsigned char h1[20], h2[20];
+            assert(walk_state_init(&seek, ctx, t) && walk_state_init(&ref, ctx, t));
+            assert(walk_state_seek(&seek, ctx, (uint64_t)rank));
+            for (int i = 0; i < rank; i++)
+                assert(walk_next(&ref, ctx));
+            assert(strcmp(seek.wif, ref.wif) == 0);
+            assert(wif_num_cmp(&seek.num, &ref.num) == 0);
+            assert(memcmp(seek.dir, ref.dir, sizeof(seek.dir)) == 0);
+            assert(ec_point_hash160(ctx, &seek.point, 1, h1));
+            assert(ec_point_hash160(ctx, &ref.point, 1, h2));
+            assert(memcmp(h1, h2, 20) == 0);
+            /* and keeps walking in the same order */
+            assert(walk_next(&seek, ctx) == walk_next(&ref, ctx));
+            assert(strcmp(seek.wif, ref.wif) == 0);
+            walk_state_clear(&seek);
+            walk_state_clear(&ref);
+        }
+        ec_point_clear(&q);
+        walk_state_clear(&s);
+        walk_tables_free(t);
+    }
+}
+
+#define GEN_TABLE_FILE "/tmp/wifcrack_test_gen.table"
+
+#ifndef WIFCRACK_OPENSSL_EC
+static ino_t file_id(const char *path) {
+    struct stat st;
+    assert(stat(path, &st) == 0);
+    return st.st_ino;
+}
+#endif
+
+/* The wide table is built once, then mapped as it is; a damaged one is built
+ * again.  Every multiplication agrees with the built-in table and OpenSSL. */
+static void test_gen_table(ec_context *ctx) {
+#ifdef WIFCRACK_OPENSSL_EC
+    /* OpenSSL multiplies with its own tables */
+    (void)ctx;
+    assert(!ec_gen_table_open(GEN_TABLE_FILE));
+#else
+    struct timespec times[2];
+    struct stat st;
+    ino_t id;
+    FILE *f, *g;
+    int c;
+
+    remove(GEN_TABLE_FILE);
+    remove(GEN_TABLE_FILE ".stamp");
+    assert(ec_gen_table_open(GEN_TABLE_FILE));
+    id = file_id(GEN_TABLE_FILE);
+    test_known_vectors(ctx);
+    test_random_scalars(ctx);
+    test_group_laws(ctx);
+
+    assert(ec_gen_table_open(GEN_TABLE_FILE));
+    assert(file_id(GEN_TABLE_FILE) == id);
+
+    f = fopen(GEN_TABLE_FILE, "r+");
+    assert(f && fseek(f, 4096 + 12345, SEEK_SET) == 0);
+    fputc(fgetc(f) ^ 1, f);
+    fclose(f);
+    ec_gen_table_close();
+    assert(ec_gen_table_open(GEN_TABLE_FILE));
+    assert(file_id(GEN_TABLE_FILE) != id);
+    test_random_scalars(ctx);
+
+    /* a damaged copy restored with the modification time of the good file,
+     * in an entry no open recomputes: the hash catches it */
+    id = file_id(GEN_TABLE_FILE);
+    assert(stat(GEN_TABLE_FILE ".stamp", &st) == 0);
+    assert(stat(GEN_TABLE_FILE, &st) == 0);
+    f = fopen(GEN_TABLE_FILE, "rb");
+    g = fopen(GEN_TABLE_FILE ".copy", "wb");
+    assert(f && g);
+    while ((c = fgetc(f)) != EOF)
+        fputc(ftell(f) == 4096 + 777777 ? c ^ 1 : c, g);
+    fclose(f);
+    fclose(g);
+    times[0] = st.st_atim;
+    times[1] = st.st_mtim;
+    assert(utimensat(AT_FDCWD, GEN_TABLE_FILE ".copy", times, 0) == 0);
+    assert(rename(GEN_TABLE_FILE ".copy", GEN_TABLE_FILE) == 0);
+    ec_gen_table_close();
+    assert(ec_gen_table_open(GEN_TABLE_FILE));
+    assert(file_id(GEN_TABLE_FILE) != id);
+    test_known_vectors(ctx);
+
+    ec_gen_table_close();
+    test_known_vectors(ctx);
+    assert(!ec_gen_table_open("/nonexistent/wifcrack.table"));
+    remove(GEN_TABLE_FILE);
+    remove(GEN_TABLE_FILE ".stamp");
+#endif
+}
+
+int main() {
+    ec_context *ctx = ec_context_create();
+    assert(ctx != NULL);
+
+    test_sha256();
+    test_sha256_batch();
+    test_hash160();
+    test_hash160_batch();
+    test_decode_wif();
+    test_private_key_valid();
+    test_decode_address();
+    test_address_types();
+    test_check_batch();
+    test_known_vectors(ctx);
+    test_random_scalars(ctx);
+    test_group_laws(ctx);
+    test_batch_hash(ctx);
+    test_walk(ctx);
+    test_jump();
+    test_gen_table(ctx);
+
+    ec_context_free(ctx);
+    printf("Bitcoin crypto tests passed.\n");
+    return 0;
+}
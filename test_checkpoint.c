@@ -0,0 +1,99 @@
+#include "checkpoint.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATH "/tmp/wifcrack_test.checkpoint"
+
+static guess_entry *guess(const char *chars, guess_entry *next) {
+    guess_entry *ge = calloc(1, sizeof(guess_entry));
+    assert(ge);
+    ge->chars = strdup(chars);
+    ge->next = next;
+    return ge;
+}
+
+/* The hash covers what defines the keyspace, not the thread count. */
+static void test_config_hash(void) {
+    Configuration *a = configuration_create("1EUXSxuUVy2PC5enGXR1a3yxbEjNWMHuem",
+                                            "L5EZ_tvr", "", WORK_SEARCH, guess("abc", NULL));
+    Configuration *b = configuration_create("1EUXSxuUVy2PC5enGXR1a3yxbEjNWMHuem",
+                                            "L5EZ_tvr", "", WORK_SEARCH, guess("abd", NULL));
+    unsigned char ha[32], hb[32], hc[32];
+    int threads = 7;
+    checkpoint_config_hash(a, ha);
+    checkpoint_config_hash(b, hb);
+    assert(memcmp(ha, hb, 32) != 0);
+    configuration_set_force_threads(a, &threads);
+    checkpoint_config_hash(a, hc);
+    assert(memcmp(ha, hc, 32) == 0);
+    configuration_free(a);
+    configuration_free(b);
+}
+
+static void test_round_trip(void) {
+    SchedulerRange ranges[] = {{5, 17}, {100, 1ULL << 40}, {(1ULL << 62), UINT64_MAX}};
+    char *results[] = {"L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6", "Dummy result"};
+    Checkpoint c = {{0}, 3, UINT64_MAX, ranges, 3, results, 2}, r;
+    unsigned char other[32];
+    memset(c.config, 0xA5, 32);
+    memset(other, 0x5A, 32);
+
+    assert(checkpoint_save(PATH, &c));
+    assert(checkpoint_load(PATH, c.config, &r) == 1);
+    assert(r.stage == 3 && r.total == UINT64_MAX);
+    assert(r.range_count == 3 && memcmp(r.ranges, ranges, sizeof(ranges)) == 0);
+    assert(r.result_count == 2);
+    assert(strcmp(r.results[0], results[0]) == 0 && strcmp(r.results[1], results[1]) == 0);
+    checkpoint_clear(&r);
+
+    /* another job's checkpoint is rejected */
+    assert(checkpoint_load(PATH, other, &r) == -1);
+    assert(r.ranges == NULL && r.results == NULL);
+
+    /* saving again replaces the file, nothing is left over */
+    c.range_count = 0;
+    c.result_count = 0;
+    assert(checkpoint_save(PATH, &c));
+    assert(checkpoint_load(PATH, c.config, &r) == 1 && r.range_count == 0);
+    checkpoint_clear(&r);
+    assert(fopen(PATH ".tmp", "r") == NULL);
+    remove(PATH);
+    assert(checkpoint_load(PATH, c.config, &r) == 0);
+}
+
+/* Truncated files and ranges out of order are damaged. */
+static void test_damaged(void) {
+    SchedulerRange ranges[] = {{10, 20}, {30, 40}};
+    Checkpoint c = {{0}, 0, 100, ranges, 2, NULL, 0}, r;
+    char buf[512];
+    size_t len;
+    FILE *f;
+
+    assert(checkpoint_save(PATH, &c));
+    f = fopen(PATH, "r");
+    len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    f = fopen(PATH, "w");
+    fwrite(buf, 1, len - 12, f);
+    fclose(f);
+    assert(checkpoint_load(PATH, c.config, &r) == -1);
+
+    ranges[1] = (SchedulerRange){15, 40};
+    assert(checkpoint_save(PATH, &c));
+    assert(checkpoint_load(PATH, c.config, &r) == -1);
+    ranges[1] = (SchedulerRange){30, 101};
+    assert(checkpoint_save(PATH, &c));
+    assert(checkpoint_load(PATH, c.config, &r) == -1);
+    remove(PATH);
+}
+
+int main() {
+    test_config_hash();
+    test_round_trip();
+    test_damaged();
+    printf("Checkpoint tests passed.\n");
+    return 0;
+}
@@ -12,6 +12,8 @@ int main() {
     assert(configuration_is_compressed(cfg));
     assert(cfg->is_p2sh == 0);
     assert(configuration_get_work(cfg) == WORK_START);
+    assert(strcmp(work_to_string(WORK_START), "START") == 0);
+    assert(strcmp(work_to_string(WORK_LIST), "LIST") == 0);
     assert(configuration_get_checksum_chars(0) == CHECKSUM_CHARS);
     configuration_set_force_threads(cfg, NULL);
     assert(configuration_get_force_threads(cfg) == NULL);
@@ -45,15 +47,7 @@ int main() {
         assert(configuration_get_wif(cfg) != NULL);
 
         /* Print configuration details */
-        const char *work_str = "START";
-        switch (configuration_get_work(cfg)) {
-            case WORK_END: work_str = "END"; break;
-            case WORK_JUMP: work_str = "JUMP"; break;
-            case WORK_ROTATE: work_str = "ROTATE"; break;
-            case WORK_SEARCH: work_str = "SEARCH"; break;
-            case WORK_ALIKE: work_str = "ALIKE"; break;
-            default: break;
-        }
+        const char *work_str = work_to_string(configuration_get_work(cfg));
 
         printf("Configuration from %s:\n", path);
         printf("  Work: %s\n", work_str);
@@ -2,21 +2,321 @@
 #include "worker.h"
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-int main() {
-    Configuration *cfg = configuration_load_from_file("examples/example_ALIKE.conf");
+/* Run the solver on an example file and return the number of results.  If
+ * ``expected`` is set, the first result must be that WIF. */
+static size_t run_example(const char *path, const char *expected) {
+    Configuration *cfg = configuration_load_from_file(path);
     assert(cfg != NULL);
 
     Worker *w = worker_create(cfg);
     assert(w != NULL);
 
     worker_run(w);
+    size_t count = worker_results_count(w);
+    if (expected) {
+        assert(count > 0);
+        assert(strcmp(w->results[0], expected) == 0);
+    }
 
-    /* Ensure at least one result was produced */
-    assert(worker_results_count(w) > 0);
+    worker_free(w);
+    configuration_free(cfg);
+    return count;
+}
+
+/* SEARCH without hints; the single result must be ``expected``. */
+static void run_search(const char *address, const char *wif, const char *expected) {
+    Configuration *cfg = configuration_create(address, wif, "", WORK_SEARCH, NULL);
+    Worker *w = worker_create(cfg);
+    assert(cfg && w);
+    worker_run(w);
+    assert(worker_results_count(w) == 1 && strcmp(w->results[0], expected) == 0);
+    worker_free(w);
+    configuration_free(cfg);
+}
+
+/* The same, with the public keys derived and hashed on key stage threads
+ * fed by ``threads`` solver threads. */
+static void run_pipelined(const char *path, const char *expected, int threads, int key_threads) {
+    Configuration *cfg = configuration_load_from_file(path);
+    assert(cfg);
+    cfg->forced_threads = threads;
+    configuration_set_force_threads(cfg, &cfg->forced_threads);
+    configuration_set_key_threads(cfg, key_threads);
+    Worker *w = worker_create(cfg);
+    assert(w);
+    worker_run(w);
+    assert(worker_results_count(w) == 1 && strcmp(w->results[0], expected) == 0);
+    worker_free(w);
+    configuration_free(cfg);
+}
+
+#define CHECKPOINT_FILE "/tmp/wifcrack_test_main.checkpoint"
+#define METRICS_FILE "/tmp/wifcrack_test_main.prom"
 
+/* Value of a sample of the metrics file. */
+static double metric(const char *name) {
+    FILE *f = fopen(METRICS_FILE, "r");
+    char line[256];
+    size_t len = strlen(name);
+    double v = -1;
+    assert(f);
+    while (fgets(line, sizeof(line), f))
+        if (strncmp(line, name, len) == 0 && line[len] == ' ')
+            v = atof(line + len + 1);
+    fclose(f);
+    return v;
+}
+
+/* Resume ROTATE at depth 2 from a checkpoint that leaves ``count`` ranges
+ * to do; the solution is in the ranks [350892, 354141) of that depth (the
+ * 109th pair of positions).  Returns the number of results. */
+static size_t resume_rotate(const SchedulerRange *ranges, size_t count) {
+    Configuration *cfg = configuration_load_from_file("examples/example_ROTATE.conf2");
+    Checkpoint c = {{0}, 2, 4308174, (SchedulerRange *)ranges, count, NULL, 0};
+    size_t found;
+    assert(cfg);
+    checkpoint_config_hash(cfg, c.config);
+    assert(checkpoint_save(CHECKPOINT_FILE, &c));
+    configuration_set_checkpoint(cfg, CHECKPOINT_FILE, CHECKPOINT_PERIOD);
+    configuration_set_progress(cfg, 1, METRICS_FILE, 1);
+
+    Worker *w = worker_create(cfg);
+    assert(w);
+    worker_run(w);
+    found = worker_results_count(w);
+    /* a finished job drops its checkpoint */
+    assert(fopen(CHECKPOINT_FILE, "r") == NULL);
+    /* the metrics count the ranges of this run, the progress the earlier
+     * ones too */
+    if (!found) {
+        uint64_t left = 0;
+        for (size_t i = 0; i < count; ++i)
+            left += ranges[i].end - ranges[i].begin;
+        assert(metric("wifcrack_candidates_total") == (double)left);
+        assert(metric("wifcrack_keyspace_done") == 4308174);
+        assert(metric("wifcrack_progress_ratio") == 1);
+    }
+    assert(metric("wifcrack_results_total") == (double)found);
+    remove(METRICS_FILE);
+    worker_free(w);
+    configuration_free(cfg);
+    return found;
+}
+
+/* --max-runtime stops a long job and leaves a checkpoint of it. */
+static void test_max_runtime(void) {
+    Configuration *cfg = configuration_load_from_file("examples/example_ROTATE.conf2");
+    Checkpoint c;
+    unsigned char hash[32];
+    assert(cfg);
+    free(cfg->wif_status);
+    cfg->wif_status = strdup("4");
+    free(cfg->wif);
+    cfg->wif = strdup("L5EzftvrYaSudioZVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWzz");
+    configuration_set_checkpoint(cfg, CHECKPOINT_FILE, CHECKPOINT_PERIOD);
+    configuration_set_max_runtime(cfg, 1);
+
+    Worker *w = worker_create(cfg);
+    assert(w);
+    worker_run(w);
+    assert(w->interrupted && worker_results_count(w) == 0);
+    checkpoint_config_hash(cfg, hash);
+    assert(checkpoint_load(CHECKPOINT_FILE, hash, &c) == 1);
+    assert(c.stage >= 1 && c.range_count > 0);
+    checkpoint_clear(&c);
+    remove(CHECKPOINT_FILE);
     worker_free(w);
     configuration_free(cfg);
+}
+
+#define RESULTS_FILE "/tmp/wifcrack_test_main.jsonl"
+
+/* A hit is streamed with the address of the target's type. */
+static void test_results(const char *path, const char *address) {
+    Configuration *cfg = configuration_load_from_file(path);
+    char line[512], expected[256];
+    FILE *f;
+    assert(cfg);
+    remove(RESULTS_FILE);
+    configuration_set_results(cfg, RESULTS_FILE, SINK_SYNC_EVERY);
+    Worker *w = worker_create(cfg);
+    assert(w);
+    worker_run(w);
+    assert(worker_results_count(w) == 1 && w->sink == NULL);
+    f = fopen(RESULTS_FILE, "r");
+    assert(f && fgets(line, sizeof(line), f) && !fgets(expected, sizeof(expected), f));
+    fclose(f);
+    snprintf(expected, sizeof(expected),
+             "{\"wif\":\"%s\",\"address\":\"%s\",\"key\":\"%s\",\"mode\":\"END\",\"time\":\"",
+             w->results[0], address,
+             "ef235aacf90d9f4aadd8c92e4b2562e1d9eb97f0df9ba3b508258739cb013db2");
+    assert(strncmp(line, expected, strlen(expected)) == 0);
+    remove(RESULTS_FILE);
+    worker_free(w);
+    configuration_free(cfg);
+}
+
+#define LIST_DIR "/tmp/wifcrack_test_main"
+
+/* Run LIST on the lines ``head``, ``junk`` lines that are no WIF, then
+ * ``tail``, against the addresses ``targets``; returns the results.  With
+ * ``stream`` the lines come on standard input. */
+static size_t run_list_from(const char *targets, const char *head, int junk, const char *tail,
+                            int stream, size_t *found) {
+    FILE *f;
+    size_t count;
+    assert(system("mkdir -p " LIST_DIR) != -1);
+    f = fopen(LIST_DIR "/targets.txt", "w");
+    assert(f);
+    fputs(targets, f);
+    fclose(f);
+    f = fopen(LIST_DIR "/list.txt", "w");
+    assert(f);
+    fputs(head, f);
+    for (int i = 0; i < junk; ++i)
+        fprintf(f, "junk%d\n", i);
+    fputs(tail, f);
+    fclose(f);
+    f = fopen(LIST_DIR "/list.conf", "w");
+    assert(f);
+    fprintf(f, "LIST\n%s\n" LIST_DIR "/targets.txt\n", stream ? "-" : LIST_DIR "/list.txt");
+    fclose(f);
+    if (stream)
+        assert(freopen(LIST_DIR "/list.txt", "r", stdin));
+
+    Configuration *cfg = configuration_load_from_file(LIST_DIR "/list.conf");
+    assert(cfg);
+    Worker *w = worker_create(cfg);
+    assert(w);
+    worker_run(w);
+    count = worker_results_count(w);
+    *found = worker_targets_found(w);
+    worker_free(w);
+    configuration_free(cfg);
+    assert(system("rm -rf " LIST_DIR) != -1);
+    return count;
+}
+
+static size_t run_list(const char *targets, const char *head, int junk, const char *tail,
+                       size_t *found) {
+    return run_list_from(targets, head, junk, tail, 0, found);
+}
+
+static void test_list(void) {
+    const char *a = "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6\n";
+    const char *one = "KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWn\n";
+    const char *zero = "KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73Nd2Mcv1\n";
+    char head[256], *overlong;
+    size_t found, n = 16 << 20; /* a chunk of standard input */
+
+    /* LIST stops once every target has a key, not after as many hits: a
+     * key listed twice is one result, and the other target's key after it
+     * is still found */
+    snprintf(head, sizeof(head), "%s%s", a, a);
+    assert(run_list("1EUXSxuUVy2PC5enGXR1a3yxbEjNWMHuem\n1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH\n",
+                    head, 20000, one, &found) == 2 && found == 2);
+
+    /* key 0 has no public key; the hit in its batch is found all the same */
+    snprintf(head, sizeof(head), "%s%s", zero, a);
+    assert(run_list("1EUXSxuUVy2PC5enGXR1a3yxbEjNWMHuem\n", head, 0, "", &found) == 1 && found == 1);
+
+    /* n + 1 is no private key, though it would multiply to the point of 1 */
+    assert(run_list("1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH\n",
+                    "L5oLkpV3aqBjhki6LmvChTCV6odsp4SXM6FfU2Gppt5kGLN5THFW\n", 0, "", &found) == 0);
+
+    /* on standard input, a line longer than a chunk is dropped whole: the
+     * WIF at its end is no candidate, the line after it is */
+    overlong = malloc(n + strlen(a) + 1);
+    assert(overlong);
+    memset(overlong, 'x', n);
+    strcpy(overlong + n, a);
+    assert(run_list_from("1EUXSxuUVy2PC5enGXR1a3yxbEjNWMHuem\n1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH\n",
+                         overlong, 3, one, 1, &found) == 1 && found == 1);
+    assert(run_list_from("1EUXSxuUVy2PC5enGXR1a3yxbEjNWMHuem\n", a, 3, "", 1, &found) == 1);
+    free(overlong);
+}
+
+/* Exactly one of the shards of SEARCH holds the key. */
+static void test_shards(int count) {
+    size_t found = 0;
+    for (int i = 0; i < count; ++i) {
+        Configuration *cfg = configuration_load_from_file("examples/example_SEARCH.conf");
+        assert(cfg);
+        configuration_set_shard(cfg, i, count, NULL);
+        Worker *w = worker_create(cfg);
+        assert(w);
+        worker_run(w);
+        found += worker_results_count(w);
+        worker_free(w);
+        configuration_free(cfg);
+    }
+    assert(found == 1);
+}
+
+int main() {
+    /* Ensure at least one result was produced */
+    assert(run_example("examples/example_ALIKE.conf", NULL) > 0);
+
+    /* END derives the checksum: 8 and 10 missing characters */
+    run_example("examples/example_END.conf2", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+    run_example("examples/example_END.conf3", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+
+    /* the same point gives the nested and native segwit addresses */
+    run_example("examples/example_END_p2sh.conf", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+    run_example("examples/example_END_segwit.conf", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+
+    /* the key is checked against every address of a target file */
+    run_example("examples/example_END_targets.conf", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+
+    /* weighted hints: the likeliest layer holds the key */
+    run_example("examples/example_SEARCH_weighted.conf", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+
+    /* unknown checksum characters are derived; the real value can carry
+     * into the next key, compressed and uncompressed */
+    run_example("examples/example_SEARCH_checksum.conf", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+    run_search("1DxEZPXWtmWUwgAaYgqMW499hNxvuNYyac", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMKW______",
+               "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMKWxSCGR6");
+    run_search("1ByzWyUaJUStdaSRriAEvbfihZSnEQ2Wke", "5Kdc3UAwGmHHuj6fQD1LDmKR6J3SwYyFWyHgxKAZ2cKRz______",
+               "5Kdc3UAwGmHHuj6fQD1LDmKR6J3SwYyFWyHgxKAZ2cKRzn5UqqV");
+
+    /* hits are streamed to the results file as they are found */
+    test_results("examples/example_END_p2sh.conf", "32GRznfKnKKcGdWVuTDJpXHz91tTNYtv7U");
+    test_results("examples/example_END_segwit.conf", "bc1qj08ys4ct2hzzc2hcz6h2hgrvlmsjynawlht528");
+
+    /* LIST: each line of a file is a candidate */
+    run_example("examples/example_LIST.conf", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+    test_list();
+
+    /* a pipeline of solver and key stage threads finds the same keys:
+     * points stepped by END, followed by the dummy checksum walk, derived
+     * from the keys of LIST */
+    run_pipelined("examples/example_END.conf3", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6", 4, 2);
+    run_pipelined("examples/example_SEARCH_checksum.conf", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6", 3, 1);
+    run_pipelined("examples/example_LIST.conf", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6", 2, 2);
+
+#ifndef WIFCRACK_OPENSSL_EC
+    /* scalar multiplications through the generator table file derive the
+     * same keys */
+    assert(ec_gen_table_open("/tmp/wifcrack_test_main.table"));
+    run_example("examples/example_SEARCH_checksum.conf", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+    run_example("examples/example_LIST.conf", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+    ec_gen_table_close();
+    remove("/tmp/wifcrack_test_main.table");
+#endif
+
+    /* ROTATE at depth 2 */
+    run_example("examples/example_ROTATE.conf2", "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6");
+
+    /* a checkpoint resumes exactly the ranges it left */
+    assert(resume_rotate((SchedulerRange[]){{0, 350892}, {354141, 4308174}}, 2) == 0);
+    assert(resume_rotate((SchedulerRange[]){{350892, 354141}}, 1) == 1);
+    test_max_runtime();
+
+    test_shards(3);
+    test_shards(16);
 
     printf("Main integration test passed.\n");
     return 0;
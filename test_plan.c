@@ -0,0 +1,113 @@
+#include "plan.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+static const PlanStrategy *strategy(const Plan *plan, WORK work) {
+    for (int i = 0; i < plan->count; ++i)
+        if (plan->strategies[i].work == work)
+            return &plan->strategies[i];
+    return NULL;
+}
+
+/* Four unknown characters at the end: all checksum characters, derived by
+ * SEARCH, one key for END, too few known characters after them for JUMP. */
+static void test_end_of_wif(void) {
+    Configuration *cfg = configuration_create("1EUXSxuUVy2PC5enGXR1a3yxbEjNWMHuem",
+                                              "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8o____",
+                                              "", WORK_SEARCH, NULL);
+    Configuration *end;
+    Plan plan;
+    assert(plan_create(cfg, 0, &plan));
+    assert(plan.unknown == 4 && plan.count == 3 && plan.best == -1);
+    assert(strategy(&plan, WORK_SEARCH)->candidates == 1);
+    assert(strategy(&plan, WORK_SEARCH)->survivors < 0);
+    assert(strategy(&plan, WORK_SEARCH)->reason == NULL);
+    assert(strategy(&plan, WORK_JUMP)->reason != NULL);
+    assert(strategy(&plan, WORK_END)->candidates == 1);
+
+    end = plan_configuration(cfg, WORK_END);
+    assert(end && configuration_get_work(end) == WORK_END);
+    assert(strcmp(configuration_get_wif(end), "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8o") == 0);
+    assert(configuration_is_compressed(end));
+    assert(plan_configuration(cfg, WORK_JUMP) == NULL);
+    configuration_free(end);
+
+    /* a short run of each: SEARCH and END both check a single key */
+    assert(plan_create(cfg, 1, &plan));
+    assert(plan.best >= 0 && plan.strategies[plan.best].work != WORK_JUMP);
+    assert(strategy(&plan, WORK_SEARCH)->rate > 0);
+    /* and find it; the key is kept once */
+    assert(plan.found_count == 1);
+    assert(strcmp(plan.found[0], "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6") == 0);
+    plan_print(stdout, &plan);
+    configuration_free(cfg);
+}
+
+/* One block of unknowns with enough known characters after it. */
+static void test_jump(void) {
+    Configuration *cfg = configuration_load_from_file("examples/example_JUMP.conf");
+    Configuration *search;
+    Plan plan;
+    assert(cfg && plan_create(cfg, 0, &plan));
+    assert(strategy(&plan, WORK_SEARCH)->candidates == 656356768);
+    assert(strategy(&plan, WORK_JUMP)->reason == NULL);
+    assert(strategy(&plan, WORK_JUMP)->candidates < 656356768 / 64);
+    assert(strategy(&plan, WORK_END)->reason != NULL);
+
+    search = plan_configuration(cfg, WORK_SEARCH);
+    assert(search && configuration_get_work(search) == WORK_SEARCH);
+    assert(strcmp(configuration_get_wif(search), configuration_get_wif(cfg)) == 0);
+    assert(strcmp(configuration_get_wif_status(search), "") == 0);
+    configuration_free(search);
+    configuration_free(cfg);
+}
+
+/* The hint sets of SEARCH carry over. */
+static void test_hints(void) {
+    Configuration *cfg = configuration_load_from_file("examples/example_SEARCH.conf");
+    Plan plan;
+    assert(cfg && plan_create(cfg, 0, &plan));
+    assert(plan.unknown == 5);
+    assert(strategy(&plan, WORK_SEARCH)->candidates == 6ULL * 18 * 58 * 23 * 58);
+    assert(strategy(&plan, WORK_SEARCH)->survivors > 0);
+    configuration_free(cfg);
+
+    /* the unknown checksum characters are not counted */
+    cfg = configuration_load_from_file("examples/example_SEARCH_checksum.conf");
+    assert(cfg && plan_create(cfg, 0, &plan));
+    assert(plan.unknown == 3);
+    assert(strategy(&plan, WORK_SEARCH)->candidates == 6);
+    configuration_free(cfg);
+}
+
+/* ROTATE is only sized: depths 1 and 2 of ROTATE.conf2. */
+static void test_rotate(void) {
+    Configuration *cfg = configuration_load_from_file("examples/example_ROTATE.conf2");
+    Plan plan;
+    assert(cfg && plan_create(cfg, 0, &plan));
+    assert(plan.count == 1 && plan.strategies[0].work == WORK_ROTATE);
+    assert(plan.strategies[0].candidates == 2964 + 4308174);
+    configuration_free(cfg);
+}
+
+/* LIST: the bytes of the candidate file. */
+static void test_list(void) {
+    Configuration *cfg = configuration_load_from_file("examples/example_LIST.conf");
+    Plan plan;
+    assert(cfg && plan_create(cfg, 0, &plan));
+    assert(plan.count == 1 && plan.strategies[0].work == WORK_LIST);
+    assert(plan.strategies[0].reason == NULL && plan.strategies[0].candidates > 1000 * 52);
+    configuration_free(cfg);
+}
+
+int main(void) {
+    test_end_of_wif();
+    test_jump();
+    test_hints();
+    test_rotate();
+    test_list();
+    printf("Plan tests passed.\n");
+    return 0;
+}
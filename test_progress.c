@@ -0,0 +1,92 @@
+#include "progress.h"
+
+#include <assert.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATH "/tmp/wifcrack_test.prom"
+
+static void test_duration(void) {
+    char buf[32];
+    progress_format_duration(0, buf, sizeof(buf));
+    assert(strcmp(buf, "0s") == 0);
+    progress_format_duration(59.6, buf, sizeof(buf));
+    assert(strcmp(buf, "1m00s") == 0);
+    progress_format_duration(3 * 3600 + 4, buf, sizeof(buf));
+    assert(strcmp(buf, "3h00m04s") == 0);
+    progress_format_duration(2 * 86400 + 3600 + 120 + 3, buf, sizeof(buf));
+    assert(strcmp(buf, "2d01h02m03s") == 0);
+    progress_format_duration(-1, buf, sizeof(buf));
+    assert(strcmp(buf, "?") == 0);
+}
+
+static void test_eta(void) {
+    ProgressReport r = {{0, 0, 0, 0}, 250, 1000, 1, 4, 10.0, 25.0};
+    assert(progress_eta(&r) == 30.0);
+    r.rate = 0;
+    assert(progress_eta(&r) == -1);
+    r.done = r.total;
+    assert(progress_eta(&r) == 0);
+}
+
+/* Value of a sample in a Prometheus text file, or -2 if missing. */
+static double sample(const char *path, const char *name) {
+    FILE *f = fopen(path, "r");
+    char line[256];
+    size_t len = strlen(name);
+    double v = -2;
+    assert(f);
+    while (fgets(line, sizeof(line), f))
+        if (strncmp(line, name, len) == 0 && line[len] == ' ')
+            v = atof(line + len + 1);
+    fclose(f);
+    return v;
+}
+
+static void test_metrics(void) {
+    ProgressReport r = {{123456789012ULL, 29, 29, 1}, 500, 2000, 2, 8, 5.0, 100.0};
+    assert(progress_write_metrics(PATH, &r));
+    assert(sample(PATH, "wifcrack_candidates_total") == 123456789012.0);
+    assert(sample(PATH, "wifcrack_checksum_survivors_total") == 29);
+    assert(sample(PATH, "wifcrack_ec_evaluations_total") == 29);
+    assert(sample(PATH, "wifcrack_results_total") == 1);
+    assert(sample(PATH, "wifcrack_stage") == 2);
+    assert(sample(PATH, "wifcrack_keyspace_candidates") == 2000);
+    assert(sample(PATH, "wifcrack_progress_ratio") == 0.25);
+    assert(sample(PATH, "wifcrack_eta_seconds") == 15);
+    assert(sample(PATH, "wifcrack_threads") == 8);
+    assert(sample(PATH, "wifcrack_last_update_timestamp_seconds") > 0);
+    remove(PATH);
+}
+
+/* Counters written by one thread add up in the reader. */
+static void test_sum(void) {
+    ProgressCounters a = {0, 0, 0, 0}, b = {0, 0, 0, 0}, total = {0, 0, 0, 0};
+    progress_add(&a.tried, 1000);
+    progress_add(&a.tried, 24);
+    progress_add(&b.survivors, 3);
+    progress_sum(&total, &a);
+    progress_sum(&total, &b);
+    assert(total.tried == 1024 && total.survivors == 3 && total.evaluated == 0);
+}
+
+static void test_signal(void) {
+    progress_catch_signal();
+    assert(!progress_requested());
+    raise(SIGUSR1);
+    assert(progress_requested());
+    assert(!progress_requested());
+    progress_restore_signal();
+}
+
+int main(void) {
+    test_duration();
+    test_eta();
+    test_metrics();
+    test_sum();
+    test_signal();
+    printf("Progress tests passed.\n");
+    return 0;
+}
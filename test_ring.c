@@ -0,0 +1,57 @@
+#include "ring.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#define ITEMS 1000000
+
+static SpscRing ring;
+
+static void *produce(void *arg) {
+    (void)arg;
+    for (size_t i = 1; i <= ITEMS; ++i)
+        while (!ring_push(&ring, (void *)i))
+            sched_yield();
+    return NULL;
+}
+
+/* Every item arrives once, in order, whatever the interleaving. */
+static void test_threads(void) {
+    pthread_t t;
+    size_t next = 1;
+    assert(pthread_create(&t, NULL, produce, NULL) == 0);
+    while (next <= ITEMS) {
+        void *p = ring_pop(&ring);
+        if (!p) {
+            sched_yield();
+            continue;
+        }
+        assert((size_t)p == next);
+        next++;
+    }
+    pthread_join(t, NULL);
+    assert(ring_pop(&ring) == NULL);
+}
+
+static void test_bounds(void) {
+    SpscRing r = {{0}, 0, 0};
+    int items[RING_CAPACITY + 1];
+    assert(ring_pop(&r) == NULL);
+    for (int i = 0; i < RING_CAPACITY; ++i)
+        assert(ring_push(&r, &items[i]));
+    assert(!ring_push(&r, &items[RING_CAPACITY]));
+    assert(ring_pop(&r) == &items[0]);
+    assert(ring_push(&r, &items[RING_CAPACITY]));
+    for (int i = 1; i <= RING_CAPACITY; ++i)
+        assert(ring_pop(&r) == &items[i]);
+    assert(ring_pop(&r) == NULL);
+}
+
+int main(void) {
+    test_bounds();
+    test_threads();
+    printf("Ring tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "scheduler.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    _Atomic unsigned char *visits;
+    _Atomic uint64_t processed;
+    uint64_t stop_at;
+    int threads;
+    int bad_thread;
+} Coverage;
+
+static void count_range(Scheduler *s, int thread, uint64_t begin, uint64_t end, void *arg) {
+    Coverage *c = arg;
+    if (thread < 0 || thread >= c->threads)
+        c->bad_thread = 1;
+    for (uint64_t r = begin; r < end; ++r) {
+        if (c->stop_at && r == c->stop_at)
+            scheduler_stop(s);
+        atomic_fetch_add(&c->visits[r], 1);
+    }
+    atomic_fetch_add(&c->processed, end - begin);
+}
+
+/* Every rank is handed out exactly once, whatever the thread count. */
+static void test_coverage(uint64_t total, int threads) {
+    Coverage c = {0};
+    c.visits = calloc(total, 1);
+    c.threads = threads;
+    assert(c.visits);
+    assert(scheduler_run(total, threads, count_range, &c));
+    assert(!c.bad_thread);
+    assert(atomic_load(&c.processed) == total);
+    for (uint64_t r = 0; r < total; ++r)
+        assert(c.visits[r] == 1);
+    free(c.visits);
+}
+
+/* A stop request cancels the ranges that were not handed out yet. */
+static void test_stop(void) {
+    const uint64_t total = 1 << 24;
+    Coverage c = {0};
+    c.visits = calloc(total, 1);
+    c.threads = 4;
+    c.stop_at = 1000;
+    assert(c.visits);
+    assert(scheduler_run(total, c.threads, count_range, &c));
+    assert(c.visits[c.stop_at] == 1);
+    assert(atomic_load(&c.processed) < total);
+    free(c.visits);
+}
+
+/* The monitor gets the same argument as the ranges, hence the embedding. */
+typedef struct {
+    Coverage c;
+    uint64_t total;
+    SchedulerRange *left;
+    size_t left_count;
+    uint64_t first;
+} Snapshot;
+
+/* Pause once the run is under way, check that the remaining ranges are
+ * exactly the ranks not visited yet, and stop. */
+static void snapshot_monitor(Scheduler *s, void *arg) {
+    Snapshot *snap = arg;
+    size_t k = 0;
+    while (atomic_load(&snap->c.processed) < snap->total / 4)
+        if (!scheduler_sleep(s, 1))
+            return;
+    scheduler_pause(s);
+    snap->left = scheduler_remaining(s, &snap->left_count);
+    /* the lowest rank left is the first of those ranges: with four threads
+     * stealing from each other, ranks above it are done already */
+    assert(scheduler_first_remaining(s, &snap->first));
+    assert(snap->left_count > 0 && snap->first == snap->left[0].begin);
+    for (uint64_t r = 0; r < snap->first; ++r)
+        assert(snap->c.visits[r] == 1);
+    for (uint64_t r = 0; r < snap->total; ++r) {
+        int left;
+        while (k < snap->left_count && snap->left[k].end <= r)
+            ++k;
+        left = k < snap->left_count && snap->left[k].begin <= r;
+        assert(snap->c.visits[r] == !left);
+    }
+    scheduler_stop(s);
+    scheduler_resume(s);
+    while (scheduler_sleep(s, 10))
+        ;
+}
+
+/* A run resumed from the remaining ranges of a paused one covers the rest
+ * of the keyspace, and nothing twice. */
+static void test_resume(void) {
+    const uint64_t total = 1 << 24;
+    Snapshot snap = {{0}, total, NULL, 0, 0};
+    snap.c.visits = calloc(total, 1);
+    snap.c.threads = 4;
+    assert(snap.c.visits);
+    assert(scheduler_run_ranges(&(SchedulerRange){0, total}, 1, snap.c.threads, count_range,
+                                snapshot_monitor, &snap));
+    assert(snap.left && snap.left_count > 0);
+    assert(scheduler_run_ranges(snap.left, snap.left_count, 3, count_range, NULL, &snap.c));
+    for (uint64_t r = 0; r < total; ++r)
+        assert(snap.c.visits[r] == 1);
+    free(snap.left);
+    free(snap.c.visits);
+}
+
+/* Pause once the run is under way, keep the lowest rank left and stop. */
+static void first_monitor(Scheduler *s, void *arg) {
+    Snapshot *snap = arg;
+    while (atomic_load(&snap->c.processed) < snap->total / 3)
+        if (!scheduler_sleep(s, 1))
+            return;
+    scheduler_pause(s);
+    assert(scheduler_first_remaining(s, &snap->first));
+    scheduler_stop(s);
+    scheduler_resume(s);
+    while (scheduler_sleep(s, 10))
+        ;
+}
+
+/* A run restarted from the lowest rank left alone, as JUMP restarts from
+ * the WIF of its progress lines, covers every rank the first run missed. */
+static void test_resume_from_first(void) {
+    const uint64_t total = 1 << 24;
+    Snapshot snap = {{0}, total, NULL, 0, 0};
+    snap.c.visits = calloc(total, 1);
+    snap.c.threads = 4;
+    assert(snap.c.visits);
+    assert(scheduler_run_ranges(&(SchedulerRange){0, total}, 1, snap.c.threads, count_range,
+                                first_monitor, &snap));
+    assert(snap.first < total);
+    assert(snap.c.visits[snap.first] == 0);
+    assert(scheduler_run_ranges(&(SchedulerRange){snap.first, total}, 1, 3, count_range, NULL,
+                                &snap.c));
+    for (uint64_t r = 0; r < total; ++r)
+        assert(snap.c.visits[r] >= 1 && (r >= snap.first || snap.c.visits[r] == 1));
+    free(snap.c.visits);
+}
+
+/* Ordered ranges cover the same ranks in increasing order, in blocks that
+ * double and are cut in one seed per thread. */
+static void test_order(void) {
+    const SchedulerRange in[] = {{100, 5000}, {9000, 1 << 20}};
+    const uint64_t total = 1 << 20;
+    Coverage c = {0};
+    SchedulerRange *out;
+    size_t count;
+
+    out = scheduler_order_ranges(in, 2, 4, &count);
+    assert(out && count > 8);
+    assert(out[0].begin == 100 && out[count - 1].end == total);
+    for (size_t i = 0; i < count; ++i) {
+        assert(out[i].begin < out[i].end);
+        assert(i == 0 || out[i - 1].end <= out[i].begin);
+        /* no seed crosses a block boundary b * (2^n - 1) */
+        for (uint64_t edge = 4 * SCHEDULER_GRAIN_MIN; edge < total; edge = 2 * edge + 4 * SCHEDULER_GRAIN_MIN)
+            assert(out[i].end <= edge || out[i].begin >= edge);
+    }
+    c.visits = calloc(total, 1);
+    c.threads = 4;
+    assert(c.visits);
+    assert(scheduler_run_ranges(out, count, 4, count_range, NULL, &c));
+    for (uint64_t r = 0; r < total; ++r)
+        assert(c.visits[r] == ((r >= 100 && r < 5000) || r >= 9000));
+    free(c.visits);
+    free(out);
+}
+
+int main() {
+    Configuration *cfg = configuration_create(NULL, "", "", WORK_SEARCH, NULL);
+    int forced = 3;
+    assert(cfg && scheduler_thread_count(cfg) >= 1);
+    configuration_set_force_threads(cfg, &forced);
+    assert(scheduler_thread_count(cfg) == 3);
+    configuration_free(cfg);
+
+    test_coverage(1, 4);
+    test_coverage(1000, 1);
+    test_coverage(1000, 7);
+    test_coverage(123457, 16);
+    test_coverage(1 << 22, 64);
+    test_stop();
+    test_resume();
+    test_resume_from_first();
+    test_order();
+
+    printf("Scheduler tests passed.\n");
+    return 0;
+}
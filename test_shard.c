@@ -0,0 +1,69 @@
+#include "shard.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The shards are contiguous and their sizes add up to the keyspace. */
+static void test_cover(uint64_t total, int count) {
+    uint64_t sum = 0, prev = 0, min = UINT64_MAX, max = 0;
+    for (int i = 0; i < count; ++i) {
+        SchedulerRange r;
+        shard_range(total, i, count, &r);
+        assert(r.begin == prev && r.begin <= r.end);
+        sum += r.end - r.begin;
+        prev = r.end;
+        if (r.end - r.begin < min)
+            min = r.end - r.begin;
+        if (r.end - r.begin > max)
+            max = r.end - r.begin;
+    }
+    assert(prev == total && sum == total);
+    assert(max - min <= 1);
+}
+
+static void test_parse(void) {
+    int index, count;
+    assert(shard_parse("1/1", &index, &count) && index == 0 && count == 1);
+    assert(shard_parse("3/8", &index, &count) && index == 2 && count == 8);
+    assert(!shard_parse("0/8", &index, &count));
+    assert(!shard_parse("9/8", &index, &count));
+    assert(!shard_parse("1/0", &index, &count));
+    assert(!shard_parse("1/", &index, &count));
+    assert(!shard_parse("1-2", &index, &count));
+    assert(!shard_parse("1/2x", &index, &count));
+}
+
+/* Merging needs every shard of the same job exactly once. */
+static void test_merge(void) {
+    const unsigned char a[32] = {1}, b[32] = {2};
+    char *results[] = {"L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6"};
+    const char *paths[] = {"/tmp/wifcrack_shard1", "/tmp/wifcrack_shard2",
+                           "/tmp/wifcrack_shard3"};
+    assert(shard_save(paths[0], a, 0, 2, 1, results, 1));
+    assert(shard_save(paths[1], a, 1, 2, 1, results, 1));
+    assert(shard_merge(paths, 2));
+    assert(!shard_merge(paths, 1));
+    assert(!shard_merge((const char *[]){paths[0], paths[0]}, 2));
+    assert(shard_save(paths[2], b, 1, 2, 1, NULL, 0));
+    assert(!shard_merge((const char *[]){paths[0], paths[2]}, 2));
+    /* a result file is replaced whole, through a temporary file */
+    assert(shard_save(paths[1], a, 1, 2, 0, NULL, 0));
+    assert(!fopen("/tmp/wifcrack_shard2.tmp", "r"));
+    assert(!shard_merge(paths, 2));
+    assert(!shard_save("/nonexistent/wifcrack_shard", a, 0, 2, 1, NULL, 0));
+    for (int i = 0; i < 3; ++i)
+        remove(paths[i]);
+}
+
+int main() {
+    uint64_t totals[] = {0, 1, 7, 1000, 4308174, 123456789012345ULL, UINT64_MAX};
+    int counts[] = {1, 2, 3, 7, 64, 1000, 999983};
+    for (size_t i = 0; i < sizeof(totals) / sizeof(totals[0]); ++i)
+        for (size_t j = 0; j < sizeof(counts) / sizeof(counts[0]); ++j)
+            test_cover(totals[i], counts[j]);
+    test_parse();
+    test_merge();
+    printf("Shard tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "sink.h"
+
+#include <assert.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RESULTS_FILE "/tmp/wifcrack_test_sink.jsonl"
+#define PRODUCERS 4
+#define RECORDS 3000 /* per producer, more than the queue holds */
+
+static ResultSink *sink;
+
+/* Every record of a producer, retried while the queue is full. */
+static void *produce(void *arg) {
+    int id = (int)(size_t)arg;
+    SinkRecord r;
+    memset(&r, 0, sizeof(r));
+    r.mode = "TEST";
+    r.key[31] = (unsigned char)id;
+    for (int i = 0; i < RECORDS; ++i) {
+        snprintf(r.wif, sizeof(r.wif), "%d-%d", id, i);
+        snprintf(r.address, sizeof(r.address), "address-%d", id);
+        while (!sink_push(sink, &r))
+            sched_yield();
+    }
+    return NULL;
+}
+
+/* Each producer's records come out once each, in the order pushed. */
+static void test_stream(int sync) {
+    pthread_t threads[PRODUCERS];
+    int next[PRODUCERS] = {0};
+    char line[512], key[65];
+    FILE *f;
+
+    remove(RESULTS_FILE);
+    sink = sink_open(RESULTS_FILE, sync);
+    assert(sink);
+    for (int i = 0; i < PRODUCERS; ++i)
+        assert(pthread_create(&threads[i], NULL, produce, (void *)(size_t)i) == 0);
+    for (int i = 0; i < PRODUCERS; ++i)
+        pthread_join(threads[i], NULL);
+    sink_close(sink);
+
+    f = fopen(RESULTS_FILE, "r");
+    assert(f);
+    while (fgets(line, sizeof(line), f)) {
+        int id, i, id2;
+        assert(sscanf(line, "{\"wif\":\"%d-%d\",\"address\":\"address-%d\",\"key\":\"%64[0-9a-f]\"",
+                      &id, &i, &id2, key) == 4);
+        assert(id == id2 && id >= 0 && id < PRODUCERS && i == next[id]++);
+        assert(strtol(key + 62, NULL, 16) == id);
+        assert(strstr(line, "\",\"mode\":\"TEST\",\"time\":\"") && strstr(line, "Z\"}\n"));
+    }
+    fclose(f);
+    for (int i = 0; i < PRODUCERS; ++i)
+        assert(next[i] == RECORDS);
+    remove(RESULTS_FILE);
+}
+
+/* Without a writer the queue fills up and further records are dropped
+ * rather than waited for. */
+static void test_full(void) {
+    ResultSink *s = calloc(1, sizeof(ResultSink));
+    SinkRecord r = {0};
+    assert(s);
+    for (uint64_t i = 0; i < SINK_CAPACITY; ++i)
+        s->cells[i].seq = i;
+    for (int i = 0; i < SINK_CAPACITY; ++i)
+        assert(sink_push(s, &r));
+    assert(!sink_push(s, &r) && !sink_push(s, &r));
+    assert(s->dropped == 2 && s->head == SINK_CAPACITY);
+    free(s);
+}
+
+static void test_parse_sync(void) {
+    int sync = 7;
+    assert(sink_parse_sync("every", &sync) && sync == SINK_SYNC_EVERY);
+    assert(sink_parse_sync("never", &sync) && sync == SINK_SYNC_NEVER);
+    assert(sink_parse_sync("30", &sync) && sync == 30);
+    assert(!sink_parse_sync("0", &sync) && !sink_parse_sync("5s", &sync));
+    assert(!sink_parse_sync("", &sync) && sync == 30);
+}
+
+int main(void) {
+    test_parse_sync();
+    test_full();
+    test_stream(SINK_SYNC_NEVER);
+    test_stream(SINK_SYNC_EVERY);
+    printf("Sink tests passed.\n");
+    return 0;
+}
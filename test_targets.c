@@ -0,0 +1,95 @@
+#include "bitcoin.h"
+#include "targets.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void random_hash(unsigned char hash[20]) {
+    for (int i = 0; i < 20; ++i)
+        hash[i] = (unsigned char)(rand() >> 7);
+}
+
+/* Every added hash is found, everything else is not, whatever the size. */
+static void test_membership(size_t n) {
+    TargetSet *s = target_set_create();
+    unsigned char (*added)[20] = malloc((n ? n : 1) * 20);
+    unsigned char hash[20];
+    assert(s && added);
+
+    for (size_t i = 0; i < n; ++i) {
+        random_hash(added[i]);
+        assert(target_set_add(s, added[i]));
+    }
+    /* duplicates collapse */
+    for (size_t i = 0; i < n; i += 7)
+        assert(target_set_add(s, added[i]));
+    assert(target_set_finish(s));
+    assert(s->count == n);
+
+    for (size_t i = 0; i < n; ++i) {
+        long at = target_set_find(s, added[i]);
+        assert(at >= 0 && memcmp(s->hashes[at], added[i], 20) == 0);
+    }
+    for (int i = 0; i < 100000; ++i) {
+        int known = 0;
+        random_hash(hash);
+        for (size_t k = 0; k < n && n < 1000; ++k)
+            known |= memcmp(added[k], hash, 20) == 0;
+        assert(target_set_contains(s, hash) == known);
+    }
+    /* neighbours of a target differ in the bytes the index does not use */
+    if (n > 0) {
+        memcpy(hash, added[0], 20);
+        hash[19] ^= 1;
+        assert(!target_set_contains(s, hash));
+    }
+    free(added);
+    target_set_free(s);
+}
+
+static void test_load(void) {
+    const char *path = "test_targets.tmp";
+    FILE *f = fopen(path, "w");
+    TargetSet *s = target_set_create();
+    TargetSet *one = target_set_create();
+    assert(f && s && one);
+    fputs("# funded addresses\n"
+          "1EUXSxuUVy2PC5enGXR1a3yxbEjNWMHuem\r\n"
+          "\n"
+          "  1MVfzAvAd5VXPLj27UzNZkxuUWbdC9JmKD\n"
+          "3H1qgYqxfzqxmMT9MKAjbxyrpVZ5YtA3wX\n"
+          "bc1qj08ys4ct2hzzc2hcz6h2hgrvlmsjynawlht528\n"
+          "1EUXSxuUVy2PC5enGXR1a3yxbEjNWMHuem\n"
+          "not an address\n", f);
+    fclose(f);
+
+    assert(target_set_load(s, path));
+    assert(target_set_finish(s));
+    /* the P2WPKH address pays to the hash of the first P2PKH one */
+    assert(s->count == 3);
+    assert(s->types == (1U << ADDRESS_P2PKH | 1U << ADDRESS_P2SH | 1U << ADDRESS_P2WPKH));
+    assert(target_set_add_address(one, "1MVfzAvAd5VXPLj27UzNZkxuUWbdC9JmKD"));
+    assert(target_set_finish(one));
+    assert(one->types == 1U << ADDRESS_P2PKH);
+    assert(target_set_contains(s, one->hashes[0]));
+    remove(path);
+
+    assert(!target_set_load(s, path));
+    target_set_free(s);
+    target_set_free(one);
+}
+
+int main() {
+    srand(11);
+    test_membership(0);
+    test_membership(1);
+    test_membership(2);
+    test_membership(500);
+    test_membership(300000);
+    test_load();
+
+    printf("Target set tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "topology.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define ROOT "/tmp/wifcrack_test_topology"
+
+/* Write ``text`` to ROOT/path, making the directories on the way. */
+static void put(const char *path, const char *text) {
+    char full[512];
+    FILE *f;
+    snprintf(full, sizeof(full), "%s/%s", ROOT, path);
+    for (char *p = full + 1; *p; ++p) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(full, 0755);
+            *p = '/';
+        }
+    }
+    f = fopen(full, "w");
+    assert(f);
+    fputs(text, f);
+    fclose(f);
+}
+
+/* Two sockets of four cores with two threads each: CPU i and i + 8 are
+ * siblings, node 0 has cores 0-3. */
+static void make_host(void) {
+    char path[128], list[32];
+    assert(system("rm -rf " ROOT) != -1);
+    put("sys/devices/system/cpu/online", "0-15\n");
+    put("sys/devices/system/node/online", "0-1\n");
+    put("sys/devices/system/node/node0/cpulist", "0-3,8-11\n");
+    put("sys/devices/system/node/node1/cpulist", "4-7,12-15\n");
+    for (int i = 0; i < 16; ++i) {
+        snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", i);
+        snprintf(list, sizeof(list), "%d,%d\n", i % 8, i % 8 + 8);
+        put(path, list);
+    }
+}
+
+static void test_host(void) {
+    const int order[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    Topology t;
+    make_host();
+    assert(topology_read(&t, ROOT, NULL));
+    assert(t.cpus == 16 && t.cores == 8 && t.nodes == 2);
+    assert(t.quota == 0 && t.workers == 8);
+    assert(memcmp(t.order, order, sizeof(order)) == 0);
+    assert(topology_cpu(&t, 15) == 15 && topology_cpu(&t, 16) == -1);
+}
+
+/* Without CPU 0 its sibling stands for the core; every node is still there,
+ * first cores, then siblings. */
+static void test_allowed(void) {
+    const int order[15] = {1, 2, 3, 8, 4, 5, 6, 7, 9, 10, 11, 12, 13, 14, 15};
+    unsigned char allowed[TOPOLOGY_MAX_CPUS] = {0};
+    Topology t;
+    make_host();
+    for (int i = 1; i < 16; ++i)
+        allowed[i] = 1;
+    assert(topology_read(&t, ROOT, allowed));
+    assert(t.cpus == 15 && t.cores == 8 && t.nodes == 2);
+    assert(memcmp(t.order, order, sizeof(order)) == 0);
+
+    /* only node 1: one node, and its cores first */
+    memset(allowed, 0, sizeof(allowed));
+    allowed[5] = allowed[13] = allowed[6] = 1;
+    assert(topology_read(&t, ROOT, allowed));
+    assert(t.cpus == 3 && t.cores == 2 && t.nodes == 1);
+    assert(t.order[0] == 5 && t.order[1] == 6 && t.order[2] == 13);
+}
+
+/* The tightest quota on the way up from the process' cgroup counts. */
+static void test_quota(void) {
+    Topology t;
+    make_host();
+    put("proc/self/cgroup", "0::/job/step\n");
+    put("sys/fs/cgroup/cpu.max", "max 100000\n");
+    put("sys/fs/cgroup/job/cpu.max", "600000 100000\n");
+    put("sys/fs/cgroup/job/step/cpu.max", "max 100000\n");
+    assert(topology_read(&t, ROOT, NULL));
+    assert(t.quota == 6 && t.workers == 6);
+
+    make_host();
+    put("proc/self/cgroup", "12:pids:/docker/x\n4:cpu,cpuacct:/docker/x\n");
+    put("sys/fs/cgroup/cpu,cpuacct/docker/x/cpu.cfs_quota_us", "150000\n");
+    put("sys/fs/cgroup/cpu,cpuacct/docker/x/cpu.cfs_period_us", "100000\n");
+    put("sys/fs/cgroup/cpu,cpuacct/cpu.cfs_quota_us", "-1\n");
+    assert(topology_read(&t, ROOT, NULL));
+    assert(t.quota == 1.5 && t.workers == 1);
+
+    /* a quota above the cores leaves one thread per core */
+    put("sys/fs/cgroup/cpu,cpuacct/docker/x/cpu.cfs_quota_us", "2000000\n");
+    assert(topology_read(&t, ROOT, NULL));
+    assert(t.quota == 20 && t.workers == 8);
+}
+
+/* Without NUMA or SMT files every CPU is a core of node 0. */
+static void test_flat(void) {
+    Topology t;
+    assert(system("rm -rf " ROOT) != -1);
+    assert(!topology_read(&t, ROOT, NULL));
+    put("sys/devices/system/cpu/online", "0-3\n");
+    assert(topology_read(&t, ROOT, NULL));
+    assert(t.cpus == 4 && t.cores == 4 && t.nodes == 1 && t.workers == 4);
+    assert(t.order[3] == 3);
+}
+
+/* Pinning moves the thread to the CPU and unpinning gives the old mask
+ * back. */
+static void test_pin(void) {
+    const Topology *t = topology_get();
+    TopologyMask old, now;
+    assert(t->workers >= 1 && t->cpus >= t->cores);
+    assert(!topology_pin(-1, &old));
+    if (topology_cpu(t, 0) < 0)
+        return;
+    assert(topology_pin(topology_cpu(t, 0), &old));
+    assert(topology_pin(topology_cpu(t, 0), &now));
+    topology_unpin(&old);
+    assert(topology_pin(topology_cpu(t, 0), &now));
+    assert(memcmp(&old, &now, sizeof(old)) == 0);
+    topology_unpin(&old);
+}
+
+int main(void) {
+    test_host();
+    test_allowed();
+    test_quota();
+    test_flat();
+    test_pin();
+    assert(system("rm -rf " ROOT) != -1);
+    printf("Topology tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "configuration.h"
+#include "weighted.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIF "L5EZftvrYaSudiozVRzTqLcHLNDoVn7H5HSfM9BAN6tMJX8oTWz6"
+
+static int state_cost(const WeightedTables *t, const WeightedState *s) {
+    int c = 0;
+    for (int k = 0; k < t->count; ++k)
+        c += t->cost[k][s->digit[k]];
+    return c;
+}
+
+static int compare(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Every rank is one candidate, each candidate comes once, the costs never
+ * go down, and stepping agrees with unranking. */
+static void check_order(const GuessPos *pos, int count, uint64_t expected) {
+    WeightedTables *t = weighted_tables_create(WIF, pos, count);
+    WeightedState s, r;
+    char **seen;
+    wif_num num;
+    int last = 0;
+
+    assert(t);
+    assert(weighted_keyspace(t) == expected);
+    seen = malloc(expected * sizeof(char *));
+    assert(seen);
+    assert(weighted_state_seek(t, &s, 0));
+    for (uint64_t i = 0; i < expected; ++i) {
+        seen[i] = malloc(t->len + 1);
+        weighted_state_wif(t, &s, seen[i]);
+        assert(wif_num_from_base58(&num, seen[i]));
+        assert(memcmp(&num, &s.num, sizeof(num)) == 0);
+        assert(s.layer == state_cost(t, &s) && s.layer >= last);
+        last = s.layer;
+
+        assert(weighted_state_seek(t, &r, i));
+        assert(memcmp(r.digit, s.digit, sizeof(int) * count) == 0);
+        assert(weighted_next(t, &s) == (i + 1 < expected));
+    }
+    assert(!weighted_state_seek(t, &r, expected));
+    qsort(seen, expected, sizeof(char *), compare);
+    for (uint64_t i = 1; i < expected; ++i)
+        assert(strcmp(seen[i - 1], seen[i]) < 0);
+    for (uint64_t i = 0; i < expected; ++i)
+        free(seen[i]);
+    free(seen);
+    weighted_tables_free(t);
+}
+
+static void test_order(void) {
+    const double w0[] = {6, 2, 1, 0.5};
+    const double w2[] = {1, 1, 100, 1, 1, 0.01};
+    GuessPos pos[] = {
+        {27, "acoe", w0},
+        {29, "nN", NULL},
+        {30, "123456", w2},
+    };
+    WeightedTables *t;
+    WeightedState s;
+    char out[64];
+
+    check_order(pos, 3, 4 * 2 * 6);
+    /* duplicates and characters outside of Base58 are dropped, an empty set
+     * is the whole alphabet */
+    check_order((GuessPos[]){{27, "aa0Ob", NULL}, {28, "", NULL}}, 2, 2 * 58);
+
+    /* the likeliest candidate comes first, the least likely last */
+    t = weighted_tables_create(WIF, pos, 3);
+    assert(t && weighted_state_seek(t, &s, 0));
+    weighted_state_wif(t, &s, out);
+    assert(out[27] == 'a' && out[30] == '3');
+    assert(weighted_state_seek(t, &s, weighted_keyspace(t) - 1));
+    weighted_state_wif(t, &s, out);
+    assert(out[27] == 'e' && out[30] == '6');
+    /* a weight ratio of 2 is WEIGHT_COST_STEPS */
+    assert(t->cost[0][0] == 0 && t->cost[0][1] == 2 * WEIGHT_COST_STEPS - 2);
+    weighted_tables_free(t);
+}
+
+static void test_parse(void) {
+    guess_entry ge = {0};
+
+    assert(configuration_parse_guess(&ge, "acoe"));
+    assert(strcmp(ge.chars, "acoe") == 0 && ge.weights == NULL);
+    free(ge.chars);
+
+    assert(configuration_parse_guess(&ge, "a:6 c:2, o e:0.5 Nn:3"));
+    assert(strcmp(ge.chars, "acoeNn") == 0 && ge.weights);
+    assert(ge.weights[0] == 6 && ge.weights[1] == 2 && ge.weights[2] == 1);
+    assert(ge.weights[3] == 0.5 && ge.weights[4] == 3 && ge.weights[5] == 3);
+    free(ge.chars);
+    free(ge.weights);
+
+    assert(!configuration_parse_guess(&ge, "a:0 b"));
+    free(ge.chars);
+    free(ge.weights);
+    assert(!configuration_parse_guess(&ge, "a:x"));
+    free(ge.chars);
+    free(ge.weights);
+}
+
+int main(void) {
+    test_order();
+    test_parse();
+    printf("Weighted tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "textfile.h"
+
+/* Sync the directory too, or the rename may not survive a crash. */
+static void sync_dir(const char *path) {
+    char dir[1024];
+    const char *slash = strrchr(path, '/');
+    int fd;
+    if (!slash) {
+        strcpy(dir, ".");
+    } else {
+        size_t n = (size_t)(slash - path);
+        if (n >= sizeof(dir))
+            return;
+        memcpy(dir, path, n ? n : 1);
+        dir[n ? n : 1] = '\0';
+    }
+    fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+FILE *textfile_create(const char *path, char *tmp, size_t size) {
+    FILE *f;
+    if (snprintf(tmp, size, "%s.tmp", path) >= (int)size) {
+        fprintf(stderr, "Error: %s: path too long\n", path);
+        return NULL;
+    }
+    f = fopen(tmp, "w");
+    if (!f)
+        perror(tmp);
+    return f;
+}
+
+int textfile_commit(FILE *f, const char *tmp, const char *path) {
+    int ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        perror(path);
+        unlink(tmp);
+        return 0;
+    }
+    sync_dir(path);
+    return 1;
+}
+
+void textfile_hex(const unsigned char *in, size_t len, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; ++i) {
+        out[2 * i] = digits[in[i] >> 4];
+        out[2 * i + 1] = digits[in[i] & 15];
+    }
+    out[2 * len] = '\0';
+}
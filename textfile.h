@@ -0,0 +1,19 @@
+#ifndef TEXTFILE_H
+#define TEXTFILE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* The small text files of a run (checkpoints, shard results) are written to
+ * ``path``.tmp, synced and renamed over ``path``, so that a crash leaves
+ * either the old file or the new one.  textfile_create() opens the
+ * temporary file and names it in ``tmp``; textfile_commit() closes it and
+ * puts it in place, or removes it on any error.  Both return 0 and print
+ * why on failure. */
+FILE *textfile_create(const char *path, char *tmp, size_t size);
+int textfile_commit(FILE *f, const char *tmp, const char *path);
+
+/* ``len`` bytes as 2 * len lowercase hex digits and a '\0'. */
+void textfile_hex(const unsigned char *in, size_t len, char *out);
+
+#endif /* TEXTFILE_H */
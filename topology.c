@@ -0,0 +1,253 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "topology.h"
+
+#define TOPOLOGY_PATH_MAX 4096
+
+/* A CPU list as in /sys, "0-3,8,10-11", into flags.  Returns the number of
+ * CPUs in it, -1 if the file cannot be read. */
+static int read_list(const char *path, unsigned char *flags) {
+    FILE *f = fopen(path, "r");
+    long a, b;
+    int n = 0, c;
+    if (!f)
+        return -1;
+    memset(flags, 0, TOPOLOGY_MAX_CPUS);
+    while (fscanf(f, "%ld", &a) == 1) {
+        b = a;
+        c = fgetc(f);
+        if (c == '-') {
+            if (fscanf(f, "%ld", &b) != 1)
+                break;
+            c = fgetc(f);
+        }
+        for (long i = a < 0 ? 0 : a; i <= b && i < TOPOLOGY_MAX_CPUS; ++i) {
+            n += !flags[i];
+            flags[i] = 1;
+        }
+        if (c != ',')
+            break;
+    }
+    fclose(f);
+    return n;
+}
+
+/* CPUs a cgroup v2 directory allows: cpu.max is "max 100000" or
+ * "<quota> <period>".  0 without a limit, -1 without the file. */
+static double quota_v2(const char *dir) {
+    char path[TOPOLOGY_PATH_MAX], max[32];
+    long period;
+    double q = 0;
+    FILE *f;
+    if (snprintf(path, sizeof(path), "%s/cpu.max", dir) >= (int)sizeof(path) ||
+        !(f = fopen(path, "r")))
+        return -1;
+    if (fscanf(f, "%31s %ld", max, &period) == 2 && strcmp(max, "max") != 0 && period > 0)
+        q = atof(max) / (double)period;
+    fclose(f);
+    return q;
+}
+
+/* The same from cgroup v1, where a quota of -1 is no limit. */
+static double quota_v1(const char *dir) {
+    char path[TOPOLOGY_PATH_MAX];
+    long quota = -1, period = 0;
+    FILE *f;
+    if (snprintf(path, sizeof(path), "%s/cpu.cfs_quota_us", dir) >= (int)sizeof(path) ||
+        !(f = fopen(path, "r")))
+        return -1;
+    if (fscanf(f, "%ld", &quota) != 1)
+        quota = -1;
+    fclose(f);
+    if (snprintf(path, sizeof(path), "%s/cpu.cfs_period_us", dir) < (int)sizeof(path) &&
+        (f = fopen(path, "r"))) {
+        if (fscanf(f, "%ld", &period) != 1)
+            period = 0;
+        fclose(f);
+    }
+    return quota > 0 && period > 0 ? (double)quota / (double)period : 0;
+}
+
+/* The tightest quota from the cgroup ``path`` of this process up to the root
+ * of the hierarchy mounted at ``base``; a parent's limit holds for all of
+ * its children.  0 if there is none. */
+static double quota_walk(const char *base, const char *path, double (*quota)(const char *)) {
+    char p[TOPOLOGY_PATH_MAX], dir[TOPOLOGY_PATH_MAX];
+    double best = 0;
+    snprintf(p, sizeof(p), "%s", path);
+    for (;;) {
+        char *slash;
+        double q;
+        q = snprintf(dir, sizeof(dir), "%s%s", base, p) < (int)sizeof(dir) ? quota(dir) : -1;
+        if (q > 0 && (best == 0 || q < best))
+            best = q;
+        if (!(slash = strrchr(p, '/')))
+            break;
+        *slash = '\0';
+    }
+    return best;
+}
+
+/* From /proc/self/cgroup, "0::/path" for v2, "4:cpu,cpuacct:/path" for v1;
+ * in a container with a cgroup namespace both are just "/". */
+static double cgroup_quota(const char *root) {
+    static const char *const v1[] = {"cpu,cpuacct", "cpu", "cpuacct,cpu"};
+    char path[TOPOLOGY_PATH_MAX], line[TOPOLOGY_PATH_MAX], base[TOPOLOGY_PATH_MAX];
+    char v2_path[TOPOLOGY_PATH_MAX] = "", v1_path[TOPOLOGY_PATH_MAX] = "";
+    double best = 0, q;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/proc/self/cgroup", root);
+    if ((f = fopen(path, "r"))) {
+        while (fgets(line, sizeof(line), f)) {
+            char *controllers = strchr(line, ':'), *cgroup, *save;
+            if (!controllers || !(cgroup = strchr(++controllers, ':')))
+                continue;
+            *cgroup++ = '\0';
+            cgroup[strcspn(cgroup, "\n")] = '\0';
+            if (strcmp(cgroup, "/") == 0)
+                cgroup[0] = '\0';
+            if (controllers[0] == '\0') {
+                snprintf(v2_path, sizeof(v2_path), "%s", cgroup);
+            } else {
+                for (char *c = strtok_r(controllers, ",", &save); c; c = strtok_r(NULL, ",", &save))
+                    if (strcmp(c, "cpu") == 0)
+                        snprintf(v1_path, sizeof(v1_path), "%s", cgroup);
+            }
+        }
+        fclose(f);
+    }
+    snprintf(base, sizeof(base), "%s/sys/fs/cgroup", root);
+    best = quota_walk(base, v2_path, quota_v2);
+    for (size_t i = 0; i < sizeof(v1) / sizeof(v1[0]); ++i) {
+        snprintf(base, sizeof(base), "%s/sys/fs/cgroup/%s", root, v1[i]);
+        q = quota_walk(base, v1_path, quota_v1);
+        if (q > 0 && (best == 0 || q < best))
+            best = q;
+    }
+    return best;
+}
+
+int topology_read(Topology *t, const char *root, const unsigned char *allowed) {
+    unsigned char online[TOPOLOGY_MAX_CPUS], list[TOPOLOGY_MAX_CPUS];
+    unsigned char seen[TOPOLOGY_MAX_CPUS] = {0};
+    int node[TOPOLOGY_MAX_CPUS], core[TOPOLOGY_MAX_CPUS];
+    char path[TOPOLOGY_PATH_MAX];
+    int n = 0;
+
+    memset(t, 0, sizeof(*t));
+    snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/online", root);
+    if (read_list(path, online) <= 0)
+        return 0;
+    for (int i = 0; i < TOPOLOGY_MAX_CPUS; ++i) {
+        if (allowed && !allowed[i])
+            online[i] = 0;
+        node[i] = 0;
+        core[i] = i;
+    }
+
+    snprintf(path, sizeof(path), "%s/sys/devices/system/node/online", root);
+    if (read_list(path, seen) > 0) {
+        for (int k = 0; k < TOPOLOGY_MAX_CPUS; ++k) {
+            if (!seen[k])
+                continue;
+            snprintf(path, sizeof(path), "%s/sys/devices/system/node/node%d/cpulist", root, k);
+            if (read_list(path, list) < 0)
+                continue;
+            for (int i = 0; i < TOPOLOGY_MAX_CPUS; ++i)
+                if (list[i])
+                    node[i] = k;
+        }
+    }
+
+    /* SMT siblings share a core, named after its lowest usable CPU */
+    memset(seen, 0, sizeof(seen));
+    for (int i = 0; i < TOPOLOGY_MAX_CPUS; ++i) {
+        if (!online[i])
+            continue;
+        t->cpus++;
+        t->nodes += !seen[node[i]];
+        seen[node[i]] = 1;
+        snprintf(path, sizeof(path),
+                 "%s/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", root, i);
+        if (read_list(path, list) > 0) {
+            for (int j = 0; j < TOPOLOGY_MAX_CPUS; ++j) {
+                if (list[j] && online[j]) {
+                    core[i] = j;
+                    break;
+                }
+            }
+        }
+        t->cores += core[i] == i;
+    }
+    if (t->cpus == 0)
+        return 0;
+
+    for (int siblings = 0; siblings < 2; ++siblings)
+        for (int k = 0; k < TOPOLOGY_MAX_CPUS; ++k)
+            for (int i = 0; seen[k] && i < TOPOLOGY_MAX_CPUS; ++i)
+                if (online[i] && node[i] == k && (core[i] != i) == siblings)
+                    t->order[n++] = i;
+
+    t->quota = cgroup_quota(root);
+    t->workers = t->cores;
+    if (t->quota > 0 && t->quota < t->workers)
+        t->workers = t->quota < 1 ? 1 : (int)t->quota;
+    return 1;
+}
+
+static Topology live;
+static pthread_once_t live_once = PTHREAD_ONCE_INIT;
+
+static void live_read(void) {
+    unsigned char allowed[TOPOLOGY_MAX_CPUS];
+    const unsigned char *mask = NULL;
+    cpu_set_t set;
+    long n;
+
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < TOPOLOGY_MAX_CPUS; ++i)
+            allowed[i] = CPU_ISSET(i, &set) != 0;
+        mask = allowed;
+    }
+    if (topology_read(&live, "", mask))
+        return;
+    /* no /sys: the CPU numbers are unknown, so nothing is pinned */
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    memset(&live, 0, sizeof(live));
+    live.cpus = n < 1 ? 1 : n > TOPOLOGY_MAX_CPUS ? TOPOLOGY_MAX_CPUS : (int)n;
+    live.cores = live.workers = live.cpus;
+    live.nodes = 1;
+    for (int i = 0; i < live.cpus; ++i)
+        live.order[i] = -1;
+}
+
+const Topology *topology_get(void) {
+    pthread_once(&live_once, live_read);
+    return &live;
+}
+
+int topology_cpu(const Topology *t, int thread) {
+    return thread >= 0 && thread < t->cpus ? t->order[thread] : -1;
+}
+
+int topology_pin(int cpu, TopologyMask *old) {
+    cpu_set_t set;
+    if (cpu < 0 || cpu >= TOPOLOGY_MAX_CPUS)
+        return 0;
+    if (old && pthread_getaffinity_np(pthread_self(), sizeof(old->bits),
+                                      (cpu_set_t *)old->bits) != 0)
+        return 0;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void topology_unpin(const TopologyMask *old) {
+    pthread_setaffinity_np(pthread_self(), sizeof(old->bits), (const cpu_set_t *)old->bits);
+}
@@ -0,0 +1,48 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#define TOPOLOGY_MAX_CPUS 1024 /* the size of a cpu_set_t */
+#define CACHE_LINE 64
+
+/* Where the solver threads go.  Read from /sys: the CPUs this process may
+ * run on (its affinity mask, so taskset and cpusets are obeyed), their
+ * physical cores, their NUMA nodes, and the CPU quota of its cgroup (v1 or
+ * v2).  One thread per core, as many as the quota pays for: a second
+ * thread on the SMT sibling of a busy core gains little on field arithmetic,
+ * and threads beyond the quota are only throttled. */
+typedef struct {
+    int cpus;       /* logical CPUs usable */
+    int cores;      /* physical cores among them */
+    int nodes;      /* NUMA nodes among them */
+    double quota;   /* CPUs the cgroup quota allows, 0 if there is none */
+    int workers;    /* threads to run by default */
+    /* CPU of thread i: first one CPU per core, node by node, so that a few
+     * threads share a node; then the SMT siblings */
+    int order[TOPOLOGY_MAX_CPUS];
+} Topology;
+
+/* Read the topology under ``root``, e.g. "" for the live system.  Only the
+ * CPUs flagged in ``allowed`` (TOPOLOGY_MAX_CPUS flags) count, every online
+ * CPU if it is NULL.  Missing files read as no NUMA, no SMT and no quota.
+ * Returns 0 if not even the online CPUs can be read. */
+int topology_read(Topology *t, const char *root, const unsigned char *allowed);
+
+/* The live system, read once.  Never NULL: without /sys it is every online
+ * processor, one core each. */
+const Topology *topology_get(void);
+
+/* CPU for thread ``thread``, -1 past the last one: extra threads float. */
+int topology_cpu(const Topology *t, int thread);
+
+/* Affinity mask of a thread, to put it back after a while on one CPU. */
+typedef struct {
+    unsigned long bits[TOPOLOGY_MAX_CPUS / (8 * sizeof(unsigned long))];
+} TopologyMask;
+
+/* Pin the calling thread to ``cpu``, saving its mask to ``old`` unless
+ * NULL.  Memory it touches first from then on comes from the node of that
+ * CPU.  Returns 0, and changes nothing, if cpu is -1 or pinning fails. */
+int topology_pin(int cpu, TopologyMask *old);
+void topology_unpin(const TopologyMask *old);
+
+#endif /* TOPOLOGY_H */
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "walk.h"
+
+/* Private key offset of the 0x80 version byte: the key of a candidate is
+ * (value >> shift) - VERSION_OFFSET. */
+static const wif_num VERSION_OFFSET = {{0, 0, 0, 0, 0x80}};
+
+static char *filter_chars(const char *chars) {
+    char *out = malloc(strlen(BASE58_ALPHABET) + 1);
+    size_t n = 0;
+    if (!out)
+        return NULL;
+    for (const char *p = chars; *p; ++p) {
+        if (base58_digit(*p) >= 0 && !memchr(out, *p, n))
+            out[n++] = *p;
+    }
+    if (n == 0) {
+        /* same as the Java solver: no usable hint means the whole alphabet */
+        strcpy(out, BASE58_ALPHABET);
+        return out;
+    }
+    out[n] = '\0';
+    return out;
+}
+
+/* p = (+/-num) * G for a number of up to 320 bits */
+static int set_point(ec_context *ctx, ec_point *p, const wif_num *num, int negative) {
+    unsigned char bytes[WIF_NUM_LIMBS * 8];
+    wif_num_to_bytes(num, bytes, sizeof(bytes));
+    return ec_point_set_scalar(ctx, p, bytes, sizeof(bytes), negative);
+}
+
+/* p = public key of the candidate with Base58 value ``num`` */
+static int set_key_point(ec_context *ctx, ec_point *p, const wif_num *num, int shift) {
+    wif_num key;
+    int negative;
+    wif_num_shr(&key, num, shift);
+    negative = wif_num_cmp(&key, &VERSION_OFFSET) < 0;
+    if (negative) {
+        wif_num v = VERSION_OFFSET;
+        wif_num_sub(&v, &key);
+        key = v;
+    } else {
+        wif_num_sub(&key, &VERSION_OFFSET);
+    }
+    return set_point(ctx, p, &key, negative);
+}
+
+static int step_init(ec_context *ctx, const WalkTables *t, WalkStep *st, int exp, char from, char to) {
+    int diff = base58_digit(to) - base58_digit(from);
+    wif_num hi, one = {{1, 0, 0, 0, 0}};
+
+    st->sign = diff >= 0 ? 1 : -1;
+    wif_num_set_pow58(&st->delta, exp);
+    wif_num_mul_word(&st->delta, (uint64_t)(diff >= 0 ? diff : -diff));
+    st->low = st->delta.v[0] & ((1ULL << t->shift) - 1);
+    if (!t->track_points)
+        return 1;
+
+    wif_num_shr(&hi, &st->delta, t->shift);
+    for (int c = 0; c < 2; c++) {
+        if (!ec_point_init(ctx, &st->add[c]) || !ec_point_init(ctx, &st->sub[c]))
+            return 0;
+        if (!set_point(ctx, &st->add[c], &hi, 0) || !set_point(ctx, &st->sub[c], &hi, 1))
+            return 0;
+        wif_num_add(&hi, &one);
+    }
+    return ec_points_normalize(ctx, st->add, 2) && ec_points_normalize(ctx, st->sub, 2);
+}
+
+/* Build the delta tables for ``wif`` where the characters at the given
+ * positions are replaced by their candidate sets.  When ``track_points`` is
+ * set every step also carries the matching public key delta, so walkers can
+ * follow the public key with one point addition per candidate. */
+WalkTables *walk_tables_create(ec_context *ctx, const char *wif, const GuessPos *pos,
+                               int count, int compressed, int track_points) {
+    WalkTables *t;
+    if (count > WALK_MAX_POSITIONS)
+        return NULL;
+    t = calloc(1, sizeof(WalkTables));
+    if (!t)
+        return NULL;
+    t->count = count;
+    t->len = (int)strlen(wif);
+    t->compressed = compressed;
+    t->shift = compressed ? 40 : 32;
+    t->track_points = track_points;
+    t->wif = strdup(wif);
+    if (!t->wif)
+        goto fail;
+
+    for (int k = 0; k < count; ++k) {
+        t->index[k] = pos[k].index;
+        t->chars[k] = filter_chars(pos[k].chars);
+        if (!t->chars[k])
+            goto fail;
+        t->radix[k] = (int)strlen(t->chars[k]);
+        t->wif[t->index[k]] = t->chars[k][0];
+    }
+
+    if (!wif_num_from_base58(&t->start, t->wif)) {
+        fprintf(stderr, "Error: WIF contains characters outside of Base58\n");
+        goto fail;
+    }
+
+    for (int k = 0; k < count; ++k) {
+        int exp = t->len - 1 - t->index[k];
+        t->steps[k] = calloc(t->radix[k], sizeof(WalkStep));
+        if (!t->steps[k])
+            goto fail;
+        for (int j = 0; j + 1 < t->radix[k]; ++j) {
+            if (!step_init(ctx, t, &t->steps[k][j], exp, t->chars[k][j], t->chars[k][j + 1]))
+                goto fail;
+        }
+    }
+
+    if (track_points) {
+        if (!ec_point_init(ctx, &t->start_point) || !set_key_point(ctx, &t->start_point, &t->start, t->shift))
+            goto fail;
+    }
+    return t;
+
+fail:
+    walk_tables_free(t);
+    return NULL;
+}
+
+void walk_tables_free(WalkTables *t) {
+    if (!t)
+        return;
+    for (int k = 0; k < t->count; ++k) {
+        if (t->steps[k] && t->track_points) {
+            for (int j = 0; j + 1 < t->radix[k]; ++j) {
+                for (int c = 0; c < 2; c++) {
+                    ec_point_clear(&t->steps[k][j].add[c]);
+                    ec_point_clear(&t->steps[k][j].sub[c]);
+                }
+            }
+        }
+        free(t->steps[k]);
+        free(t->chars[k]);
+    }
+    if (t->track_points)
+        ec_point_clear(&t->start_point);
+    free(t->wif);
+    free(t);
+}
+
+/* Position the walker on the first candidate. */
+int walk_state_init(WalkState *s, ec_context *ctx, const WalkTables *t) {
+    memset(s, 0, sizeof(*s));
+    s->t = t;
+    s->wif = strdup(t->wif);
+    if (!s->wif)
+        return 0;
+    s->num = t->start;
+    for (int k = 0; k < t->count; ++k)
+        s->dir[k] = 1;
+    if (t->track_points) {
+        if (!ec_point_init(ctx, &s->point) || !ec_point_copy(&s->point, &t->start_point)) {
+            walk_state_clear(s);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Number of candidates of the walk; 0 if it does not fit in 64 bits. */
+uint64_t walk_keyspace(const WalkTables *t) {
+    uint64_t total = 1;
+    for (int k = 0; k < t->count; ++k) {
+        if (total > UINT64_MAX / (uint64_t)t->radix[k])
+            return 0;
+        total *= (uint64_t)t->radix[k];
+    }
+    return total;
+}
+
+/* Jump to the candidate visited after ``rank`` steps.  Position k moves
+ * forward while the rank of the positions to its left is even and backward
+ * while it is odd, which gives its digit and direction directly. */
+int walk_state_seek(WalkState *s, ec_context *ctx, uint64_t rank) {
+    const WalkTables *t = s->t;
+    int r[WALK_MAX_POSITIONS];
+    int odd = 0;
+
+    for (int k = t->count - 1; k >= 0; --k) {
+        r[k] = (int)(rank % (uint64_t)t->radix[k]);
+        rank /= (uint64_t)t->radix[k];
+    }
+    if (rank != 0)
+        return 0;
+    for (int k = 0; k < t->count; ++k) {
+        s->dir[k] = odd ? -1 : 1;
+        s->digit[k] = odd ? t->radix[k] - 1 - r[k] : r[k];
+        s->wif[t->index[k]] = t->chars[k][s->digit[k]];
+        odd = (odd * t->radix[k] + r[k]) & 1;
+    }
+    if (!wif_num_from_base58(&s->num, s->wif))
+        return 0;
+    return !t->track_points || set_key_point(ctx, &s->point, &s->num, t->shift);
+}
+
+void walk_state_clear(WalkState *s) {
+    if (s->t && s->t->track_points)
+        ec_point_clear(&s->point);
+    free(s->wif);
+    s->wif = NULL;
+}
+
+/* Advance to the next candidate.  The rightmost position that can still move
+ * in its direction moves by one character and every position to its right
+ * reverses direction.  Returns 0 once the whole keyspace has been visited. */
+int walk_next(WalkState *s, ec_context *ctx) {
+    const WalkTables *t = s->t;
+    const uint64_t mask = (1ULL << t->shift) - 1;
+
+    for (int k = t->count - 1; k >= 0; --k) {
+        int d = s->digit[k];
+        int nd = d + s->dir[k];
+        const WalkStep *st;
+        const ec_point *delta;
+
+        if (nd < 0 || nd >= t->radix[k]) {
+            s->dir[k] = -s->dir[k];
+            continue;
+        }
+
+        st = &t->steps[k][s->dir[k] > 0 ? d : nd];
+        if ((s->dir[k] > 0) == (st->sign > 0)) {
+            int carry = (s->num.v[0] & mask) + st->low > mask;
+            wif_num_add(&s->num, &st->delta);
+            delta = &st->add[carry];
+        } else {
+            int borrow = (s->num.v[0] & mask) < st->low;
+            wif_num_sub(&s->num, &st->delta);
+            delta = &st->sub[borrow];
+        }
+        if (t->track_points && !ec_point_add(ctx, &s->point, &s->point, delta))
+            return 0;
+
+        s->digit[k] = nd;
+        s->wif[t->index[k]] = t->chars[k][nd];
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+#ifndef WALK_H
+#define WALK_H
+
+#include "bitcoin.h"
+
+#define WALK_MAX_POSITIONS 128
+
+typedef struct {
+    int index;        /* position in WIF */
+    const char *chars; /* possible replacements */
+    const double *weights; /* one per character of chars, NULL if all alike */
+} GuessPos;
+
+/* Moving a position from chars[j] to chars[j+1] adds sign * delta to the
+ * Base58 value of the WIF.  The private key sits above the low ``shift``
+ * bits (compression flag and checksum), so it moves by delta >> shift plus
+ * an optional carry out of the low bits; both outcomes are precomputed. */
+typedef struct {
+    wif_num delta;
+    uint64_t low;      /* delta mod 2^shift */
+    int sign;
+    ec_point add[2];   /* (delta >> shift) * G and (delta >> shift + 1) * G */
+    ec_point sub[2];   /* the same points negated */
+} WalkStep;
+
+/* Read-only tables shared by every walker of one WIF template. */
+typedef struct {
+    int count;
+    int len;
+    int compressed;
+    int shift;
+    int track_points;
+    char *wif;                     /* every position at its first character */
+    int index[WALK_MAX_POSITIONS];
+    char *chars[WALK_MAX_POSITIONS];
+    int radix[WALK_MAX_POSITIONS];
+    WalkStep *steps[WALK_MAX_POSITIONS];
+    wif_num start;
+    ec_point start_point;
+} WalkTables;
+
+/* Current candidate of a walk in reflected Gray order: every step changes
+ * exactly one position to a neighbouring character of its set.  Aligned to
+ * cache lines, as the walkers of all threads sit in one array. */
+typedef struct {
+    const WalkTables *t;
+    char *wif;
+    wif_num num;
+    int digit[WALK_MAX_POSITIONS];
+    int dir[WALK_MAX_POSITIONS];
+    ec_point point;
+} __attribute__((aligned(64))) WalkState;
+
+WalkTables *walk_tables_create(ec_context *ctx, const char *wif, const GuessPos *pos,
+                               int count, int compressed, int track_points);
+void walk_tables_free(WalkTables *t);
+
+uint64_t walk_keyspace(const WalkTables *t);
+
+int walk_state_init(WalkState *s, ec_context *ctx, const WalkTables *t);
+int walk_state_seek(WalkState *s, ec_context *ctx, uint64_t rank);
+void walk_state_clear(WalkState *s);
+int walk_next(WalkState *s, ec_context *ctx);
+
+#endif /* WALK_H */
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "weighted.h"
+
+#define COST_STEP 1.189207115002721   /* 2^(1 / WEIGHT_COST_STEPS) */
+#define COST_ROUND 1.0905077326652577 /* half a step */
+
+#define WAYS(t, k, c) ((c) < 0 ? 0 : (t)->ways[(size_t)(k) * ((t)->max_cost + 1) + (c)])
+
+/* round(WEIGHT_COST_STEPS * log2(max / w)), capped */
+static int weight_cost(double max, double w) {
+    double threshold = w * COST_ROUND;
+    int c = 0;
+    if (w <= 0)
+        return WEIGHT_COST_MAX;
+    while (c < WEIGHT_COST_MAX && max >= threshold) {
+        threshold *= COST_STEP;
+        c++;
+    }
+    return c;
+}
+
+/* The Base58 characters of a set, each once, with their cost; like the walk,
+ * a set without any usable character stands for the whole alphabet. */
+static int position_init(WeightedTables *t, int k, const GuessPos *pos) {
+    const char *src = pos->chars;
+    double w[58], max = 0;
+    int n = 0;
+
+    t->chars[k] = malloc(59);
+    t->cost[k] = malloc(58 * sizeof(int));
+    t->value[k] = malloc(58 * sizeof(wif_num));
+    if (!t->chars[k] || !t->cost[k] || !t->value[k])
+        return 0;
+    for (size_t i = 0; src[i]; ++i) {
+        if (base58_digit(src[i]) < 0 || memchr(t->chars[k], src[i], n))
+            continue;
+        t->chars[k][n] = src[i];
+        w[n] = pos->weights ? pos->weights[i] : 1;
+        if (w[n] > max)
+            max = w[n];
+        n++;
+    }
+    if (n == 0) {
+        for (; n < 58; ++n) {
+            t->chars[k][n] = BASE58_ALPHABET[n];
+            w[n] = max = 1;
+        }
+    }
+    t->chars[k][n] = '\0';
+    t->radix[k] = n;
+
+    for (int i = 0; i < n; ++i)
+        t->cost[k][i] = weight_cost(max, w[i]);
+    /* cheapest first, ties in the order of the set */
+    for (int i = 1; i < n; ++i) {
+        int c = t->cost[k][i], j = i;
+        char ch = t->chars[k][i];
+        for (; j > 0 && t->cost[k][j - 1] > c; --j) {
+            t->cost[k][j] = t->cost[k][j - 1];
+            t->chars[k][j] = t->chars[k][j - 1];
+        }
+        t->cost[k][j] = c;
+        t->chars[k][j] = ch;
+    }
+    for (int i = 0; i < n; ++i) {
+        wif_num_set_pow58(&t->value[k][i], t->len - 1 - t->index[k]);
+        wif_num_mul_word(&t->value[k][i], (uint64_t)base58_digit(t->chars[k][i]));
+    }
+    t->max_cost += t->cost[k][n - 1];
+    return 1;
+}
+
+WeightedTables *weighted_tables_create(const char *wif, const GuessPos *pos, int count) {
+    WeightedTables *t;
+    size_t width;
+
+    if (count > WALK_MAX_POSITIONS)
+        return NULL;
+    t = calloc(1, sizeof(WeightedTables));
+    if (!t)
+        return NULL;
+    t->count = count;
+    t->len = (int)strlen(wif);
+    t->wif = strdup(wif);
+    if (!t->wif)
+        goto fail;
+    for (int k = 0; k < count; ++k) {
+        t->index[k] = pos[k].index;
+        t->wif[t->index[k]] = '1';
+        if (!position_init(t, k, &pos[k]))
+            goto fail;
+    }
+    if (!wif_num_from_base58(&t->base, t->wif)) {
+        fprintf(stderr, "Error: WIF contains characters outside of Base58\n");
+        goto fail;
+    }
+
+    /* ways[k][c]: completions of the positions k.. that cost exactly c */
+    width = (size_t)t->max_cost + 1;
+    t->ways = calloc((size_t)(count + 1) * width, sizeof(uint64_t));
+    t->layer_start = calloc(width + 1, sizeof(uint64_t));
+    if (!t->ways || !t->layer_start)
+        goto fail;
+    t->ways[(size_t)count * width] = 1;
+    for (int k = count - 1; k >= 0; --k) {
+        for (int c = 0; c <= t->max_cost; ++c) {
+            uint64_t n = 0;
+            for (int j = 0; j < t->radix[k] && t->cost[k][j] <= c; ++j) {
+                uint64_t w = WAYS(t, k + 1, c - t->cost[k][j]);
+                if (n > UINT64_MAX - w) {
+                    fprintf(stderr, "Error: too many unknown characters, keyspace exceeds 2^64\n");
+                    goto fail;
+                }
+                n += w;
+            }
+            t->ways[(size_t)k * width + c] = n;
+        }
+    }
+    for (int c = 0; c <= t->max_cost; ++c) {
+        uint64_t w = WAYS(t, 0, c);
+        if (t->layer_start[c] > UINT64_MAX - w) {
+            fprintf(stderr, "Error: too many unknown characters, keyspace exceeds 2^64\n");
+            goto fail;
+        }
+        t->layer_start[c + 1] = t->layer_start[c] + w;
+    }
+    return t;
+
+fail:
+    weighted_tables_free(t);
+    return NULL;
+}
+
+void weighted_tables_free(WeightedTables *t) {
+    if (!t)
+        return;
+    for (int k = 0; k < t->count; ++k) {
+        free(t->chars[k]);
+        free(t->cost[k]);
+        free(t->value[k]);
+    }
+    free(t->ways);
+    free(t->layer_start);
+    free(t->wif);
+    free(t);
+}
+
+uint64_t weighted_keyspace(const WeightedTables *t) {
+    return t->layer_start[t->max_cost + 1];
+}
+
+static void set_digit(const WeightedTables *t, WeightedState *s, int k, int j) {
+    if (s->digit[k] == j)
+        return;
+    wif_num_sub(&s->num, &t->value[k][s->digit[k]]);
+    wif_num_add(&s->num, &t->value[k][j]);
+    s->digit[k] = j;
+}
+
+/* The first completion of the positions k.. that costs ``c``. */
+static void fill(const WeightedTables *t, WeightedState *s, int k, int c) {
+    for (; k < t->count; ++k) {
+        int j = 0;
+        while (WAYS(t, k + 1, c - t->cost[k][j]) == 0)
+            ++j;
+        set_digit(t, s, k, j);
+        c -= t->cost[k][j];
+    }
+}
+
+int weighted_state_seek(const WeightedTables *t, WeightedState *s, uint64_t rank) {
+    int lo = 0, hi = t->max_cost, c;
+
+    if (rank >= weighted_keyspace(t))
+        return 0;
+    /* the last layer starting at or before the rank */
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (t->layer_start[mid] <= rank)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    s->layer = c = lo;
+    rank -= t->layer_start[c];
+    s->num = t->base;
+    for (int k = 0; k < t->count; ++k) {
+        int j = 0;
+        for (;; ++j) {
+            uint64_t n = WAYS(t, k + 1, c - t->cost[k][j]);
+            if (rank < n)
+                break;
+            rank -= n;
+        }
+        s->digit[k] = j;
+        wif_num_add(&s->num, &t->value[k][j]);
+        c -= t->cost[k][j];
+    }
+    return 1;
+}
+
+/* The next candidate of the layer: the rightmost position that can take a
+ * later character while the positions after it still make up the cost, the
+ * first such completion after it.  Once the layer is done, the first
+ * candidate of the next layer that is not empty. */
+int weighted_next(const WeightedTables *t, WeightedState *s) {
+    int suffix = 0;
+    for (int k = t->count - 1; k >= 0; --k) {
+        suffix += t->cost[k][s->digit[k]];
+        for (int j = s->digit[k] + 1; j < t->radix[k]; ++j) {
+            int rest = suffix - t->cost[k][j];
+            if (rest < 0)
+                break;
+            if (WAYS(t, k + 1, rest)) {
+                set_digit(t, s, k, j);
+                fill(t, s, k + 1, rest);
+                return 1;
+            }
+        }
+    }
+    for (int c = s->layer + 1; c <= t->max_cost; ++c) {
+        if (WAYS(t, 0, c)) {
+            s->layer = c;
+            fill(t, s, 0, c);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void weighted_state_wif(const WeightedTables *t, const WeightedState *s, char *out) {
+    memcpy(out, t->wif, t->len + 1);
+    for (int k = 0; k < t->count; ++k)
+        out[t->index[k]] = t->chars[k][s->digit[k]];
+}
@@ -0,0 +1,54 @@
+#ifndef WEIGHTED_H
+#define WEIGHTED_H
+
+#include "bitcoin.h"
+#include "walk.h"
+
+#define WEIGHT_COST_STEPS 4  /* cost levels per halving of the probability */
+#define WEIGHT_COST_MAX 255  /* of one character */
+
+/* Best-first order over the same keyspace as the walk, for hint sets with
+ * weights.  A character of weight w in a set whose heaviest character has
+ * weight m costs round(WEIGHT_COST_STEPS * log2(m / w)), so the cost of a
+ * candidate is about -log2 of its joint probability relative to the likeliest
+ * one.  Candidates are visited layer by layer in increasing cost, and within a
+ * layer in lexicographic order of the (cost sorted) characters; ways[] counts
+ * the completions of every cost, so rank r of the order can be unranked
+ * directly and every candidate comes exactly once. */
+typedef struct {
+    int count;
+    int len;
+    int max_cost;
+    char *wif;
+    int index[WALK_MAX_POSITIONS];
+    int radix[WALK_MAX_POSITIONS];
+    char *chars[WALK_MAX_POSITIONS];  /* cheapest first */
+    int *cost[WALK_MAX_POSITIONS];    /* ascending */
+    wif_num *value[WALK_MAX_POSITIONS]; /* digit * 58^p of each character */
+    wif_num base;                     /* value with every position at '1' */
+    uint64_t *ways;                   /* [(count + 1) * (max_cost + 1)] */
+    uint64_t *layer_start;            /* first rank of each cost, [max_cost + 2] */
+} WeightedTables;
+
+/* One per thread, aligned like WalkState. */
+typedef struct {
+    int layer;                        /* cost of the candidate */
+    int digit[WALK_MAX_POSITIONS];    /* index into chars */
+    wif_num num;
+} __attribute__((aligned(64))) WeightedState;
+
+/* NULL if a character outside of Base58 is left in the WIF, or the
+ * keyspace reaches 2^64. */
+WeightedTables *weighted_tables_create(const char *wif, const GuessPos *pos, int count);
+void weighted_tables_free(WeightedTables *t);
+
+uint64_t weighted_keyspace(const WeightedTables *t);
+
+/* Returns 0 past the end of the keyspace. */
+int weighted_state_seek(const WeightedTables *t, WeightedState *s, uint64_t rank);
+int weighted_next(const WeightedTables *t, WeightedState *s);
+
+/* The candidate of a state as a WIF, ``out`` holds t->len + 1 bytes. */
+void weighted_state_wif(const WeightedTables *t, const WeightedState *s, char *out);
+
+#endif /* WEIGHTED_H */
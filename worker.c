@@ -1,27 +1,28 @@
 #include <stdio.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <openssl/sha.h>
 #include <openssl/bn.h>
 #include "bitcoin.h"
+#include "hash.h"
+#include "jump.h"
+#include "progress.h"
+#include "ring.h"
+#include "scheduler.h"
+#include "shard.h"
+#include "topology.h"
+#include "walk.h"
+#include "weighted.h"
 #include "worker.h"
 
-static const char BASE58_ALPHABET[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
 static const int BASE58_ALPHABET_LEN = 58;
 
-static const char *work_to_string(WORK work) {
-    switch (work) {
-        case WORK_END: return "END";
-        case WORK_JUMP: return "JUMP";
-        case WORK_ROTATE: return "ROTATE";
-        case WORK_SEARCH: return "SEARCH";
-        case WORK_ALIKE: return "ALIKE";
-        case WORK_START:
-        default: return "START";
-    }
-}
-
 static void send_email(Worker *worker, const char *subject, const char *body) {
     EmailConfiguration *email = configuration_get_email(worker->config);
     if (!email) return;
@@ -29,12 +30,47 @@ static void send_email(Worker *worker, const char *subject, const char *body) {
     printf("[email] %s\n%s\n", subject, body ? body : "");
 }
 
+/* The address line names either one address or a file with one address per
+ * line, so that a batch of keys can be checked against all the addresses
+ * they may belong to in a single run. */
+static TargetSet *load_targets(const char *address) {
+    TargetSet *set;
+    FILE *f;
+    int ok;
+
+    if (!address)
+        return NULL;
+    set = target_set_create();
+    if (!set)
+        return NULL;
+    f = fopen(address, "r");
+    if (f) {
+        fclose(f);
+        ok = target_set_load(set, address);
+    } else {
+        ok = target_set_add_address(set, address);
+    }
+    if (!ok || !target_set_finish(set) || set->count == 0) {
+        target_set_free(set);
+        return NULL;
+    }
+    if (f)
+        printf("Loaded %zu target addresses from %s\n", set->count, address);
+    return set;
+}
+
 Worker *worker_create(Configuration *config) {
     if (!config) return NULL;
     Worker *w = calloc(1, sizeof(Worker));
     if (!w) return NULL;
     w->config = config;
-    w->time_id = (unsigned long)time(NULL);
+    w->targets = load_targets(configuration_get_target_address(config));
+    if (w->targets && !(w->found = calloc(w->targets->count, 1))) {
+        target_set_free(w->targets);
+        free(w);
+        return NULL;
+    }
+    pthread_mutex_init(&w->result_lock, NULL);
     return w;
 }
 
@@ -44,19 +80,64 @@ void worker_free(Worker *w) {
         free(w->results[i]);
     }
     free(w->results);
+    target_set_free(w->targets);
+    free(w->found);
+    checkpoint_clear(&w->resume);
+    pthread_mutex_destroy(&w->result_lock);
     free(w);
 }
 
-void worker_add_result(Worker *w, const char *data) {
-    if (!w || !data) return;
+/* A list of candidates may hold the same WIF twice; it is one result. */
+int worker_add_result(Worker *w, const char *data) {
+    if (!w || !data) return 0;
+    pthread_mutex_lock(&w->result_lock);
+    for (size_t i = 0; i < w->result_count; ++i) {
+        if (strcmp(w->results[i], data) == 0) {
+            pthread_mutex_unlock(&w->result_lock);
+            return 0;
+        }
+    }
     if (w->result_count >= w->result_capacity) {
         size_t newcap = w->result_capacity ? w->result_capacity * 2 : 4;
         char **tmp = realloc(w->results, newcap * sizeof(char *));
-        if (!tmp) return;
+        if (!tmp) {
+            pthread_mutex_unlock(&w->result_lock);
+            return 0;
+        }
         w->results = tmp;
         w->result_capacity = newcap;
     }
     w->results[w->result_count++] = strdup(data);
+    pthread_mutex_unlock(&w->result_lock);
+    return 1;
+}
+
+/* Flag target ``index`` found; returns the targets found so far. */
+static size_t worker_found_target(Worker *w, long index) {
+    size_t found;
+    pthread_mutex_lock(&w->result_lock);
+    if (index >= 0 && !w->found[index]) {
+        w->found[index] = 1;
+        w->found_count++;
+    }
+    found = w->found_count;
+    pthread_mutex_unlock(&w->result_lock);
+    return found;
+}
+
+/* The same for a result of an earlier run: whichever hash of its key is a
+ * target. */
+static void worker_found_wif(Worker *w, const char *wif) {
+    unsigned char key[32], hash[20], script[20];
+    int compressed;
+    if (!w->targets || !decode_wif(wif, key, &compressed) ||
+        !generate_pubkey_hash_from_privkey(key, compressed, hash))
+        return;
+    worker_found_target(w, target_set_find(w->targets, hash));
+    if (compressed) {
+        p2wpkh_script_hash_batch(hash, 1, script);
+        worker_found_target(w, target_set_find(w->targets, script));
+    }
 }
 
 void worker_result_to_file(Worker *w) {
@@ -76,75 +157,975 @@ void worker_result_to_file(Worker *w) {
     fclose(f);
 }
 
-void worker_result_to_file_partial(Worker *w, const char *data) {
-    if (!w || !data) return;
-    char filename[64];
-    snprintf(filename, sizeof(filename), "resultPartial_%lu.txt", w->time_id);
-    FILE *f = fopen(filename, "a");
-    if (!f) {
-        perror("fopen");
+size_t worker_results_count(const Worker *w) {
+    return w ? w->result_count : 0;
+}
+
+size_t worker_targets_found(const Worker *w) {
+    return w ? w->found_count : 0;
+}
+
+#define CANDIDATE_BATCH_SIZE 1024
+#define STOP_POLL_MASK 1023 /* candidates between checks of the found flag */
+
+/* Hashes derived from the one public key of a candidate.  P2WPKH pays to
+ * the compressed key hash, like compressed P2PKH. */
+enum {
+    FORM_COMPRESSED,    /* P2PKH of a compressed key, P2WPKH */
+    FORM_UNCOMPRESSED,  /* P2PKH of an uncompressed key */
+    FORM_P2SH_P2WPKH,   /* script hash of the P2WPKH redeem script */
+    FORM_COUNT
+};
+
+/* Checksum-valid candidates waiting for their public key hash.  They are
+ * hashed together so that the conversion of their points to affine
+ * coordinates shares a single field inversion.  A point is either set by
+ * the solver (a walk that follows the key) or left for the key stage to
+ * derive from the key. */
+typedef struct {
+    ec_point points[CANDIDATE_BATCH_SIZE];
+    unsigned char keys[CANDIDATE_BATCH_SIZE][32];
+    unsigned char derive[CANDIDATE_BATCH_SIZE];
+    size_t count;
+    Scheduler *sched;    /* of the range the batch came from */
+} KeyBatch;
+
+/* The expensive end of the pipeline: derive the missing points, hash every
+ * form the targets need, look the hashes up.  It runs on the solver thread
+ * itself, or on a key stage thread of its own (--key-threads). */
+typedef struct {
+    Worker *w;
+    ec_context *ctx;
+    const TargetSet *targets;
+    unsigned forms;      /* 1 << FORM_* the targets need */
+    ProgressCounters *stats;
+    unsigned char hashes[FORM_COUNT][CANDIDATE_BATCH_SIZE * 20];
+    unsigned char infinite[CANDIDATE_BATCH_SIZE]; /* points without a hash */
+} KeyStage;
+
+/* The rings between one solver thread and the key stage thread serving it:
+ * full batches go one way, hashed ones come back.  KEY_PIPELINE_DEPTH
+ * batches circulate, so the solver fills one while the others are hashed. */
+#define KEY_PIPELINE_DEPTH 4
+
+typedef struct {
+    SpscRing full;
+    SpscRing done;
+} KeyLink;
+
+/* The candidates of one solver thread.  Each thread owns one, set up once
+ * with its curve context, scratch space and the decoded targets, so that
+ * checking a candidate never allocates. */
+typedef struct {
+    Worker *w;
+    Scheduler *sched;
+    ec_context *ctx;
+    const TargetSet *targets;
+    KeyBatch *keys;      /* being filled */
+    KeyBatch *pool[KEY_PIPELINE_DEPTH];
+    KeyBatch *idle[KEY_PIPELINE_DEPTH]; /* pipelined: back from the key stage */
+    int idle_count;
+    int in_flight;       /* pipelined: with the key stage */
+    KeyLink *link;       /* NULL: this thread is its own key stage */
+    KeyStage stage;
+    int compressed;      /* flag byte of the WIF payloads */
+    WifCheckBatch check; /* candidates waiting for their checksum */
+    WifCheckBatch uncompressed; /* LIST: those of 51 characters, check has the 52 */
+    ProgressCounters stats;
+} CandidateBatch;
+
+static void batch_free(CandidateBatch *b) {
+    if (!b)
         return;
+    for (int k = 0; k < KEY_PIPELINE_DEPTH && b->pool[k]; ++k) {
+        for (size_t i = 0; i < CANDIDATE_BATCH_SIZE; ++i)
+            ec_point_clear(&b->pool[k]->points[i]);
+        free(b->pool[k]);
     }
-    fprintf(f, "%s\n", data);
-    fclose(f);
+    ec_context_free(b->ctx);
+    free(b);
 }
 
-size_t worker_results_count(const Worker *w) {
-    return w ? w->result_count : 0;
+/* Only the forms some target can match: P2PKH as the WIF flag serializes
+ * the key, segwit addresses always with the compressed key.  A target set
+ * of raw hashes is taken as P2PKH. */
+static unsigned batch_forms(const TargetSet *t, int compressed) {
+    unsigned types = t->types ? t->types : 1U << ADDRESS_P2PKH;
+    unsigned forms = 0;
+    if (types & 1U << ADDRESS_P2PKH)
+        forms |= 1U << (compressed ? FORM_COMPRESSED : FORM_UNCOMPRESSED);
+    if (types & 1U << ADDRESS_P2WPKH)
+        forms |= 1U << FORM_COMPRESSED;
+    if (types & 1U << ADDRESS_P2SH)
+        forms |= 1U << FORM_P2SH_P2WPKH;
+    return forms;
 }
 
-typedef struct {
-    int index;        /* position in WIF */
-    const char *chars; /* possible replacements */
-} GuessPos;
+/* Zeroed per-thread state of a cache line aligned type, so that no line is
+ * written by two threads. */
+static void *calloc_lines(size_t count, size_t size) {
+    void *p = aligned_alloc(CACHE_LINE, count * size);
+    if (p)
+        memset(p, 0, count * size);
+    return p;
+}
 
-static char *work_thread(Worker *w, const char *suspect) {
-    const char *target_addr = configuration_get_target_address(w->config);
-    if (!target_addr)
+static CandidateBatch *batch_create(Worker *w) {
+    if (!w->targets)
         return NULL;
 
-    unsigned char target_hash[20];
-    if (!base58_decode_bitcoin_address(target_addr, target_hash))
+    CandidateBatch *b = calloc_lines(1, sizeof(CandidateBatch));
+    if (!b)
+        return NULL;
+    b->w = w;
+    b->targets = w->targets;
+    b->compressed = configuration_is_compressed(w->config);
+    wif_check_batch_init(&b->check, b->compressed);
+    wif_check_batch_init(&b->uncompressed, 0);
+    b->ctx = ec_context_create();
+    if (!b->ctx || !ec_context_reserve(b->ctx, CANDIDATE_BATCH_SIZE)) {
+        batch_free(b);
         return NULL;
+    }
+    for (int k = 0; k < KEY_PIPELINE_DEPTH; ++k) {
+        b->pool[k] = calloc(1, sizeof(KeyBatch));
+        if (!b->pool[k]) {
+            batch_free(b);
+            return NULL;
+        }
+        for (size_t i = 0; i < CANDIDATE_BATCH_SIZE; ++i) {
+            if (!ec_point_init(b->ctx, &b->pool[k]->points[i])) {
+                batch_free(b);
+                return NULL;
+            }
+        }
+    }
+    b->keys = b->pool[0];
+    b->stage.w = w;
+    b->stage.ctx = b->ctx;
+    b->stage.targets = b->targets;
+    b->stage.forms = batch_forms(b->targets, b->compressed);
+    b->stage.stats = &b->stats;
+    return b;
+}
+
+static void batch_add_key(CandidateBatch *b, const unsigned char *priv_key);
+
+static void batch_check_run(CandidateBatch *b, WifCheckBatch *check) {
+    size_t n = wif_check_batch_run(check);
+    if (n)
+        progress_add(&b->stats.survivors, n);
+    for (size_t i = 0; i < n; ++i)
+        batch_add_key(b, wif_check_batch_key(check, i));
+}
+
+/* Run the checksum over the queued candidates and queue the survivors for
+ * their public key. */
+static void batch_check_flush(CandidateBatch *b) {
+    batch_check_run(b, &b->check);
+    if (b->uncompressed.count)
+        batch_check_run(b, &b->uncompressed);
+}
+
+static void batch_check(CandidateBatch *b, const wif_num *n) {
+    if (wif_check_batch_add(&b->check, n))
+        batch_check_flush(b);
+}
+
+/* Derive the points left to the stage.  A key of 0 or n and above is no
+ * private key, even though the multiplication would take it modulo n: it is
+ * dropped, like one the multiplication fails on. */
+static void key_stage_derive(KeyStage *k, KeyBatch *kb) {
+    size_t n = 0;
+    for (size_t i = 0; i < kb->count; ++i) {
+        if (!private_key_valid(kb->keys[i]) ||
+            (kb->derive[i] && !ec_point_set_scalar(k->ctx, &kb->points[i], kb->keys[i], 32, 0)))
+            continue;
+        if (n != i) {
+            memcpy(kb->keys[n], kb->keys[i], 32);
+            ec_point_copy(&kb->points[n], &kb->points[i]);
+        }
+        n++;
+    }
+    kb->count = n;
+}
+
+/* Every form the targets need from the same points: the first hash160
+ * normalizes them for all the others. */
+static int key_stage_hash(KeyStage *k, KeyBatch *kb) {
+    if ((k->forms & (1U << FORM_COMPRESSED | 1U << FORM_P2SH_P2WPKH)) &&
+        !ec_points_hash160(k->ctx, kb->points, kb->count, 1, k->hashes[FORM_COMPRESSED],
+                           k->infinite))
+        return 0;
+    if ((k->forms & 1U << FORM_UNCOMPRESSED) &&
+        !ec_points_hash160(k->ctx, kb->points, kb->count, 0, k->hashes[FORM_UNCOMPRESSED],
+                           k->infinite))
+        return 0;
+    if (k->forms & 1U << FORM_P2SH_P2WPKH)
+        p2wpkh_script_hash_batch(k->hashes[FORM_COMPRESSED], kb->count,
+                                 k->hashes[FORM_P2SH_P2WPKH]);
+    return 1;
+}
+
+/* A hit also goes to the results stream.  A compressed key hash is both a
+ * P2PKH and a P2WPKH address; the P2PKH one is named unless the targets are
+ * P2WPKH addresses only. */
+static void stream_hit(KeyStage *k, const KeyBatch *kb, size_t i, int form, const char *wif) {
+    address_type type = form == FORM_P2SH_P2WPKH ? ADDRESS_P2SH : ADDRESS_P2PKH;
+    SinkRecord r;
+
+    if (!k->w->sink)
+        return;
+    if (form == FORM_COMPRESSED && !(k->targets->types & 1U << ADDRESS_P2PKH))
+        type = ADDRESS_P2WPKH;
+    strcpy(r.wif, wif);
+    encode_bitcoin_address(type, k->hashes[form] + 20 * i, r.address);
+    memcpy(r.key, kb->keys[i], 32);
+    r.mode = work_to_string(configuration_get_work(k->w->config));
+    r.time = time(NULL);
+    sink_push(k->w->sink, &r);
+}
+
+/* Hash a batch and look it up; it is empty afterwards. */
+static void key_stage_run(KeyStage *k, KeyBatch *kb) {
+    key_stage_derive(k, kb);
+    if (kb->count && key_stage_hash(k, kb)) {
+        progress_add(&k->stats->evaluated, kb->count);
+        for (size_t i = 0; i < kb->count; ++i) {
+            const unsigned char *hash;
+            int form = 0;
+            long at = -1;
+            if (k->infinite[i])
+                continue;
+            for (; form < FORM_COUNT; form++) {
+                hash = k->hashes[form] + 20 * i;
+                if (k->forms >> form & 1 && (at = target_set_find(k->targets, hash)) >= 0)
+                    break;
+            }
+            if (form < FORM_COUNT) {
+                /* hits are rare, so their WIF is only encoded here, with the
+                 * flag of the key the address was made from */
+                char wif[WIF_CHARS_MAX + 1];
+                encode_wif(kb->keys[i], form != FORM_UNCOMPRESSED, wif);
+                if (worker_add_result(k->w, wif)) {
+                    stream_hit(k, kb, i, form, wif);
+                    progress_add(&k->stats->results, 1);
+                }
+                /* every target has its key, nothing left to look for; a
+                 * target found twice counts once */
+                if (worker_found_target(k->w, at) >= k->targets->count && kb->sched)
+                    scheduler_stop(kb->sched);
+            }
+        }
+    }
+    kb->count = 0;
+}
+
+/* Take back the batches the key stage is done with; with ``wait``, at least
+ * one. */
+static void batch_reclaim(CandidateBatch *b, int wait) {
+    KeyBatch *kb;
+    for (;;) {
+        while ((kb = ring_pop(&b->link->done)) != NULL) {
+            b->idle[b->idle_count++] = kb;
+            b->in_flight--;
+            wait = 0;
+        }
+        if (!wait)
+            return;
+        sched_yield();
+    }
+}
 
+/* Hand the points queued so far to the key stage, or run it here. */
+static void batch_points_flush(CandidateBatch *b) {
+    if (b->keys->count == 0)
+        return;
+    b->keys->sched = b->sched;
+    if (!b->link) {
+        key_stage_run(&b->stage, b->keys);
+        return;
+    }
+    /* the ring holds every batch, the push cannot fail */
+    ring_push(&b->link->full, b->keys);
+    b->in_flight++;
+    batch_reclaim(b, b->idle_count == 0);
+    b->keys = b->idle[--b->idle_count];
+}
+
+/* At the end of a range everything of it has been looked up, so that a
+ * checkpoint never counts a range whose hits are still on their way. */
+static void batch_flush(CandidateBatch *b) {
+    batch_check_flush(b);
+    batch_points_flush(b);
+    while (b->link && b->in_flight)
+        batch_reclaim(b, 1);
+}
+
+static ec_point *batch_slot(CandidateBatch *b, const unsigned char *priv_key) {
+    KeyBatch *kb = b->keys;
+    memcpy(kb->keys[kb->count], priv_key, 32);
+    kb->derive[kb->count] = 0;
+    return &kb->points[kb->count];
+}
+
+/* Only the points: the checksum queues flush themselves, and one may be
+ * handing out its survivors right now. */
+static void batch_commit(CandidateBatch *b) {
+    if (++b->keys->count == CANDIDATE_BATCH_SIZE)
+        batch_points_flush(b);
+}
+
+/* key = big-endian 32 byte number + 1 */
+static void key_increment(unsigned char *key) {
+    for (int i = 31; i >= 0 && ++key[i] == 0; --i)
+        ;
+}
+
+/* The point is left to the key stage. */
+static void batch_add_key(CandidateBatch *b, const unsigned char *priv_key) {
+    batch_slot(b, priv_key);
+    b->keys->derive[b->keys->count] = 1;
+    batch_commit(b);
+}
+
+static void work_thread(CandidateBatch *b, const char *suspect) {
     unsigned char priv_key[32];
     int compressed = 0;
     if (!decode_wif(suspect, priv_key, &compressed))
-        return NULL;
+        return;
+    batch_add_key(b, priv_key);
+}
 
-    unsigned char suspect_hash[20];
-    if (!generate_pubkey_hash_from_privkey(priv_key, suspect_hash))
-        return NULL;
+typedef struct KeyThread KeyThread;
 
-    if (memcmp(target_hash, suspect_hash, 20) == 0) {
-        worker_add_result(w, suspect);
-        //worker_result_to_file_partial(w, suspect);
-        return strdup(suspect);
-    }
+/* State shared by the threads of one solver run.  Everything indexed by
+ * thread is only touched by that thread. */
+typedef struct {
+    Worker *w;
+    int threads;
+    CandidateBatch **batches;
+    int key_thread_count; /* key stage threads, 0: each solver thread is its own */
+    KeyLink *links;     /* per solver thread, on cache lines of their own */
+    KeyThread *key_threads;
+    ProgressCounters *key_stats; /* per key stage thread, kept over the runs */
+    int key_stop;
+    WalkTables *tables; /* walk solvers */
+    WalkState *states;
+    WeightedTables *weighted; /* walk solvers with weighted hints */
+    WeightedState *wstates;
+    int ordered;        /* likeliest ranks first, see scheduler_order_ranges() */
+    JumpTables *jump;   /* JUMP */
+    uint64_t root;      /* JUMP: rank the search starts or resumes from */
+    const char *wif;    /* ROTATE, END */
+    wif_num num;        /* ROTATE: value of the WIF, END: first private key */
+    ec_point g;         /* END: generator, to step from key to key */
+    uint64_t total;     /* END: number of keys */
+    int missing;        /* END: characters after the prefix */
+    const char *end_chars[WIF_CHARS_MAX]; /* END: hint set per missing character or NULL */
+    int filter;         /* END: some hint set is narrower than the alphabet */
+    wif_num pow58[WIF_CHARS_MAX];
+    int digit[WIF_CHARS_MAX];
+    int bad;            /* position of a character outside of Base58 or -1 */
+    int depth;          /* ROTATE: number of wrong characters */
+    int npos;           /* ROTATE: positions that can be wrong, apart from bad */
+    int free_pos[WIF_CHARS_MAX];
+    uint64_t subs;      /* ROTATE: replacements per set of positions */
+    uint64_t span;      /* SEARCH, unknown checksum characters: 58^(top one + 1) */
+    uint64_t tail;      /* value of the known characters below it */
+    int tail_count;
+    uint64_t tail_pow[CHECKSUM_CHARS_COMPRESSED];
+    int tail_digit[CHECKSUM_CHARS_COMPRESSED];
+    const char *list;   /* LIST: candidate lines, a rank is a byte offset */
+    uint64_t list_size;
+    int stream;         /* LIST from standard input: nothing to checkpoint */
+    int stage;          /* scheduler run of the job, see Checkpoint */
+    /* written while the threads run, away from what they only read */
+    uint64_t lines __attribute__((aligned(64)));    /* LIST: lines checked */
+    /* JUMP, for the monitor only: every rank below it is done */
+    uint64_t position;
+    int position_known;
+} SolverJob;
+
+/* A key stage thread serves the solver threads i with i % count == index
+ * for the length of one scheduler run. */
+struct KeyThread {
+    SolverJob *job;
+    int index;
+    int cpu;            /* the next one after the solver threads', or -1 */
+    KeyStage stage;
+    pthread_t thread;
+};
 
+#define KEY_THREAD_NAP_NS 50000 /* sleep of an idle key stage thread */
+
+static void *key_thread_main(void *arg) {
+    KeyThread *t = arg;
+    SolverJob *job = t->job;
+    const struct timespec nap = {0, KEY_THREAD_NAP_NS};
+
+    topology_pin(t->cpu, NULL);
+    for (;;) {
+        int busy = 0;
+        for (int i = t->index; i < job->threads; i += job->key_thread_count) {
+            KeyLink *link = &job->links[i];
+            KeyBatch *kb;
+            while ((kb = ring_pop(&link->full)) != NULL) {
+                key_stage_run(&t->stage, kb);
+                ring_push(&link->done, kb);
+                busy = 1;
+            }
+        }
+        /* the solver threads have drained their batches before the stop */
+        if (!busy && __atomic_load_n(&job->key_stop, __ATOMIC_ACQUIRE))
+            break;
+        if (!busy)
+            nanosleep(&nap, NULL);
+    }
     return NULL;
 }
 
-static void set_loop(Worker *w, char *wif_buf, GuessPos *pos, int count,
-                     int ix, char **result, time_t *alive_time) {
-    if (*result)
+static void key_threads_stop(SolverJob *job, int started) {
+    __atomic_store_n(&job->key_stop, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < started; ++i) {
+        pthread_join(job->key_threads[i].thread, NULL);
+        ec_context_free(job->key_threads[i].stage.ctx);
+    }
+    free(job->key_threads);
+    job->key_threads = NULL;
+}
+
+/* The key stages hash with the forms of the solver threads' own stage.
+ * Each is set up on its own CPU, so that its scratch space is local. */
+static int key_threads_start(SolverJob *job) {
+    int started = 0;
+    job->key_stop = 0;
+    job->key_threads = calloc(job->key_thread_count, sizeof(KeyThread));
+    if (!job->key_threads)
+        return 0;
+    for (; started < job->key_thread_count; ++started) {
+        KeyThread *t = &job->key_threads[started];
+        TopologyMask old;
+        int pinned, ok;
+        t->job = job;
+        t->index = started;
+        t->cpu = topology_cpu(topology_get(), job->threads + started);
+        pinned = topology_pin(t->cpu, &old);
+        t->stage = job->batches[0]->stage;
+        t->stage.stats = &job->key_stats[started];
+        t->stage.ctx = ec_context_create();
+        ok = t->stage.ctx && ec_context_reserve(t->stage.ctx, CANDIDATE_BATCH_SIZE);
+        if (pinned)
+            topology_unpin(&old);
+        if (!ok || pthread_create(&t->thread, NULL, key_thread_main, t) != 0) {
+            ec_context_free(t->stage.ctx);
+            key_threads_stop(job, started);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void job_free(SolverJob *job) {
+    if (job->states) {
+        for (int i = 0; i < job->threads; ++i)
+            walk_state_clear(&job->states[i]);
+        free(job->states);
+    }
+    walk_tables_free(job->tables);
+    weighted_tables_free(job->weighted);
+    free(job->wstates);
+    jump_tables_free(job->jump);
+    ec_point_clear(&job->g);
+    if (job->batches) {
+        for (int i = 0; i < job->threads; ++i)
+            batch_free(job->batches[i]);
+        free(job->batches);
+    }
+    free(job->links);
+    free(job->key_stats);
+}
+
+/* With key stage threads, each solver thread gets a pair of rings to one
+ * of them and keeps its other batches idle. */
+static int job_link(SolverJob *job, int count) {
+    job->key_thread_count = count < job->threads ? count : job->threads;
+    job->links = calloc_lines(job->threads, sizeof(KeyLink));
+    job->key_stats = calloc_lines(job->key_thread_count, sizeof(ProgressCounters));
+    if (!job->links || !job->key_stats)
+        return 0;
+    for (int i = 0; i < job->threads; ++i) {
+        CandidateBatch *b = job->batches[i];
+        b->link = &job->links[i];
+        for (int k = 1; k < KEY_PIPELINE_DEPTH; ++k)
+            b->idle[b->idle_count++] = b->pool[k];
+    }
+    return 1;
+}
+
+static int job_init(SolverJob *job, Worker *w) {
+    const Topology *topo = topology_get();
+    char quota[32] = "none";
+    memset(job, 0, sizeof(*job));
+    job->w = w;
+    job->threads = scheduler_thread_count(w->config);
+    job->batches = calloc(job->threads, sizeof(CandidateBatch *));
+    if (!job->batches)
+        return 0;
+    /* each batch is made on the CPU of its thread: its pages come from the
+     * node they are used on */
+    for (int i = 0; i < job->threads; ++i) {
+        TopologyMask old;
+        int pinned = topology_pin(topology_cpu(topo, i), &old);
+        job->batches[i] = batch_create(w);
+        if (pinned)
+            topology_unpin(&old);
+        if (!job->batches[i]) {
+            job_free(job);
+            return 0;
+        }
+    }
+    if (!ec_point_init(job->batches[0]->ctx, &job->g) ||
+        (configuration_get_key_threads(w->config) > 0 &&
+         !job_link(job, configuration_get_key_threads(w->config)))) {
+        job_free(job);
+        return 0;
+    }
+    if (job->key_thread_count)
+        printf("Using %d threads, %d for public keys\n", job->threads, job->key_thread_count);
+    else
+        printf("Using %d threads\n", job->threads);
+    if (topo->quota > 0)
+        snprintf(quota, sizeof(quota), "%.2f CPUs", topo->quota);
+    printf("Host: %d cores, %d logical CPUs, %d NUMA nodes, CPU quota %s\n", topo->cores,
+           topo->cpus, topo->nodes, quota);
+    return 1;
+}
+
+#define MONITOR_TICK_MS 200
+
+/* Write the ranges left to do and the results so far.  The scheduler must
+ * be paused, so that no range is half done. */
+static void job_save(SolverJob *job, Scheduler *s, uint64_t total) {
+    Worker *w = job->w;
+    Checkpoint c = {{0}, job->stage, total, NULL, 0, NULL, 0};
+    memcpy(c.config, w->config_hash, sizeof(c.config));
+    c.ranges = scheduler_remaining(s, &c.range_count);
+    pthread_mutex_lock(&w->result_lock);
+    c.results = w->results;
+    c.result_count = w->result_count;
+    checkpoint_save(configuration_get_checkpoint_file(w->config), &c);
+    pthread_mutex_unlock(&w->result_lock);
+    free(c.ranges);
+}
+
+typedef struct {
+    SolverJob *job;
+    uint64_t total;
+    scheduler_range_fn fn;
+    uint64_t share;       /* ranks of this shard */
+    uint64_t done;        /* of them, done by an earlier run */
+    uint64_t tried;       /* counters of the threads at the start */
+    struct timespec start;
+} JobRun;
+
+static double seconds_since(const struct timespec *t) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - t->tv_sec) + (double)(now.tv_nsec - t->tv_nsec) * 1e-9;
+}
+
+static uint64_t job_tried(const SolverJob *job) {
+    ProgressCounters c = {0, 0, 0, 0};
+    for (int i = 0; i < job->threads; ++i)
+        progress_sum(&c, &job->batches[i]->stats);
+    return c.tried;
+}
+
+static void job_counters(const SolverJob *job, ProgressCounters *c) {
+    for (int i = 0; i < job->threads; ++i)
+        progress_sum(c, &job->batches[i]->stats);
+    for (int i = 0; i < job->key_thread_count; ++i)
+        progress_sum(c, &job->key_stats[i]);
+}
+
+/* Add up the counters of the threads; they only move at the end of each
+ * range, so the report lags by at most a range per thread. */
+static void job_report(const JobRun *run, ProgressReport *r) {
+    const SolverJob *job = run->job;
+    uint64_t tried;
+    memset(r, 0, sizeof(*r));
+    job_counters(job, &r->counters);
+    tried = r->counters.tried - run->tried;
+    r->total = run->share;
+    r->done = run->done + tried < run->share ? run->done + tried : run->share;
+    r->stage = job->stage;
+    r->threads = job->threads;
+    r->elapsed = seconds_since(&run->start);
+    r->rate = r->elapsed > 0 ? (double)tried / r->elapsed : 0;
+}
+
+/* JUMP restarts from a rank below which everything is done: the lowest one
+ * the scheduler has left, not the last one a thread ran, as threads take
+ * seeds and steal ranges from all over the keyspace. */
+static void job_track_position(SolverJob *job, Scheduler *s) {
+    uint64_t first = 0;
+    scheduler_pause(s);
+    job->position_known = scheduler_first_remaining(s, &first);
+    job->position = job->root + first;
+    scheduler_resume(s);
+}
+
+static void job_print_progress(const JobRun *run, Scheduler *s) {
+    ProgressReport r;
+    job_report(run, &r);
+    progress_print(stdout, &r);
+    if (!run->job->jump)
+        return;
+    /* the WIF to put on the status line to restart JUMP from here; it is
+     * taken afresh, a stale one could lie above ranks still to do */
+    job_track_position(run->job, s);
+    if (run->job->position_known) {
+        char wif[WIF_CHARS_MAX + 1];
+        wif_num num;
+        jump_value(run->job->jump, run->job->position, &num);
+        wif_num_to_base58(&num, wif, run->job->jump->len);
+        printf("Alive! %s\n", wif);
+    }
+}
+
+static void job_write_metrics(const JobRun *run) {
+    const char *path = configuration_get_metrics_file(run->job->w->config);
+    ProgressReport r;
+    if (!path)
+        return;
+    job_report(run, &r);
+    progress_write_metrics(path, &r);
+}
+
+static void job_run_range(Scheduler *s, int thread, uint64_t begin, uint64_t end, void *arg) {
+    JobRun *run = arg;
+    run->fn(s, thread, begin, end, run->job);
+}
+
+/* Report progress and write the metrics file every period, and both at
+ * once on SIGUSR1.  Checkpoint every period; on SIGINT, SIGTERM or at the
+ * deadline, write a last one and stop the run. */
+static void job_monitor(Scheduler *s, void *arg) {
+    JobRun *run = arg;
+    Worker *w = run->job->w;
+    const char *checkpoint = configuration_get_checkpoint_file(w->config);
+    int save = checkpoint && !run->job->stream;
+    int period = configuration_get_checkpoint_period(w->config);
+    int progress = configuration_get_progress_period(w->config);
+    int metrics = configuration_get_metrics_period(w->config);
+    time_t last = time(NULL), last_progress = last, last_metrics = last;
+
+    while (scheduler_sleep(s, MONITOR_TICK_MS)) {
+        time_t now = time(NULL);
+        int quit = (checkpoint || w->deadline) &&
+                   (checkpoint_signalled() || (w->deadline && now >= w->deadline));
+        int requested = progress_requested();
+        if (requested || (progress > 0 && now - last_progress >= progress)) {
+            job_print_progress(run, s);
+            last_progress = now;
+        }
+        if (requested || now - last_metrics >= metrics) {
+            job_write_metrics(run);
+            last_metrics = now;
+        }
+        if (!quit && (!save || period <= 0 || now - last < period))
+            continue;
+        scheduler_pause(s);
+        if (save)
+            job_save(run->job, s, run->total);
+        if (quit) {
+            w->interrupted = 1;
+            scheduler_stop(s);
+        }
+        scheduler_resume(s);
+        last = now;
+        if (quit)
+            break;
+    }
+}
+
+/* Run ``fn`` over the ranks [0, total) of the current stage, or the share
+ * of them of this shard, or over what a checkpoint of that stage left to
+ * do.  Stages before the checkpoint's were finished already and are
+ * skipped.  Returns 0 if the stage did not run. */
+static int job_run(SolverJob *job, uint64_t total, scheduler_range_fn fn) {
+    Worker *w = job->w;
+    JobRun run = {job, total, fn, 0, 0, 0, {0, 0}};
+    int shards = configuration_get_shard_count(w->config);
+    SchedulerRange all;
+    const SchedulerRange *ranges = &all;
+    SchedulerRange *ordered = NULL;
+    size_t count = 1;
+
+    if (w->interrupted)
+        return 0;
+    shard_range(total, configuration_get_shard_index(w->config), shards, &all);
+    if (shards > 1)
+        printf("Shard %d/%d: candidates %llu to %llu\n",
+               configuration_get_shard_index(w->config) + 1, shards,
+               (unsigned long long)all.begin, (unsigned long long)all.end);
+    if (w->resuming) {
+        if (w->resume.stage > job->stage)
+            return 0;
+        if (w->resume.stage == job->stage) {
+            uint64_t left = 0;
+            if (w->resume.total != total) {
+                fprintf(stderr, "Error: the checkpoint does not match the keyspace\n");
+                w->interrupted = 1;
+                return 0;
+            }
+            ranges = w->resume.ranges;
+            count = w->resume.range_count;
+            for (size_t i = 0; i < count; ++i)
+                left += ranges[i].end - ranges[i].begin;
+            run.done = all.end - all.begin > left ? all.end - all.begin - left : 0;
+            printf("Resuming: %llu of %llu candidates left\n", (unsigned long long)left,
+                   (unsigned long long)total);
+        }
+        w->resuming = 0;
+    }
+    if (job->ordered) {
+        ordered = scheduler_order_ranges(ranges, count, job->threads, &count);
+        if (!ordered) {
+            w->interrupted = 1;
+            return 0;
+        }
+        ranges = ordered;
+    }
+    if (job->key_thread_count && !key_threads_start(job)) {
+        free(ordered);
+        w->interrupted = 1;
+        return 0;
+    }
+    run.share = all.end - all.begin;
+    run.tried = job_tried(job);
+    clock_gettime(CLOCK_MONOTONIC, &run.start);
+    scheduler_run_ranges(ranges, count, job->threads, job_run_range, job_monitor, &run);
+    if (job->key_thread_count)
+        key_threads_stop(job, job->key_thread_count);
+    free(ordered);
+    job_write_metrics(&run);
+    w->tried += job_tried(job) - run.tried;
+    w->elapsed += seconds_since(&run.start);
+    return 1;
+}
+
+static void walk_range(Scheduler *s, int thread, uint64_t begin, uint64_t end, void *arg) {
+    SolverJob *job = arg;
+    CandidateBatch *b = job->batches[thread];
+    WalkState *state = &job->states[thread];
+    uint64_t i;
+
+    b->sched = s;
+    if (!walk_state_seek(state, b->ctx, begin))
+        return;
+    for (i = begin;;) {
+        batch_check(b, &state->num);
+        if (++i == end || ((i & STOP_POLL_MASK) == 0 && scheduler_stopped(s)))
+            break;
+        if (!walk_next(state, b->ctx))
+            break;
+    }
+    batch_flush(b);
+    progress_add(&b->stats.tried, i - begin);
+}
+
+static void weighted_range(Scheduler *s, int thread, uint64_t begin, uint64_t end, void *arg) {
+    SolverJob *job = arg;
+    CandidateBatch *b = job->batches[thread];
+    WeightedState *state = &job->wstates[thread];
+    uint64_t i;
+
+    b->sched = s;
+    if (!weighted_state_seek(job->weighted, state, begin))
         return;
-    if (ix == count) {
-        *result = work_thread(w, wif_buf);
+    for (i = begin;;) {
+        batch_check(b, &state->num);
+        if (++i == end || ((i & STOP_POLL_MASK) == 0 && scheduler_stopped(s)))
+            break;
+        if (!weighted_next(job->weighted, state))
+            break;
+    }
+    batch_flush(b);
+    progress_add(&b->stats.tried, i - begin);
+}
+
+/* With weights on some hint set, the same keyspace in best-first order:
+ * cost layer by cost layer, each rank unranked directly (see weighted.h),
+ * and the threads kept together on the likeliest ranks. */
+static void weighted_positions(Worker *w, const char *wif, const GuessPos *pos, int count) {
+    SolverJob job;
+    if (!job_init(&job, w))
+        return;
+
+    job.weighted = weighted_tables_create(wif, pos, count);
+    job.wstates = calloc_lines(job.threads, sizeof(WeightedState));
+    if (!job.weighted || !job.wstates) {
+        job_free(&job);
         return;
     }
+    job.ordered = 1;
+    printf("Trying %llu candidates, likeliest first\n",
+           (unsigned long long)weighted_keyspace(job.weighted));
+    job_run(&job, weighted_keyspace(job.weighted), weighted_range);
+    job_free(&job);
+}
 
-    int position = pos[ix].index;
-    time_t now = time(NULL);
-    if (now - *alive_time > STATUS_PERIOD / 1000) {
-        printf("Alive! %s %s", wif_buf, ctime(&now));
-        *alive_time = now;
+/* Walk tables and one walker per thread; returns the keyspace, 0 on
+ * failure. */
+static uint64_t walk_job_init(SolverJob *job, const char *wif, const GuessPos *pos, int count,
+                              int track_points) {
+    uint64_t total;
+    job->tables = walk_tables_create(job->batches[0]->ctx, wif, pos, count,
+                                     configuration_is_compressed(job->w->config), track_points);
+    job->states = calloc_lines(job->threads, sizeof(WalkState));
+    if (!job->tables || !job->states)
+        return 0;
+    total = walk_keyspace(job->tables);
+    if (total == 0) {
+        fprintf(stderr, "Error: too many unknown characters, keyspace exceeds 2^64\n");
+        return 0;
     }
+    for (int i = 0; i < job->threads; ++i)
+        if (!walk_state_init(&job->states[i], job->batches[i]->ctx, job->tables))
+            return 0;
+    return total;
+}
 
-    for (const char *p = pos[ix].chars; *p && !*result; ++p) {
-        wif_buf[position] = *p;
-        set_loop(w, wif_buf, pos, count, ix + 1, result, alive_time);
+/* Walk every combination of the given positions in Gray order.  Each step
+ * updates the decoded payload with one precomputed digit delta, and only the
+ * roughly 1 in 2^32 candidates with a valid WIF checksum get a public key.
+ * The keyspace is split between threads by the work-stealing scheduler;
+ * every range starts with a jump to its first candidate. */
+static void walk_positions(Worker *w, const char *wif, const GuessPos *pos, int count) {
+    SolverJob job;
+    uint64_t total;
+    for (int i = 0; i < count; ++i) {
+        if (pos[i].weights) {
+            weighted_positions(w, wif, pos, count);
+            return;
+        }
     }
+    if (!job_init(&job, w))
+        return;
+    total = walk_job_init(&job, wif, pos, count, 0);
+    if (total)
+        job_run(&job, total, walk_range);
+    job_free(&job);
+}
+
+/* The unknown characters among the last CHECKSUM_CHARS of a full WIF only
+ * hold checksum bits (58^5 < 2^32, 58^6 < 2^40), so they are not walked: with
+ * them at '1', the real value of a candidate lies less than 2^shift above
+ * the key the walk tracks (the point follows with one addition per
+ * candidate) or the next key.  The checksum of each of those keys gives its
+ * whole WIF; only a key whose WIF is the candidate in every known character
+ * gets its public key, which also keeps the candidates of a payload
+ * position just above the checksum from checking the same key twice.  Hits
+ * come out with their real checksum. */
+static int dummy_key(SolverJob *job, const wif_num *num, int next, unsigned char *payload) {
+    const WalkTables *t = job->tables;
+    const wif_num one = {{1, 0, 0, 0, 0}};
+    size_t len = t->compressed ? WIF_PAYLOAD_MAX - 4 : WIF_PAYLOAD_MAX - 5;
+    /* the low bits of the real value: the 0x01 flag of compressed keys,
+     * then the checksum */
+    int64_t low = (int64_t)(num->v[0] & ((1ULL << t->shift) - 1));
+    int64_t diff = ((int64_t)next << t->shift) + (t->compressed ? 1LL << 32 : 0) +
+                   (int64_t)job->tail - low;
+    wif_num hi;
+
+    /* diff + checksum: the real value above the candidate's top characters */
+    if (diff >= (int64_t)job->span || diff + (1LL << 32) <= 0)
+        return 0;
+    wif_num_shr(&hi, num, t->shift);
+    if (next)
+        wif_num_add(&hi, &one);
+    wif_num_to_bytes(&hi, payload, 33);
+    payload[33] = 0x01;
+    diff += sha256d_checksum(payload, len);
+    if (diff < 0 || diff >= (int64_t)job->span)
+        return 0;
+    for (int i = 0; i < job->tail_count; ++i)
+        if ((uint64_t)diff / job->tail_pow[i] % BASE58_ALPHABET_LEN != (uint64_t)job->tail_digit[i])
+            return 0;
+    return 1;
+}
+
+static void dummy_range(Scheduler *s, int thread, uint64_t begin, uint64_t end, void *arg) {
+    SolverJob *job = arg;
+    CandidateBatch *b = job->batches[thread];
+    WalkState *state = &job->states[thread];
+    unsigned char payload[34];
+    uint64_t i;
+
+    b->sched = s;
+    if (!walk_state_seek(state, b->ctx, begin))
+        return;
+    for (i = begin;;) {
+        if (dummy_key(job, &state->num, 0, payload) &&
+            ec_point_copy(batch_slot(b, payload + 1), &state->point))
+            batch_commit(b);
+        if (dummy_key(job, &state->num, 1, payload) &&
+            ec_point_add(b->ctx, batch_slot(b, payload + 1), &state->point, &job->g))
+            batch_commit(b);
+        if (++i == end || ((i & STOP_POLL_MASK) == 0 && scheduler_stopped(s)))
+            break;
+        if (!walk_next(state, b->ctx))
+            break;
+    }
+    batch_flush(b);
+    progress_add(&b->stats.tried, i - begin);
+}
+
+/* ``wif`` is full length; the unknown characters of its last ``window`` are
+ * derived, ``pos`` are the others. */
+static void dummy_positions(Worker *w, const char *wif, const GuessPos *pos, int count, int window) {
+    SolverJob job;
+    const unsigned char one = 1;
+    char buf[WIF_CHARS_MAX + 1];
+    int len = (int)strlen(wif), top = -1;
+    uint64_t total, pow = 1;
+
+    for (int i = 0; i < count; ++i) {
+        if (pos[i].weights) {
+            printf("Hint weights are not used with unknown checksum characters\n");
+            break;
+        }
+    }
+    if (!job_init(&job, w))
+        return;
+    memcpy(buf, wif, len + 1);
+    for (int e = 0; e < window; ++e) {
+        char *c = &buf[len - 1 - e];
+        if (*c == UNKNOWN_CHAR) {
+            *c = '1';
+            top = e;
+        }
+    }
+    /* the known characters below the top unknown one */
+    for (int e = 0; e <= top; ++e, pow *= BASE58_ALPHABET_LEN) {
+        int d = base58_digit(wif[len - 1 - e]);
+        if (wif[len - 1 - e] != UNKNOWN_CHAR && d >= 0) {
+            job.tail += (uint64_t)d * pow;
+            job.tail_pow[job.tail_count] = pow;
+            job.tail_digit[job.tail_count++] = d;
+        }
+    }
+    job.span = pow;
+    total = walk_job_init(&job, buf, pos, count, 1);
+    if (total && ec_point_set_scalar(job.batches[0]->ctx, &job.g, &one, 1, 0) &&
+        ec_points_normalize(job.batches[0]->ctx, &job.g, 1)) {
+        printf("Unknown checksum characters are derived from the key, %llu candidates\n",
+               (unsigned long long)total);
+        job_run(&job, total, dummy_range);
+    }
+    job_free(&job);
 }
 
 static void perform_work_alike(Worker *w) {
@@ -153,30 +1134,22 @@ static void perform_work_alike(Worker *w) {
         return;
 
     int len = (int)strlen(orig_wif);
-    char *buf = strdup(orig_wif);
-    if (!buf)
-        return;
-
-    GuessPos positions[128];
+    GuessPos positions[WALK_MAX_POSITIONS];
     int count = 0;
 
-    for (int i = 0; i < len && count < 128; ++i) {
+    for (int i = 0; i < len && count < WALK_MAX_POSITIONS; ++i) {
         for (guess_entry *ge = w->config->guess; ge; ge = ge->next) {
             if (strchr(ge->chars, orig_wif[i])) {
                 positions[count].index = i;
                 positions[count].chars = ge->chars;
+                positions[count].weights = ge->weights;
                 count++;
                 break;
             }
         }
     }
 
-    time_t alive = time(NULL);
-    char *result = NULL;
-    set_loop(w, buf, positions, count, 0, &result, &alive);
-    free(buf);
-    if (result)
-        free(result);
+    walk_positions(w, orig_wif, positions, count);
 }
 
 static void perform_work_search(Worker *w) {
@@ -185,35 +1158,135 @@ static void perform_work_search(Worker *w) {
         return;
 
     int len = (int)strlen(orig_wif);
-    char *buf = strdup(orig_wif);
-    if (!buf)
-        return;
-
-    GuessPos positions[128];
-    int count = 0;
+    int compressed = configuration_is_compressed(w->config);
+    GuessPos positions[WALK_MAX_POSITIONS];
+    int count = 0, dummy = 0;
+    /* unknown checksum characters of a full WIF are derived, not walked */
+    int window = len == (compressed ? COMPRESSED_WIF_LENGTH : COMPRESSED_WIF_LENGTH - 1)
+                     ? configuration_get_checksum_chars(compressed) : 0;
     guess_entry *ge = w->config->guess;
-    for (int i = 0; i < len && count < 128; ++i) {
-        if (buf[i] == UNKNOWN_CHAR) {
+
+    for (int i = 0; i < len && count < WALK_MAX_POSITIONS; ++i) {
+        if (orig_wif[i] == UNKNOWN_CHAR && i >= len - window) {
+            dummy = 1;
+            if (ge)
+                ge = ge->next;
+        } else if (orig_wif[i] == UNKNOWN_CHAR) {
             positions[count].index = i;
+            positions[count].chars = BASE58_ALPHABET;
+            positions[count].weights = NULL;
             if (ge) {
-                if (strcmp(ge->chars, "*") == 0)
-                    positions[count].chars = BASE58_ALPHABET;
-                else
+                if (strcmp(ge->chars, "*") != 0) {
                     positions[count].chars = ge->chars;
+                    positions[count].weights = ge->weights;
+                }
                 ge = ge->next;
-            } else {
-                positions[count].chars = BASE58_ALPHABET;
             }
             count++;
         }
     }
 
-    time_t alive = time(NULL);
-    char *result = NULL;
-    set_loop(w, buf, positions, count, 0, &result, &alive);
-    free(buf);
-    if (result)
-        free(result);
+    if (dummy)
+        dummy_positions(w, orig_wif, positions, count, window);
+    else
+        walk_positions(w, orig_wif, positions, count);
+}
+
+/* The prefix fixes the top of the Base58 value, so the payload (version
+ * byte, key and compression flag) lies in one interval and every key in it
+ * can simply be checksummed and encoded; the trailing characters that only
+ * carry the checksum are never enumerated, and no payload is tried twice. */
+int worker_end_key_range(const char *prefix, int missing, int compressed, wif_num *first,
+                         uint64_t *count) {
+    static const wif_num version = {{0, 0, 0, 0, 0x80}};
+    static const wif_num max_key = {{0xBFD25E8CD0364140ULL, 0xBAAEDCE6AF48A03BULL,
+                                     0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL, 0x80}};
+    const wif_num one = {{1, 0, 0, 0, 0}};
+    size_t len = strlen(prefix);
+    char buf[WIF_CHARS_MAX + 1];
+    wif_num lo, hi, min_key = version;
+
+    *count = 0;
+    if (len + missing > WIF_CHARS_MAX)
+        return 1;
+    memcpy(buf, prefix, len);
+    buf[len + missing] = '\0';
+    memset(buf + len, '1', missing);
+    if (!wif_num_from_base58(&lo, buf))
+        return 1;
+    memset(buf + len, 'z', missing);
+    wif_num_from_base58(&hi, buf);
+
+    /* drop the checksum, then the compression flag, which has to be 0x01 */
+    wif_num_shr(&lo, &lo, 32);
+    wif_num_shr(&hi, &hi, 32);
+    if (compressed) {
+        int lo_flag = (int)(lo.v[0] & 0xFF), hi_flag = (int)(hi.v[0] & 0xFF);
+        wif_num_shr(&lo, &lo, 8);
+        wif_num_shr(&hi, &hi, 8);
+        if (lo_flag > 0x01)
+            wif_num_add(&lo, &one);
+        if (hi_flag < 0x01)
+            wif_num_sub(&hi, &one);
+    }
+    /* keys 1 .. n-1 behind the 0x80 version byte */
+    wif_num_add(&min_key, &one);
+    if (wif_num_cmp(&lo, &min_key) < 0)
+        lo = min_key;
+    if (wif_num_cmp(&hi, &max_key) > 0)
+        hi = max_key;
+    if (wif_num_cmp(&lo, &hi) > 0)
+        return 1;
+    wif_num_sub(&hi, &lo);
+    if (hi.v[1] || hi.v[2] || hi.v[3] || hi.v[4] || hi.v[0] == UINT64_MAX)
+        return 0;
+    *count = hi.v[0] + 1;
+    *first = lo;
+    wif_num_sub(first, &version);
+    return 1;
+}
+
+/* Keys of END follow one another, so the public key follows with one point
+ * addition per candidate.  Only the first and last key of the job can
+ * encode to a WIF outside of the prefix (their checksum may push the value
+ * past the interval), and hint sets for the missing characters need every
+ * candidate re-encoded; everything else goes straight to the hash batch. */
+static void end_range(Scheduler *s, int thread, uint64_t begin, uint64_t end, void *arg) {
+    SolverJob *job = arg;
+    CandidateBatch *b = job->batches[thread];
+    size_t prefix = strlen(job->wif);
+    unsigned char key[32];
+    wif_num first = job->num, offset = {{begin, 0, 0, 0, 0}};
+    ec_point cur;
+    uint64_t r;
+
+    b->sched = s;
+    wif_num_add(&first, &offset);
+    wif_num_to_bytes(&first, key, sizeof(key));
+    if (!ec_point_init(b->ctx, &cur) || !ec_point_set_scalar(b->ctx, &cur, key, sizeof(key), 0)) {
+        ec_point_clear(&cur);
+        return;
+    }
+    for (r = begin; r < end; ++r) {
+        int keep = 1;
+        if (job->filter || r == 0 || r == job->total - 1) {
+            char wif[WIF_CHARS_MAX + 1];
+            encode_wif(key, b->compressed, wif);
+            keep = strncmp(wif, job->wif, prefix) == 0;
+            for (int k = 0; keep && k < job->missing; ++k)
+                keep = !job->end_chars[k] || strchr(job->end_chars[k], wif[prefix + k]);
+        }
+        if (keep && ec_point_copy(batch_slot(b, key), &cur))
+            batch_commit(b);
+        if ((r & STOP_POLL_MASK) == 0 && scheduler_stopped(s))
+            break;
+        if (!ec_point_add(b->ctx, &cur, &cur, &job->g))
+            break;
+        key_increment(key);
+    }
+    ec_point_clear(&cur);
+    batch_flush(b);
+    progress_add(&b->stats.tried, (r < end ? r + 1 : end) - begin);
 }
 
 static void perform_work_end(Worker *w) {
@@ -221,65 +1294,441 @@ static void perform_work_end(Worker *w) {
     if (!orig_wif)
         return;
 
+    int compressed = configuration_is_compressed(w->config);
     int len_base = (int)strlen(orig_wif);
-    int expected_len = configuration_is_compressed(w->config) ? COMPRESSED_WIF_LENGTH : 51;
+    int expected_len = compressed ? COMPRESSED_WIF_LENGTH : 51;
     int missing = expected_len - len_base;
     if (missing <= 0) {
-        work_thread(w, orig_wif);
+        CandidateBatch *b = batch_create(w);
+        if (!b)
+            return;
+        work_thread(b, orig_wif);
+        batch_flush(b);
+        batch_free(b);
         return;
     }
-    char *buf = malloc(expected_len + 1);
-    if (!buf)
-        return;
-    memcpy(buf, orig_wif, len_base);
-    buf[expected_len] = '\0';
 
-    GuessPos positions[16];
+    GuessPos positions[WALK_MAX_POSITIONS];
     guess_entry *ge = w->config->guess;
-    for (int i = 0; i < missing && i < 16; ++i) {
+    double walk_count = 1;
+    SolverJob job;
+    const unsigned char one = 1;
+    wif_num first = {{0, 0, 0, 0, 0}};
+    uint64_t count;
+
+    for (int i = 0; i < missing; ++i) {
         positions[i].index = len_base + i;
+        positions[i].chars = BASE58_ALPHABET;
+        positions[i].weights = NULL;
         if (ge) {
-            positions[i].chars = ge->chars;
+            if (strcmp(ge->chars, "*") != 0) {
+                positions[i].chars = ge->chars;
+                positions[i].weights = ge->weights;
+            }
             ge = ge->next;
-        } else {
-            positions[i].chars = BASE58_ALPHABET;
         }
-        buf[len_base + i] = positions[i].chars[0];
+        walk_count *= (double)strlen(positions[i].chars);
     }
 
-    time_t alive = time(NULL);
-    char *result = NULL;
-    set_loop(w, buf, positions, missing, 0, &result, &alive);
-    free(buf);
-    if (result)
-        free(result);
+    if (!worker_end_key_range(orig_wif, missing, compressed, &first, &count)) {
+        fprintf(stderr, "Error: too many missing characters, keyspace exceeds 2^64\n");
+        return;
+    }
+    /* narrow hints can leave fewer strings to try than keys */
+    if (walk_count < (double)count) {
+        char *buf = malloc(expected_len + 1);
+        if (!buf)
+            return;
+        memcpy(buf, orig_wif, len_base);
+        for (int i = 0; i < missing; ++i)
+            buf[len_base + i] = positions[i].chars[0];
+        buf[expected_len] = '\0';
+        walk_positions(w, buf, positions, missing);
+        free(buf);
+        return;
+    }
+    if (count == 0) {
+        printf("No private key matches the prefix\n");
+        return;
+    }
+
+    if (!job_init(&job, w))
+        return;
+    job.wif = orig_wif;
+    job.num = first;
+    job.total = count;
+    job.missing = missing;
+    for (int i = 0; i < missing; ++i) {
+        job.end_chars[i] = positions[i].chars == BASE58_ALPHABET ? NULL : positions[i].chars;
+        job.filter |= job.end_chars[i] != NULL;
+    }
+    if (!ec_point_set_scalar(job.batches[0]->ctx, &job.g, &one, 1, 0) ||
+        !ec_points_normalize(job.batches[0]->ctx, &job.g, 1)) {
+        job_free(&job);
+        return;
+    }
+    printf("Checking %llu keys\n", (unsigned long long)count);
+    job_run(&job, count, end_range);
+    job_free(&job);
+}
+
+static uint64_t BINOM[WIF_CHARS_MAX + 1][WIF_CHARS_MAX + 1];
+
+static void binom_init(void) {
+    for (int n = 0; n <= WIF_CHARS_MAX; ++n) {
+        BINOM[n][0] = 1;
+        for (int k = 1; k <= n; ++k)
+            BINOM[n][k] = BINOM[n - 1][k - 1] + (k < n ? BINOM[n - 1][k] : 0);
+    }
+}
+
+/* num += diff * 58^p, for a digit change at position p */
+static void rotate_delta(const SolverJob *job, wif_num *num, int p, int diff) {
+    wif_num delta = job->pow58[p];
+    wif_num_mul_word(&delta, (uint64_t)(diff > 0 ? diff : -diff));
+    if (diff > 0)
+        wif_num_add(num, &delta);
+    else
+        wif_num_sub(num, &delta);
+}
+
+/* Candidate of ROTATE at ``rank``: rank / subs picks the set of wrong
+ * positions in colexicographic order, so every unordered set comes exactly
+ * once, and rank % subs the replacement of each, the last position moving
+ * fastest.  A position never takes its own digit back, so sets of different
+ * sizes never overlap either.  Returns the number of positions. */
+static int rotate_seek(const SolverJob *job, uint64_t rank, int *pos, int *digit, wif_num *num) {
+    uint64_t combo = rank / job->subs, sub = rank % job->subs;
+    int m = job->depth - (job->bad >= 0);
+    int count = m;
+
+    for (int i = m; i >= 1; --i) {
+        int a = i - 1;
+        while (a + 1 < job->npos && BINOM[a + 1][i] <= combo)
+            ++a;
+        combo -= BINOM[a][i];
+        pos[i - 1] = job->free_pos[a];
+    }
+    /* with a character outside of Base58, that position is always wrong */
+    if (job->bad >= 0)
+        pos[count++] = job->bad;
+
+    *num = job->num;
+    for (int i = count - 1; i >= 0; --i) {
+        int p = pos[i];
+        int radix = p == job->bad ? BASE58_ALPHABET_LEN : BASE58_ALPHABET_LEN - 1;
+        int j = (int)(sub % (uint64_t)radix);
+        sub /= (uint64_t)radix;
+        digit[i] = p == job->bad || j < job->digit[p] ? j : j + 1;
+        rotate_delta(job, num, p, digit[i] - job->digit[p]);
+    }
+    return count;
 }
 
+static void rotate_range(Scheduler *s, int thread, uint64_t begin, uint64_t end, void *arg) {
+    SolverJob *job = arg;
+    CandidateBatch *b = job->batches[thread];
+    int pos[WIF_CHARS_MAX], digit[WIF_CHARS_MAX];
+    wif_num num;
+    int last = rotate_seek(job, begin, pos, digit, &num) - 1;
+    uint64_t r;
+
+    b->sched = s;
+    for (r = begin;;) {
+        int p = pos[last], d = digit[last] + 1;
+        batch_check(b, &num);
+        if (++r == end || ((r & STOP_POLL_MASK) == 0 && scheduler_stopped(s)))
+            break;
+        /* step the last position to its next replacement; once it wraps
+         * around, the other positions move and the value is rebuilt */
+        if (p != job->bad && d == job->digit[p])
+            ++d;
+        if (d >= BASE58_ALPHABET_LEN) {
+            rotate_seek(job, r, pos, digit, &num);
+            continue;
+        }
+        rotate_delta(job, &num, p, d - digit[last]);
+        digit[last] = d;
+    }
+    batch_flush(b);
+    progress_add(&b->stats.tried, r - begin);
+}
+
+/* Try every WIF that differs from the given one in exactly 1, 2, ... up to
+ * ``depth`` characters (the number after the comma on the WIF line),
+ * stopping after the first depth with a hit. */
 static void perform_work_rotate(Worker *w) {
     const char *orig_wif = configuration_get_wif(w->config);
+    const char *status = configuration_get_wif_status(w->config);
+    SolverJob job;
+    int len, max_depth = 1;
+    if (!orig_wif || (len = (int)strlen(orig_wif)) > WIF_CHARS_MAX)
+        return;
+    if (status && *status) {
+        char *end;
+        long d = strtol(status, &end, 10);
+        if (*end == '\0' && d >= 1 && d <= len)
+            max_depth = (int)d;
+    }
+    if (!job_init(&job, w))
+        return;
+    binom_init();
+    job.bad = -1;
+    for (int i = 0; i < len; ++i) {
+        wif_num d = {{0, 0, 0, 0, 0}};
+        job.digit[i] = base58_digit(orig_wif[i]);
+        if (job.digit[i] < 0) {
+            if (job.bad >= 0) {
+                fprintf(stderr, "Error: more than one character outside of Base58\n");
+                job_free(&job);
+                return;
+            }
+            job.bad = i;
+            job.digit[i] = 0;
+        } else {
+            job.free_pos[job.npos++] = i;
+        }
+        d.v[0] = (uint64_t)job.digit[i];
+        wif_num_mul_word(&job.num, 58);
+        wif_num_add(&job.num, &d);
+        wif_num_set_pow58(&job.pow58[i], len - 1 - i);
+    }
+    job.wif = orig_wif;
+
+    for (job.depth = 1; job.depth <= max_depth; ++job.depth) {
+        int m = job.depth - (job.bad >= 0);
+        uint64_t combos, total;
+        if (m > job.npos)
+            break;
+        combos = BINOM[job.npos][m];
+        job.subs = job.bad >= 0 ? BASE58_ALPHABET_LEN : 1;
+        for (int i = 0; i < m && job.subs; ++i)
+            job.subs = job.subs > UINT64_MAX / 57 ? 0 : job.subs * 57;
+        if (job.subs == 0 || combos > UINT64_MAX / job.subs) {
+            fprintf(stderr, "Error: depth %d exceeds 2^64 candidates\n", job.depth);
+            break;
+        }
+        total = combos * job.subs;
+        printf("Depth %d: %llu candidates\n", job.depth, (unsigned long long)total);
+        job.stage = job.depth;
+        if (job_run(&job, total, rotate_range) && worker_results_count(w) > 0)
+            break;
+        if (w->interrupted)
+            break;
+    }
+    job_free(&job);
+}
+
+static void jump_range(Scheduler *s, int thread, uint64_t begin, uint64_t end, void *arg) {
+    SolverJob *job = arg;
+    CandidateBatch *b = job->batches[thread];
+    wif_num num;
+    uint64_t r;
+
+    b->sched = s;
+    begin += job->root;
+    end += job->root;
+    jump_value(job->jump, begin, &num);
+    for (r = begin;;) {
+        batch_check(b, &num);
+        if (++r == end || ((r & STOP_POLL_MASK) == 0 && scheduler_stopped(s)))
+            break;
+        jump_next(job->jump, r - 1, &num);
+    }
+    batch_flush(b);
+    progress_add(&b->stats.tried, r - begin);
+}
+
+/* JUMP steps the unknown block of the WIF straight from one candidate with
+ * a valid compression flag to the next (see jump.h), in increasing order
+ * from the status WIF, if one is given.  WIFs the jump does not apply to
+ * are left to SEARCH. */
+static void perform_work_jump(Worker *w) {
+    const char *orig_wif = configuration_get_wif(w->config);
+    const char *status = configuration_get_wif_status(w->config);
+    JumpTables *t;
+    SolverJob job;
+    uint64_t root = 0;
     if (!orig_wif)
         return;
-    int len = (int)strlen(orig_wif);
-    char *buf = strdup(orig_wif);
+
+    t = jump_tables_create(orig_wif, configuration_is_compressed(w->config));
+    if (!t) {
+        printf("Falling back to SEARCH\n");
+        perform_work_search(w);
+        return;
+    }
+    if (status && *status) {
+        root = jump_rank(t, status);
+        if (root > 0)
+            printf("Resuming from %s\n", status);
+    }
+    printf("Jump length %llu, %llu candidates\n", (unsigned long long)t->modulus,
+           (unsigned long long)(t->total - root));
+    if (root == t->total || !job_init(&job, w)) {
+        jump_tables_free(t);
+        return;
+    }
+    job.jump = t;
+    job.root = root;
+    job_run(&job, t->total - root, jump_range);
+    job_free(&job);
+}
+
+/* A line of the candidate file, checked where it lies: blanks around it are
+ * dropped, and anything but 51 or 52 Base58 characters is not a WIF. */
+static void list_check(CandidateBatch *b, const char *line, size_t len) {
+    wif_num n;
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t'))
+        len--;
+    while (len > 0 && (*line == ' ' || *line == '\t')) {
+        line++;
+        len--;
+    }
+    if ((len != COMPRESSED_WIF_LENGTH && len != COMPRESSED_WIF_LENGTH - 1) ||
+        !wif_num_from_base58_len(&n, line, len))
+        return;
+    if (wif_check_batch_add(len == COMPRESSED_WIF_LENGTH ? &b->check : &b->uncompressed, &n))
+        batch_check_flush(b);
+}
+
+/* The lines that start in [begin, end): every range ends where the next one
+ * picks up, whatever the line lengths. */
+static void list_range(Scheduler *s, int thread, uint64_t begin, uint64_t end, void *arg) {
+    SolverJob *job = arg;
+    CandidateBatch *b = job->batches[thread];
+    const char *data = job->list;
+    uint64_t pos = begin, lines = 0;
+
+    b->sched = s;
+    if (pos > 0 && data[pos - 1] != '\n') {
+        const char *nl = memchr(data + pos, '\n', job->list_size - pos);
+        pos = nl ? (uint64_t)(nl - data) + 1 : job->list_size;
+    }
+    while (pos < end) {
+        const char *nl = memchr(data + pos, '\n', job->list_size - pos);
+        uint64_t len = nl ? (uint64_t)(nl - data) - pos : job->list_size - pos;
+        list_check(b, data + pos, len);
+        pos += len + 1;
+        if ((++lines & STOP_POLL_MASK) == 0 && scheduler_stopped(s))
+            break;
+    }
+    batch_flush(b);
+    __atomic_add_fetch(&job->lines, lines, __ATOMIC_RELAXED);
+    progress_add(&b->stats.tried, (pos < end ? pos : end) - begin);
+}
+
+/* The file is mapped, not read: the threads check their lines in the page
+ * cache, and files larger than memory stream through it front to back. */
+static void list_file(SolverJob *job, const char *path) {
+    struct stat st;
+    void *data;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return;
+    }
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(path);
+        return;
+    }
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    job->list = data;
+    job->list_size = (uint64_t)st.st_size;
+    job_run(job, job->list_size, list_range);
+    munmap(data, (size_t)st.st_size);
+}
+
+#define LIST_CHUNK (16 << 20) /* bytes of standard input per scheduler run */
+
+/* Read past the end of the line under way; the bytes after it are moved to
+ * the front of ``buf``, and their number returned. */
+static size_t list_skip_line(char *buf, FILE *f) {
+    for (;;) {
+        size_t n = fread(buf, 1, LIST_CHUNK, f);
+        const char *nl = memchr(buf, '\n', n);
+        if (nl) {
+            n -= (size_t)(nl + 1 - buf);
+            memmove(buf, nl + 1, n);
+            return n;
+        }
+        if (n < LIST_CHUNK)
+            return 0;
+    }
+}
+
+/* Standard input is read a chunk at a time, cut after its last complete
+ * line; each chunk is a stage of its own.  There is no checkpoint, a stream
+ * cannot be resumed. */
+static void list_stream(SolverJob *job, FILE *f) {
+    Worker *w = job->w;
+    char *buf = malloc(LIST_CHUNK);
+    size_t keep = 0;
+
     if (!buf)
         return;
-    for (int i = 0; i < len; ++i) {
-        char orig = buf[i];
-        for (int j = 0; j < BASE58_ALPHABET_LEN; ++j) {
-            char c = BASE58_ALPHABET[j];
-            if (c == orig)
+    job->stream = 1;
+    w->resuming = 0;
+    for (;;) {
+        size_t n = fread(buf + keep, 1, LIST_CHUNK - keep, f), len = keep + n, end = len;
+        int more = n == LIST_CHUNK - keep;
+        if (len == 0)
+            break;
+        if (more) {
+            while (end > 0 && buf[end - 1] != '\n')
+                end--;
+            /* no line end at all: a line longer than a chunk is not a WIF,
+             * drop it up to its end and go on with the next line */
+            if (end == 0) {
+                keep = list_skip_line(buf, f);
                 continue;
-            buf[i] = c;
-            work_thread(w, buf);
+            }
         }
-        buf[i] = orig;
+        job->list = buf;
+        job->list_size = end;
+        if (!job_run(job, end, list_range) || w->interrupted ||
+            worker_targets_found(w) >= w->targets->count || !more)
+            break;
+        keep = len - end;
+        memmove(buf, buf + end, keep);
+        job->stage++;
     }
     free(buf);
 }
 
-static void perform_work_jump(Worker *w) {
-    /* simplified: treat as SEARCH */
-    perform_work_search(w);
+/* Every line of a file (or of standard input, "-") is a candidate WIF,
+ * compressed or not; the checksum picks those worth a public key. */
+static void perform_work_list(Worker *w) {
+    const char *path = configuration_get_wif(w->config);
+    struct timespec start;
+    SolverJob job;
+    double seconds;
+
+    if (!path || !job_init(&job, w))
+        return;
+    for (int i = 0; i < job.threads; ++i) {
+        CandidateBatch *b = job.batches[i];
+        b->stage.forms = batch_forms(b->targets, 1) | batch_forms(b->targets, 0);
+        wif_check_batch_init(&b->check, 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (strcmp(path, "-") == 0)
+        list_stream(&job, stdin);
+    else
+        list_file(&job, path);
+    seconds = seconds_since(&start);
+    printf("Checked %llu lines in %.1fs, %.0f lines/s\n", (unsigned long long)job.lines, seconds,
+           seconds > 0 ? (double)job.lines / seconds : 0);
+    job_free(&job);
 }
 
 static void perform_work(Worker *w) {
@@ -303,26 +1752,120 @@ static void perform_work(Worker *w) {
     case WORK_JUMP:
         perform_work_jump(w);
         break;
+    case WORK_LIST:
+        perform_work_list(w);
+        break;
     default: {
         char buf[128];
         snprintf(buf, sizeof(buf), "Dummy result for %s", work_str);
         worker_add_result(w, buf);
-        //worker_result_to_file_partial(w, buf);
         break;
     }
    }
 
 }
 
+/* Pick up the progress of an earlier run of the same job, if any.  Returns
+ * 0 if the checkpoint file belongs to another job. */
+static int checkpoint_start(Worker *w) {
+    const char *path = configuration_get_checkpoint_file(w->config);
+    int max_runtime = configuration_get_max_runtime(w->config);
+
+    w->interrupted = 0;
+    w->deadline = max_runtime > 0 ? time(NULL) + max_runtime : 0;
+    checkpoint_config_hash(w->config, w->config_hash);
+    if (!path && !w->deadline)
+        return 1;
+    if (path) {
+        int loaded = checkpoint_load(path, w->config_hash, &w->resume);
+        if (loaded < 0) {
+            fprintf(stderr, "Remove %s to start the job over\n", path);
+            return 0;
+        }
+        if (loaded) {
+            printf("Resuming from checkpoint %s\n", path);
+            for (size_t i = 0; i < w->resume.result_count; ++i) {
+                worker_add_result(w, w->resume.results[i]);
+                worker_found_wif(w, w->resume.results[i]);
+            }
+            w->resuming = 1;
+        }
+    }
+    checkpoint_catch_signals();
+    return 1;
+}
+
+/* A finished job needs its checkpoint no more; a stopped one keeps it. */
+static void checkpoint_finish(Worker *w) {
+    const char *path = configuration_get_checkpoint_file(w->config);
+    if (!path && !w->deadline)
+        return;
+    checkpoint_restore_signals();
+    if (w->interrupted) {
+        if (path)
+            printf("Stopped, progress saved to %s\n", path);
+        else
+            printf("Stopped\n");
+    } else if (path) {
+        remove(path);
+    }
+    checkpoint_clear(&w->resume);
+    w->resuming = 0;
+}
+
+/* Hits are streamed to the --results file while the solver runs; results
+ * resumed from a checkpoint were streamed by the run that found them. */
+static void results_start(Worker *w) {
+    const char *path = configuration_get_results_file(w->config);
+    if (!path)
+        return;
+    w->sink = sink_open(path, configuration_get_results_sync(w->config));
+    if (w->sink)
+        printf("Streaming results to %s\n", path);
+}
+
+static void results_finish(Worker *w) {
+    if (!w->sink)
+        return;
+    if (w->sink->dropped)
+        fprintf(stderr, "%llu result(s) not streamed, the queue was full\n",
+                (unsigned long long)w->sink->dropped);
+    sink_close(w->sink);
+    w->sink = NULL;
+}
+
+/* The results of a shard go to a file of their own, for shard_merge(). */
+static void shard_finish(Worker *w) {
+    const char *path = configuration_get_shard_file(w->config);
+    unsigned char hash[32];
+    if (!path || configuration_get_shard_count(w->config) < 1)
+        return;
+    checkpoint_keyspace_hash(w->config, hash);
+    if (shard_save(path, hash, configuration_get_shard_index(w->config),
+                   configuration_get_shard_count(w->config), !w->interrupted, w->results,
+                   w->result_count))
+        printf("Shard results written to %s\n", path);
+}
+
 void worker_run(Worker *w) {
     if (!w) return;
     const char *work_str = work_to_string(configuration_get_work(w->config));
     printf("--- Starting worker ---\n");
+    sha256_select_impl(SHA256_IMPL_AUTO);
+    printf("Using %s SHA256\n", sha256_impl_name());
     char subject[128];
     snprintf(subject, sizeof(subject), "Starting worker '%s'", work_str);
     send_email(w, subject, configuration_get_wif(w->config));
 
+    if (!checkpoint_start(w))
+        return;
+    results_start(w);
+    progress_catch_signal();
     perform_work(w);
+    progress_restore_signal();
+    results_finish(w);
+    checkpoint_finish(w);
+    shard_finish(w);
 
     printf("--- Work finished ---\n");
     printf("Worker '%s' ended, %zu result(s)\n", work_str, w->result_count);
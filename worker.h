@@ -1,25 +1,52 @@
 #ifndef WORKER_H
 #define WORKER_H
 
+#include "bitcoin.h"
+#include "checkpoint.h"
 #include "configuration.h"
+#include "sink.h"
+#include "targets.h"
+#include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <time.h>
 
 typedef struct {
     Configuration *config;
     char **results;
     size_t result_count;
     size_t result_capacity;
-    unsigned long time_id;
+    pthread_mutex_t result_lock; /* solver threads add results concurrently */
+    ResultSink *sink;   /* --results stream, open while the solver runs */
+    TargetSet *targets; /* hashes of the target addresses, read only */
+    unsigned char *found; /* per hash of targets, set once its key turned up */
+    size_t found_count; /* distinct targets found, under result_lock */
+    unsigned char config_hash[32]; /* identifies the job in checkpoints */
+    Checkpoint resume;  /* progress read from the checkpoint file */
+    int resuming;
+    time_t deadline;    /* --max-runtime, 0 for none */
+    int interrupted;    /* stopped early, the checkpoint is kept */
+    uint64_t tried;     /* candidates done by the solver runs */
+    double elapsed;     /* seconds they took */
 } Worker;
 
 Worker *worker_create(Configuration *config);
 void worker_free(Worker *worker);
 
-void worker_add_result(Worker *worker, const char *data);
+/* Returns 0 if ``data`` is a result already, or cannot be stored. */
+int worker_add_result(Worker *worker, const char *data);
 void worker_result_to_file(Worker *worker);
-void worker_result_to_file_partial(Worker *worker, const char *data);
 
 void worker_run(Worker *worker);
 size_t worker_results_count(const Worker *worker);
+/* Distinct target addresses the results belong to. */
+size_t worker_targets_found(const Worker *worker);
+
+/* Private keys of END: those whose WIF starts with ``prefix`` and has
+ * ``missing`` more characters.  Sets ``first`` (the first key) and
+ * ``count`` (0 if no valid key fits); returns 0 if there are 2^64 keys or
+ * more. */
+int worker_end_key_range(const char *prefix, int missing, int compressed, wif_num *first,
+                         uint64_t *count);
 
 #endif /* WORKER_H */